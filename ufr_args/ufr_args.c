@@ -34,19 +34,171 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+#include <limits.h>
+#include <float.h>
+#include <stdatomic.h>
 
 
 
 #include "ufr_args.h"
 
-void* ufr_linux_load_library(const char* type, const char* name, const char* classname);
+#if __linux__
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+// ============================================================================
+//  UFR ARGS - Busca de delimitadores
+// ============================================================================
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define UFR_ARGS_HAS_X86 1
+#endif
+
+/**
+ * @brief Retorna a posicao do proximo caracter especial a partir de i_text:
+ * '\0', '\n', aspas simples ou div. Dentro de aspas o chamador passa
+ * div = '\'', assim o divisor deixa de ser especial.
+ */
+typedef size_t (*ufr_args_scan_t)(const char* text, size_t i_text, const char div);
+
+static size_t ufr_args_scan_scalar(const char* text, size_t i_text, const char div) {
+    while (1) {
+        const char c = text[i_text];
+        if ( c == '\0' || c == '\n' || c == '\'' || c == div ) {
+            return i_text;
+        }
+        i_text += 1;
+    }
+}
+
+#if UFR_ARGS_HAS_X86
+// As leituras sao alinhadas em 16/32 bytes e por isso nunca cruzam uma pagina
+// depois do '\0'. Os bytes antes de i_text sao descartados pela mascara. Como
+// o bloco pode passar do fim da string, o AddressSanitizer e desligado aqui.
+
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t ufr_args_scan_sse2(const char* text, size_t i_text, const char div) {
+    const char* ptr = &text[i_text];
+    const size_t offset = (uintptr_t) ptr & 15;
+    const __m128i* block = (const __m128i*) (ptr - offset);
+    const __m128i v_zero = _mm_setzero_si128();
+    const __m128i v_line = _mm_set1_epi8('\n');
+    const __m128i v_quote = _mm_set1_epi8('\'');
+    const __m128i v_div = _mm_set1_epi8(div);
+
+    uint32_t mask = 0xFFFFu << offset;
+    while (1) {
+        const __m128i v = _mm_load_si128(block);
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, v_zero), _mm_cmpeq_epi8(v, v_line)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, v_quote), _mm_cmpeq_epi8(v, v_div)));
+        const uint32_t bits = (uint32_t) _mm_movemask_epi8(found) & mask;
+        if ( bits != 0 ) {
+            return (const char*) block - text + __builtin_ctz(bits);
+        }
+        block += 1;
+        mask = 0xFFFFu;
+    }
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t ufr_args_scan_avx2(const char* text, size_t i_text, const char div) {
+    const char* ptr = &text[i_text];
+    const size_t offset = (uintptr_t) ptr & 31;
+    const __m256i* block = (const __m256i*) (ptr - offset);
+    const __m256i v_zero = _mm256_setzero_si256();
+    const __m256i v_line = _mm256_set1_epi8('\n');
+    const __m256i v_quote = _mm256_set1_epi8('\'');
+    const __m256i v_div = _mm256_set1_epi8(div);
+
+    uint32_t mask = 0xFFFFFFFFu << offset;
+    while (1) {
+        const __m256i v = _mm256_load_si256(block);
+        const __m256i found = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, v_zero), _mm256_cmpeq_epi8(v, v_line)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, v_quote), _mm256_cmpeq_epi8(v, v_div)));
+        const uint32_t bits = (uint32_t) _mm256_movemask_epi8(found) & mask;
+        if ( bits != 0 ) {
+            return (const char*) block - text + __builtin_ctz(bits);
+        }
+        block += 1;
+        mask = 0xFFFFFFFFu;
+    }
+}
+#endif
+
+// escolhida na primeira chamada por qualquer thread; as implementacoes sao
+// equivalentes, entao basta que a leitura e a escrita do ponteiro sejam atomicas
+static _Atomic(ufr_args_scan_t) g_ufr_args_scan = NULL;
+
+/**
+ * @brief Escolhe a implementacao da busca de delimitadores. O nivel pedido e
+ * limitado pelo que a CPU suporta.
+ * 
+ * @param[in] level UFR_ARGS_SIMD_AUTO, UFR_ARGS_SIMD_SCALAR, UFR_ARGS_SIMD_SSE2 ou UFR_ARGS_SIMD_AVX2
+ * @return int nivel efetivamente usado
+ */
+int ufr_args_simd_select(const int level) {
+    int best = UFR_ARGS_SIMD_SCALAR;
+#if UFR_ARGS_HAS_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx2") ) {
+        best = UFR_ARGS_SIMD_AVX2;
+    } else if ( __builtin_cpu_supports("sse2") ) {
+        best = UFR_ARGS_SIMD_SSE2;
+    }
+#endif
+    const int selected = ( level == UFR_ARGS_SIMD_AUTO || level > best ) ? best : level;
+
+    ufr_args_scan_t scan;
+    switch (selected) {
+#if UFR_ARGS_HAS_X86
+        case UFR_ARGS_SIMD_AVX2: scan = ufr_args_scan_avx2; break;
+        case UFR_ARGS_SIMD_SSE2: scan = ufr_args_scan_sse2; break;
+#endif
+        default: scan = ufr_args_scan_scalar; break;
+    }
+    atomic_store_explicit(&g_ufr_args_scan, scan, memory_order_relaxed);
+    return selected;
+}
+
+static inline ufr_args_scan_t ufr_args_scan_get() {
+    ufr_args_scan_t scan = atomic_load_explicit(&g_ufr_args_scan, memory_order_relaxed);
+    if ( scan == NULL ) {
+        ufr_args_simd_select(UFR_ARGS_SIMD_AUTO);
+        scan = atomic_load_explicit(&g_ufr_args_scan, memory_order_relaxed);
+    }
+    return scan;
+}
+
+/**
+ * @brief Os tokens curtos sao a maioria, entao os primeiros caracteres sao
+ * verificados aqui mesmo; a busca vetorizada so e chamada para trechos longos.
+ */
+#define UFR_ARGS_SCAN_INLINE 16
+
+static inline size_t ufr_args_scan_next(const ufr_args_scan_t scan, const char* text, size_t i_text, const char div) {
+    for (int i=0; i<UFR_ARGS_SCAN_INLINE; i++) {
+        const char c = text[i_text];
+        if ( c == '\0' || c == '\n' || c == '\'' || c == div ) {
+            return i_text;
+        }
+        i_text += 1;
+    }
+    return scan(text, i_text, div);
+}
 
 // ============================================================================
 //  UFR ARGS
 // ============================================================================
+
 /**
  * @brief Retorna a proxima palavra (token) na frase apontada por text e 
- * cursor_ini. 
+ * cursor_ini. Os trechos sem caracteres especiais sao encontrados pela busca
+ * vetorizada (SSE2/AVX2) e copiados de uma vez; o resultado e igual ao de
+ * ufr_args_flex_div_scalar.
  * 
  * @param[in] text  texto a ser quebrado em diferentes palavras. 
  *          Exemplo "token1 token2 token3"
@@ -59,7 +211,71 @@ void* ufr_linux_load_library(const char* type, const char* name, const char* cla
  * @return true existe uma palavra válida no token
  * @return false não existe uma palavra válida no token, fim da frase
  */
+bool ufr_args_flex_div_sz(const char* text, size_t* cursor_ini, char* token, const size_t token_max, const char div) {
+    const ufr_args_scan_t scan = ufr_args_scan_get();
+    uint8_t state = 0;
+    size_t i_token = 0;
+    size_t i_text = *cursor_ini;
+    while (1) {
+        // copia o trecho sem caracteres especiais
+        const size_t i_special = ufr_args_scan_next(scan, text, i_text, (state == 0) ? div : '\'');
+        const size_t run = i_special - i_text;
+        if ( run > 0 ) {
+            const size_t space = token_max - 1 - i_token;
+            const size_t len = ( run < space ) ? run : space;
+            memcpy(&token[i_token], &text[i_text], len);
+            i_token += len;
+            i_text = i_special;
+        }
+
+        const char c = text[i_text];
+        if ( c == '\0' ) {
+            break;
+        }
+        if ( c == '\n' ) {
+            i_text += 1;
+            continue;
+        }
+        if ( c == '\'' ) {
+            state = (state == 0) ? 1 : 0;
+        } else if ( state == 0 && c == div && i_token > 0 ) {
+            break;
+        }
+        i_text += 1;
+    }
+
+    token[i_token] = '\0';
+    *cursor_ini = i_text;
+    return (i_token > 0);
+}
+
+/**
+ * @brief Igual a ufr_args_flex_div_sz, com cursor de 16 bits. Textos maiores
+ * que 65535 caracteres devem usar ufr_args_flex_div_sz.
+ */
 bool ufr_args_flex_div(const char* text, uint16_t* cursor_ini, char* token, const uint16_t token_max, const char div) {
+    size_t cursor = *cursor_ini;
+    const bool res = ufr_args_flex_div_sz(text, &cursor, token, token_max, div);
+    *cursor_ini = (uint16_t) cursor;
+    return res;
+}
+
+/**
+ * @brief Versao de referencia de ufr_args_flex_div, que le um caracter por
+ * iteracao. Usada nos testes de equivalencia.
+ * 
+ * @param[in] text  texto a ser quebrado em diferentes palavras. 
+ *          Exemplo "token1 token2 token3"
+ * @param[inout] cursor_ini numero inteiro do cursor da frase. Ao final da funcao a 
+ *          posicao do cursor é atualizada
+ * @param[out] token palavra
+ * @param[in] token_max tamanho maximo da palavra
+ * @param[in] div caracter que serve como divisor das palavras
+ *
+ * @return true existe uma palavra válida no token
+ * @return false não existe uma palavra válida no token, fim da frase
+ */
+bool ufr_args_flex_div_scalar(const char* text, uint16_t* cursor_ini, char* token, const uint16_t token_max, const char div) {
     uint8_t state = 0;
     uint16_t i_token = 0;
     uint16_t i_text = *cursor_ini;
@@ -133,228 +349,1395 @@ bool ufr_args_flex(const char* text, uint16_t* cursor_ini, char* token, const ui
 }
 
 /**
- * @brief retorna um número positivo do argumento indicado por name
- *   ex1: ufr_args_getu({.text="@nome 'teste jjj hhh   ggggg' @pontos 10"}, "@pontos", 0) -> 10
- *   ex2: ufr_args_getu({.text="@nome    teste    @pontos %d", .arg[0].i32=20}, "@pontos", 0) -> 20
- *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0) -> 0
+ * @brief Igual a ufr_args_flex, com cursor size_t para textos de qualquer tamanho
+ */
+bool ufr_args_flex_sz(const char* text, size_t* cursor_ini, char* token, const size_t token_max) {
+    return ufr_args_flex_div_sz(text, cursor_ini, token, token_max, ' ');
+}
+
+// ============================================================================
+//  UFR ARGS - Tokens sem copia
+// ============================================================================
+
+/**
+ * @brief Retorna a proxima palavra (token) da frase como uma visao do texto
+ * original (posicao, tamanho e se tem aspas), sem copiar os caracteres. Os
+ * tokens sao os mesmos de ufr_args_flex_div, mas sem o limite de tamanho.
+ *   ex: "@nome 'a b' 10" -> {0,5,false}, {6,5,true}, {12,2,false}
  * 
- * @param[in] args estrutura de argumentos variaveis
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
- * @return size_t valor do argumento
+ * @param[in] text  texto a ser quebrado em diferentes palavras
+ * @param[inout] cursor_ini numero inteiro do cursor da frase. Ao final da funcao a 
+ *          posicao do cursor é atualizada
+ * @param[out] span visao do token no texto
+ * @param[in] div caracter que serve como divisor das palavras
+ *
+ * @return true existe uma palavra válida no span
+ * @return false não existe uma palavra válida no span, fim da frase
  */
-size_t ufr_args_getu(const ufr_args_t* args, const char* name, const size_t default_value) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
+bool ufr_args_flex_span(const char* text, size_t* cursor_ini, ufr_args_span_t* span, const char div) {
+    const ufr_args_scan_t scan = ufr_args_scan_get();
+    uint8_t state = 0;
+    size_t count = 0;
+    size_t i_text = *cursor_ini;
+    bool started = false;
+    span->ini = i_text;
+    span->quoted = false;
+    while (1) {
+        // trecho sem caracteres especiais
+        const size_t i_special = ufr_args_scan_next(scan, text, i_text, (state == 0) ? div : '\'');
+        if ( i_special > i_text ) {
+            if ( started == false ) {
+                started = true;
+                span->ini = i_text;
+            }
+            count += i_special - i_text;
+            i_text = i_special;
+        }
+
+        const char c = text[i_text];
+        if ( c == '\0' ) {
+            break;
+        }
+
+        // ignore caracter
+        if ( c == '\n' ) {
+            if ( started ) {
+                span->quoted = true;
             }
+            i_text += 1;
             continue;
         }
 
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 'd' ) {
-                    return args->arg[count_arg].i32;
-                } else if ( token[1] == 's' ) {
-                    return atoi(args->arg[count_arg].str);
-                } else if ( token[1] == 'f' ) {
-                    return (size_t) args->arg[count_arg].f32;
-                }
-            } else {
-                return atoi(token);
+        if ( c == '\'' ) {
+            state = (state == 0) ? 1 : 0;
+            if ( started == false ) {
+                started = true;
+                span->ini = i_text;
             }
+            span->quoted = true;
+        } else if ( state == 0 && c == div ) {
+            if ( count > 0 ) {
+                break;
+            }
+            // descarta aspas vazias antes do divisor
+            started = false;
+            span->quoted = false;
         }
+        i_text += 1;
     }
 
-    // not found, return default value
-    return default_value;
+    span->len = ( count > 0 ) ? i_text - span->ini : 0;
+    *cursor_ini = i_text;
+    return (count > 0);
 }
 
 /**
- * @brief retorna um número positivo do argumento indicado por name
- *   ex1: ufr_args_getu({.text="@nome teste @pontos 10"}, "@pontos", 0) -> 10
- *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20}, "@pontos", 0) -> 20
- *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0) -> 0
+ * @brief Copia o token indicado pelo span, removendo aspas e '\n'
  * 
- * @param[in] args estrutura de argumentos variaveis
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
- * @return size_t valor do argumento
+ * @param[in] text texto original
+ * @param[in] span visao do token no texto
+ * @param[out] token palavra
+ * @param[in] token_max tamanho maximo da palavra
+ * @return size_t tamanho da palavra copiada
  */
-int ufr_args_geti(const ufr_args_t* args, const char* name, const int default_value) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
-            }
-            continue;
-        }
-
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 'd' ) {
-                    return args->arg[count_arg].i32;
-                } else if ( token[1] == 's' ) {
-                    return atoi(args->arg[count_arg].str);
-                } else if ( token[1] == 'f' ) {
-                    return (int) args->arg[count_arg].f32;
-                }
-            } else {
-                return atoi(token);
+size_t ufr_args_span_copy(const char* text, const ufr_args_span_t* span, char* token, const size_t token_max) {
+    const char* base = &text[span->ini];
+    size_t i_token = 0;
+    if ( span->quoted == false ) {
+        i_token = ( span->len < token_max ) ? span->len : token_max - 1;
+        memcpy(token, base, i_token);
+    } else {
+        for (size_t i=0; i<span->len && i_token < token_max-1; i++) {
+            const char c = base[i];
+            if ( c != '\'' && c != '\n' ) {
+                token[i_token] = c;
+                i_token += 1;
             }
         }
     }
-
-    // not found, return default value
-    return default_value;
+    token[i_token] = '\0';
+    return i_token;
 }
 
 /**
- * @brief retorna um ponto flutuante do argumento indicado por name
- *   ex1: ufr_args_getu({.text="@nome teste @pontos 10.5"}, "@pontos", 0) -> 10.5
- *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20.5}, "@pontos", 0) -> 20.5
- *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0.0) -> 0.0
+ * @brief Compara o token indicado pelo span com uma string
  * 
- * @param[in] args estrutura de argumentos variaveis
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
- * @return size_t valor do argumento
+ * @param[in] text texto original
+ * @param[in] span visao do token no texto
+ * @param[in] str string terminada com '\0'
+ * @return true se o token e a string sao iguais
  */
-float ufr_args_getf(const ufr_args_t* args, const char* name, const float default_value) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
-            }
+bool ufr_args_span_equal(const char* text, const ufr_args_span_t* span, const char* str) {
+    const char* base = &text[span->ini];
+    if ( span->quoted == false ) {
+        return strncmp(base, str, span->len) == 0 && str[span->len] == '\0';
+    }
+
+    size_t i_str = 0;
+    for (size_t i=0; i<span->len; i++) {
+        const char c = base[i];
+        if ( c == '\'' || c == '\n' ) {
             continue;
         }
-
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 'd' ) {
-                    return args->arg[count_arg].i32;
-                } else if ( token[1] == 's' ) {
-                    return (float) atof(args->arg[count_arg].str);
-                } else if ( token[1] == 'f' ) {
-                    return args->arg[count_arg].f32;
-                }
-            } else {
-                return (float) atof(token);
-            }
+        if ( str[i_str] != c ) {
+            return false;
         }
+        i_str += 1;
     }
+    return str[i_str] == '\0';
+}
 
-    // not found, return default value
-    return default_value;
+/**
+ * @brief copia os dois primeiros caracteres do token, suficiente para
+ * reconhecer nomes ('@') e argumentos ('%')
+ */
+static void ufr_args_span_head(const char* text, const ufr_args_span_t* span, char head[3]) {
+    if ( span->quoted == false && span->len >= 2 ) {
+        head[0] = text[span->ini];
+        head[1] = text[span->ini + 1];
+        head[2] = '\0';
+    } else {
+        ufr_args_span_copy(text, span, head, 3);
+    }
 }
 
 /**
- * @brief retorna um ponteiro do argumento indicado por name
- *   ex1: ufr_args_getp({.text="@nome teste @pontos %p", .arg[0].i32=0x1000}, "@pontos", NULL) -> 0x1000
- *   ex2: ufr_args_getp({.text="@nome teste"}, "@pontos", NULL) -> NULL
+ * @brief retorna o tipo do valor: '\0' para valor literal, ou o caracter
+ * depois de '%' ("%d" -> 'd'). Um '%' sozinho retorna '%'.
+ */
+static char ufr_args_head_type(const char head[3]) {
+    if ( head[0] != '%' ) {
+        return '\0';
+    }
+    return ( head[1] != '\0' ) ? head[1] : '%';
+}
+
+// ============================================================================
+//  UFR ARGS - Estado externo
+// ============================================================================
+
+/*
+ * O indice compilado e os argumentos alem de arg[6] ficam fora do ufr_args_t,
+ * que mantem os 64 bytes de text + arg[7]. Cada ufr_args_t com estado tem um
+ * no em uma tabela global, pelo endereco da estrutura; uma copia tem outro
+ * endereco e nao ve o estado do original.
+ *
+ * Os nos nunca saem do balde em que foram criados: liberar volta a chave para
+ * NULL e o no e reaproveitado no mesmo balde. Assim a consulta percorre o
+ * balde sem trava; so criar e liberar nos usam g_ufr_args_ext_lock. O no
+ * guarda o texto com que foi criado, e a consulta ignora o no quando
+ * args->text mudou (um ufr_args_t novo no endereco de outro que nao foi
+ * liberado).
+ */
+
+#define UFR_ARGS_EXT_BUCKETS 256
+#define UFR_ARGS_ARENA_MIN   256
+
+// bloco do arena dos argumentos externos, liberado todo de uma vez
+typedef struct _ufr_args_chunk {
+    struct _ufr_args_chunk* next;
+    size_t size;
+    size_t used;
+    _Alignas(16) char data[];
+} ufr_args_chunk_t;
+
+typedef struct _ufr_args_ext {
+    _Atomic(const ufr_args_t*) key;     // dono do no, ou NULL se livre
+    struct _ufr_args_ext* next;         // proximo no do balde, fixo
+    const char* text;                   // args->text na criacao do no
+    ufr_args_index_t* index;
+    ufr_args_spill_t* spill;            // alocado no arena
+    ufr_args_chunk_t* arena;
+} ufr_args_ext_t;
+
+static _Atomic(ufr_args_ext_t*) g_ufr_args_ext[UFR_ARGS_EXT_BUCKETS];
+static atomic_flag g_ufr_args_ext_lock = ATOMIC_FLAG_INIT;
+
+static inline _Atomic(ufr_args_ext_t*)* ufr_args_ext_bucket(const ufr_args_t* args) {
+    const uint64_t key = (uint64_t) (uintptr_t) args;
+    return &g_ufr_args_ext[ ((key >> 3) * 0x9E3779B97F4A7C15ULL) >> 56 ];
+}
+
+/**
+ * @brief procura o no de args pelo endereco, sem trava
  * 
- * @param[in] args estrutura de argumentos variaveis
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
- * @return size_t valor do argumento
+ * @return ufr_args_ext_t* no de args, ou NULL se args nao tem estado externo
  */
-const void* ufr_args_getp(const ufr_args_t* args, const char* name, const void* default_value) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
-            }
-            continue;
+static inline ufr_args_ext_t* ufr_args_ext_find(const ufr_args_t* args) {
+    ufr_args_ext_t* ext = atomic_load_explicit(ufr_args_ext_bucket(args), memory_order_acquire);
+    while ( ext != NULL ) {
+        if ( atomic_load_explicit(&ext->key, memory_order_acquire) == args ) {
+            return ext;
         }
+        ext = ext->next;
+    }
+    return NULL;
+}
 
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 'p' ) {
-                    return args->arg[count_arg].ptr;
-                } else {
-                    return default_value;
-                }
-            }
+/**
+ * @brief no de args valido para o texto atual, ou NULL
+ */
+static inline const ufr_args_ext_t* ufr_args_ext_current(const ufr_args_t* args) {
+    const ufr_args_ext_t* ext = ufr_args_ext_find(args);
+    return ( ext != NULL && ext->text == args->text ) ? ext : NULL;
+}
+
+static void ufr_args_ext_lock(void) {
+    while ( atomic_flag_test_and_set_explicit(&g_ufr_args_ext_lock, memory_order_acquire) ) {
+    }
+}
+
+static void ufr_args_ext_unlock(void) {
+    atomic_flag_clear_explicit(&g_ufr_args_ext_lock, memory_order_release);
+}
+
+/**
+ * @brief aloca size bytes no arena do no; os blocos crescem em dobro
+ */
+static void* ufr_args_arena_alloc(ufr_args_ext_t* ext, size_t size) {
+    size = (size + 15) & ~((size_t) 15);
+    ufr_args_chunk_t* chunk = ext->arena;
+    if ( chunk == NULL || chunk->size - chunk->used < size ) {
+        size_t chunk_size = ( chunk == NULL ) ? UFR_ARGS_ARENA_MIN : chunk->size * 2;
+        while ( chunk_size < size ) {
+            chunk_size *= 2;
         }
+        ufr_args_chunk_t* new_chunk = malloc(sizeof(ufr_args_chunk_t) + chunk_size);
+        if ( new_chunk == NULL ) {
+            return NULL;
+        }
+        new_chunk->next = chunk;
+        new_chunk->size = chunk_size;
+        new_chunk->used = 0;
+        ext->arena = new_chunk;
+        chunk = new_chunk;
     }
+    void* ptr = &chunk->data[chunk->used];
+    chunk->used += size;
+    return ptr;
+}
 
-    // not found, return default value
-    return default_value;
+static void ufr_args_arena_free(ufr_args_ext_t* ext) {
+    ufr_args_chunk_t* chunk = ext->arena;
+    while ( chunk != NULL ) {
+        ufr_args_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    ext->arena = NULL;
+    ext->spill = NULL;
 }
 
+static void ufr_args_index_release(ufr_args_ext_t* ext);
+
 /**
- * @brief retorna uma string com o valor do argumento indicado por name
- *   ex1: ufr_args_getu({.text="@nome teste @pontos 10.5"}, "@pontos", 0) -> 10.5
- *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20.5}, "@pontos", 0) -> 20.5
- *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0.0) -> 0.0
+ * @brief Retorna o no de args, criando um se ele nao existe. Um no de um texto
+ * antigo e esvaziado e passa a valer para o texto atual.
  * 
- * @param[in] args estrutura de argumentos variaveis
- * @param[inout] buffer local de memoria para guardar a string do text
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja no text
- * @return const char* ponteiro para a string do valor do argumento
+ * @return ufr_args_ext_t* no de args, ou NULL se faltar memoria
  */
-const char* ufr_args_gets(const ufr_args_t* args, char* buffer, const char* name, const char* default_value) {
-    char token[UFR_ARGS_TOKEN];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
-            }
-            continue;
+static ufr_args_ext_t* ufr_args_ext_get(const ufr_args_t* args) {
+    ufr_args_ext_t* ext = ufr_args_ext_find(args);
+    if ( ext != NULL ) {
+        if ( ext->text != args->text ) {
+            ufr_args_index_release(ext);
+            ufr_args_arena_free(ext);
+            ext->text = args->text;
         }
+        return ext;
+    }
 
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 's' ) {
-                    return args->arg[count_arg].str;
-                } else {
-                    return default_value;
-                }
-            } else {
-                strcpy(buffer, token);
-                return buffer;
-            }
+    // reaproveita um no livre do balde ou cria um novo
+    _Atomic(ufr_args_ext_t*)* bucket = ufr_args_ext_bucket(args);
+    ufr_args_ext_lock();
+    ext = atomic_load_explicit(bucket, memory_order_relaxed);
+    while ( ext != NULL && atomic_load_explicit(&ext->key, memory_order_relaxed) != NULL ) {
+        ext = ext->next;
+    }
+    if ( ext == NULL ) {
+        ext = calloc(1, sizeof(ufr_args_ext_t));
+        if ( ext == NULL ) {
+            ufr_args_ext_unlock();
+            return NULL;
         }
+        ext->next = atomic_load_explicit(bucket, memory_order_relaxed);
+        atomic_store_explicit(bucket, ext, memory_order_release);
     }
+    ext->text = args->text;
+    ext->index = NULL;
+    ext->spill = NULL;
+    ext->arena = NULL;
+    atomic_store_explicit(&ext->key, args, memory_order_release);
+    ufr_args_ext_unlock();
+    return ext;
+}
 
-    // not found, return default value
-    return default_value;
+/**
+ * @brief devolve o no, ja esvaziado, para o balde
+ */
+static void ufr_args_ext_put(ufr_args_ext_t* ext) {
+    ufr_args_ext_lock();
+    atomic_store_explicit(&ext->key, NULL, memory_order_release);
+    ufr_args_ext_unlock();
 }
 
 /**
- * @brief retorna um ponteiro do argumento indicado por name
- *   ex1: ufr_args_getp({.text="@nome teste @pontos %p", .arg[0].i32=0x1000}, "@pontos", NULL) -> 0x1000
+ * @brief Retorna o indice criado por ufr_args_compile, para inspecao.
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @return const ufr_args_index_t* indice, ou NULL se args nao foi compilado
+ */
+const ufr_args_index_t* ufr_args_index(const ufr_args_t* args) {
+    const ufr_args_ext_t* ext = ufr_args_ext_current(args);
+    return ( ext != NULL ) ? ext->index : NULL;
+}
+
+/**
+ * @brief Retorna o vetor dos argumentos alem de arg[6], para inspecao.
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @return const ufr_args_spill_t* vetor externo, ou NULL se nao existe
+ */
+const ufr_args_spill_t* ufr_args_spill(const ufr_args_t* args) {
+    const ufr_args_ext_t* ext = ufr_args_ext_current(args);
+    return ( ext != NULL ) ? ext->spill : NULL;
+}
+
+// ============================================================================
+//  UFR ARGS - Argumentos
+// ============================================================================
+
+/**
+ * @brief retorna o argumento de indice slot, em arg[] ou no vetor externo
+ * 
+ * @return const item_t* argumento, ou NULL se ele nao foi preenchido
+ */
+static inline const item_t* ufr_args_slot(const ufr_args_t* args, const uint32_t slot) {
+    // os niveis filhos usam os argumentos da raiz
+    const ufr_args_ext_t* ext = ufr_args_ext_current(args);
+    if ( ext != NULL && ext->index != NULL && ext->index->root != NULL ) {
+        args = ext->index->root;
+        ext = NULL;
+        if ( slot >= UFR_ARGS_INLINE ) {
+            ext = ufr_args_ext_current(args);
+        }
+    }
+    if ( slot < UFR_ARGS_INLINE ) {
+        return &args->arg[slot];
+    }
+    const ufr_args_spill_t* spill = ( ext != NULL ) ? ext->spill : NULL;
+    if ( spill == NULL || slot - UFR_ARGS_INLINE >= spill->count ) {
+        return NULL;
+    }
+    return &spill->arg[slot - UFR_ARGS_INLINE];
+}
+
+/**
+ * @brief Retorna o argumento de indice slot para escrita. Os 7 primeiros ficam
+ * em arg[]; os seguintes ficam em um vetor externo, alocado em um arena que
+ * cresce em blocos e e liberado por ufr_args_free. Os argumentos novos comecam
+ * zerados.
+ *   ex: ufr_args_t args = {.text="@a %d @b %d @c %d @d %d @e %d @f %d @g %d @h %d"};
+ *       ufr_args_arg(&args, 7)->i32 = 10;
+ *       ufr_args_geti(&args, "@h", 0) -> 10
+ *       ufr_args_free(&args);
+ * 
+ * @param[inout] args estrutura de argumentos variaveis
+ * @param[in] slot indice do argumento, na ordem dos '%' do texto
+ * @return item_t* argumento, ou NULL se faltar memoria
+ */
+item_t* ufr_args_arg(ufr_args_t* args, const uint32_t slot) {
+    if ( slot < UFR_ARGS_INLINE ) {
+        return &args->arg[slot];
+    }
+
+    ufr_args_ext_t* ext = ufr_args_ext_get(args);
+    if ( ext == NULL ) {
+        return NULL;
+    }
+    const uint32_t i_spill = slot - UFR_ARGS_INLINE;
+    ufr_args_spill_t* spill = ext->spill;
+    if ( spill == NULL || i_spill >= spill->max ) {
+        // o bloco antigo fica no arena ate ufr_args_free
+        uint32_t new_max = ( spill == NULL ) ? 8 : spill->max * 2;
+        while ( new_max <= i_spill ) {
+            new_max *= 2;
+        }
+        ufr_args_spill_t* new_spill = ufr_args_arena_alloc(ext, sizeof(ufr_args_spill_t) + new_max * sizeof(item_t));
+        if ( new_spill == NULL ) {
+            return NULL;
+        }
+        new_spill->count = 0;
+        if ( spill != NULL ) {
+            memcpy(new_spill->arg, spill->arg, spill->count * sizeof(item_t));
+            new_spill->count = spill->count;
+        }
+        new_spill->max = new_max;
+        spill = new_spill;
+        ext->spill = spill;
+    }
+    if ( i_spill >= spill->count ) {
+        memset(&spill->arg[spill->count], 0, (i_spill + 1 - spill->count) * sizeof(item_t));
+        spill->count = i_spill + 1;
+    }
+    return &spill->arg[i_spill];
+}
+
+// ============================================================================
+//  UFR ARGS - Numeros
+// ============================================================================
+
+/**
+ * @brief Converte um inteiro decimal com sinal opcional, sem depender do
+ * locale. Diferente do atoi, o texto inteiro deve ser o numero.
+ *   ex1: "-42" -> UFR_OK, -42
+ *   ex2: "42abc", "", "1.5" -> UFR_ARGS_ERROR_INVALID
+ *   ex3: "9223372036854775808" -> UFR_ARGS_ERROR_RANGE
+ * 
+ * @param[in] str texto do numero, sem '\0' obrigatorio
+ * @param[in] len quantidade de caracteres de str
+ * @param[out] out numero convertido
+ * @return int UFR_OK, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+static int ufr_args_parse_i64(const char* str, const size_t len, int64_t* out) {
+    size_t i = 0;
+    bool neg = false;
+    if ( i < len && (str[i] == '-' || str[i] == '+') ) {
+        neg = ( str[i] == '-' );
+        i += 1;
+    }
+    if ( i == len ) {
+        return UFR_ARGS_ERROR_INVALID;
+    }
+
+    // continua depois do estouro, lixo no fim do texto tem prioridade
+    const uint64_t limit = neg ? (uint64_t) INT64_MAX + 1 : (uint64_t) INT64_MAX;
+    uint64_t value = 0;
+    bool range = false;
+    for (; i<len; i++) {
+        const uint8_t digit = (uint8_t) (str[i] - '0');
+        if ( digit > 9 ) {
+            return UFR_ARGS_ERROR_INVALID;
+        }
+        if ( value > (limit - digit) / 10 ) {
+            range = true;
+        } else {
+            value = value * 10 + digit;
+        }
+    }
+    if ( range ) {
+        return UFR_ARGS_ERROR_RANGE;
+    }
+
+    *out = ( neg && value > 0 ) ? -(int64_t) (value - 1) - 1 : (int64_t) value;
+    return UFR_OK;
+}
+
+/**
+ * @brief Converte um numero real "[+-]digitos[.digitos][e[+-]digitos]", sem
+ * depender do locale. Guarda ate 18 digitos significativos, o suficiente para
+ * um double. Valores que estouram o double retornam UFR_ARGS_ERROR_RANGE.
+ *   ex1: "1.5e3" -> UFR_OK, 1500.0
+ *   ex2: "1,5", "1.5f", "nan" -> UFR_ARGS_ERROR_INVALID
+ * 
+ * @param[in] str texto do numero, sem '\0' obrigatorio
+ * @param[in] len quantidade de caracteres de str
+ * @param[out] out numero convertido
+ * @return int UFR_OK, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+static int ufr_args_parse_f64(const char* str, const size_t len, double* out) {
+    static const double pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    size_t i = 0;
+    bool neg = false;
+    if ( i < len && (str[i] == '-' || str[i] == '+') ) {
+        neg = ( str[i] == '-' );
+        i += 1;
+    }
+
+    // digitos, antes e depois do ponto
+    uint64_t mantissa = 0;
+    int exp10 = 0;
+    bool has_digit = false;
+    for (; i<len && str[i] >= '0' && str[i] <= '9'; i++) {
+        has_digit = true;
+        if ( mantissa < 1000000000000000000ULL ) {
+            mantissa = mantissa * 10 + (uint64_t) (str[i] - '0');
+        } else {
+            exp10 += 1;
+        }
+    }
+    if ( i < len && str[i] == '.' ) {
+        for (i+=1; i<len && str[i] >= '0' && str[i] <= '9'; i++) {
+            has_digit = true;
+            if ( mantissa < 1000000000000000000ULL ) {
+                mantissa = mantissa * 10 + (uint64_t) (str[i] - '0');
+                exp10 -= 1;
+            }
+        }
+    }
+    if ( has_digit == false ) {
+        return UFR_ARGS_ERROR_INVALID;
+    }
+
+    // expoente
+    if ( i < len && (str[i] == 'e' || str[i] == 'E') ) {
+        i += 1;
+        bool exp_neg = false;
+        if ( i < len && (str[i] == '-' || str[i] == '+') ) {
+            exp_neg = ( str[i] == '-' );
+            i += 1;
+        }
+        if ( i == len ) {
+            return UFR_ARGS_ERROR_INVALID;
+        }
+        int exp = 0;
+        for (; i<len && str[i] >= '0' && str[i] <= '9'; i++) {
+            if ( exp < 10000 ) {
+                exp = exp * 10 + (str[i] - '0');
+            }
+        }
+        exp10 += exp_neg ? -exp : exp;
+    }
+    if ( i != len ) {
+        return UFR_ARGS_ERROR_INVALID;
+    }
+
+    double value = (double) mantissa;
+    if ( mantissa != 0 ) {
+        while ( exp10 < -22 && value != 0.0 ) {
+            value /= 1e22;
+            exp10 += 22;
+        }
+        while ( exp10 > 22 && value <= DBL_MAX ) {
+            value *= 1e22;
+            exp10 -= 22;
+        }
+        if ( exp10 < 0 ) {
+            value /= pow10[ exp10 < -22 ? 22 : -exp10 ];
+        } else if ( exp10 > 0 ) {
+            value *= pow10[ exp10 > 22 ? 22 : exp10 ];
+        }
+        if ( value > DBL_MAX ) {
+            return UFR_ARGS_ERROR_RANGE;
+        }
+    }
+
+    *out = neg ? -value : value;
+    return UFR_OK;
+}
+
+/**
+ * @brief converte o texto para inteiro e para real, uma unica vez
+ */
+static void ufr_args_number_parse(const char* str, const size_t len, ufr_args_number_t* number) {
+    number->i64 = 0;
+    number->f64 = 0.0;
+    number->i64_status = (uint8_t) ufr_args_parse_i64(str, len, &number->i64);
+    number->f64_status = (uint8_t) ufr_args_parse_f64(str, len, &number->f64);
+}
+
+/**
+ * @brief converte o token indicado pelo span. Tokens com aspas sao copiados
+ * antes; tokens maiores que UFR_ARGS_NUMBER nao sao numeros.
+ */
+static void ufr_args_span_number(const char* text, const ufr_args_span_t* span, ufr_args_number_t* number) {
+    if ( span->quoted == false ) {
+        ufr_args_number_parse(&text[span->ini], span->len, number);
+    } else if ( span->len < UFR_ARGS_NUMBER ) {
+        char buffer[UFR_ARGS_NUMBER];
+        const size_t len = ufr_args_span_copy(text, span, buffer, sizeof(buffer));
+        ufr_args_number_parse(buffer, len, number);
+    } else {
+        number->i64 = 0;
+        number->f64 = 0.0;
+        number->i64_status = UFR_ARGS_ERROR_INVALID;
+        number->f64_status = UFR_ARGS_ERROR_INVALID;
+    }
+}
+
+/**
+ * @brief converte o valor de uma ocorrencia: literal, %s, %d ou %f. Com indice
+ * compilado, valores literais ja estao convertidos na entrada. O %s e sempre
+ * convertido de novo: o ponteiro e o texto podem mudar depois do compile.
+ * 
+ * @return false o valor nao e numero (%p ou outro tipo)
+ */
+static bool ufr_args_value_number(const ufr_args_t* args, const ufr_args_index_t* index, const uint32_t i_entry, const char type, const uint32_t slot, const ufr_args_span_t* value, ufr_args_number_t* number) {
+    if ( type == '\0' && i_entry != UFR_ARGS_NONE && index != NULL ) {
+        *number = index->entries[i_entry].number;
+        return true;
+    }
+
+    number->i64 = 0;
+    number->f64 = 0.0;
+    number->i64_status = UFR_ARGS_ERROR_INVALID;
+    number->f64_status = UFR_ARGS_ERROR_INVALID;
+    const item_t* arg = ufr_args_slot(args, slot);
+    if ( type == '\0' ) {
+        ufr_args_span_number(args->text, value, number);
+    } else if ( arg == NULL ) {
+        return type == 's' || type == 'd' || type == 'f';
+    } else if ( type == 's' ) {
+        if ( arg->str != NULL ) {
+            ufr_args_number_parse(arg->str, strlen(arg->str), number);
+        }
+    } else if ( type == 'd' ) {
+        number->i64 = arg->i32;
+        number->f64 = arg->i32;
+        number->i64_status = UFR_OK;
+        number->f64_status = UFR_OK;
+    } else if ( type == 'f' ) {
+        const double f64 = arg->f32;
+        number->f64 = f64;
+        number->f64_status = UFR_OK;
+        if ( f64 >= -9.2e18 && f64 <= 9.2e18 && (double) (int64_t) f64 == f64 ) {
+            number->i64 = (int64_t) f64;
+            number->i64_status = UFR_OK;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+//  UFR ARGS - Indice compilado
+// ============================================================================
+
+#define UFR_ARGS_HASH_INI 2166136261u
+#define UFR_ARGS_HASH_MUL 16777619u
+
+/**
+ * @brief hash FNV-1a de uma string terminada com '\0'
+ */
+static uint32_t ufr_args_hash(const char* text) {
+    uint32_t hash = UFR_ARGS_HASH_INI;
+    while ( *text != '\0' ) {
+        hash ^= (uint8_t) *text;
+        hash *= UFR_ARGS_HASH_MUL;
+        text += 1;
+    }
+    return hash;
+}
+
+/**
+ * @brief hash FNV-1a do token indicado pelo span, igual a ufr_args_hash do
+ * token copiado
+ */
+static uint32_t ufr_args_span_hash(const char* text, const ufr_args_span_t* span) {
+    const char* base = &text[span->ini];
+    uint32_t hash = UFR_ARGS_HASH_INI;
+    for (size_t i=0; i<span->len; i++) {
+        const char c = base[i];
+        if ( span->quoted && (c == '\'' || c == '\n') ) {
+            continue;
+        }
+        hash ^= (uint8_t) c;
+        hash *= UFR_ARGS_HASH_MUL;
+    }
+    return hash;
+}
+
+/**
+ * @brief monta a tabela hash nome -> primeira entrada. As entradas com o mesmo
+ * nome ficam encadeadas em ordem de aparicao no texto pelo campo next.
+ */
+static int ufr_args_index_build_table(ufr_args_index_t* index, const char* text) {
+    uint32_t size = 8;
+    while ( size < index->count * 2 ) {
+        size *= 2;
+    }
+    index->table = calloc(size, sizeof(uint32_t));
+    if ( index->table == NULL ) {
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+    index->mask = size - 1;
+
+    // percorre de tras para frente, assim a cabeca da lista e a primeira ocorrencia
+    char name[UFR_ARGS_TOKEN];
+    for (uint32_t i=index->count; i>0; i--) {
+        ufr_args_entry_t* entry = &index->entries[i-1];
+        ufr_args_span_copy(text, &entry->name, name, sizeof(name));
+        uint32_t pos = entry->hash & index->mask;
+        while ( index->table[pos] != 0 ) {
+            const ufr_args_entry_t* head = &index->entries[ index->table[pos]-1 ];
+            if ( head->hash == entry->hash && ufr_args_span_equal(text, &head->name, name) ) {
+                break;
+            }
+            pos = (pos + 1) & index->mask;
+        }
+        entry->next = (index->table[pos] == 0) ? UFR_ARGS_NONE : index->table[pos] - 1;
+        index->table[pos] = i;
+    }
+
+    return UFR_OK;
+}
+
+/**
+ * @brief procura a primeira entrada com o nome indicado
+ * 
+ * @return indice da entrada ou UFR_ARGS_NONE
+ */
+static uint32_t ufr_args_index_find(const ufr_args_index_t* index, const char* text, const char* name) {
+    const uint32_t hash = ufr_args_hash(name);
+    uint32_t pos = hash & index->mask;
+    while ( index->table[pos] != 0 ) {
+        const uint32_t i_entry = index->table[pos] - 1;
+        const ufr_args_entry_t* entry = &index->entries[i_entry];
+        if ( entry->hash == hash && ufr_args_span_equal(text, &entry->name, name) ) {
+            return i_entry;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return UFR_ARGS_NONE;
+}
+
+/**
+ * @brief libera o indice e os niveis filhos, mantendo os argumentos
+ */
+static void ufr_args_index_release(ufr_args_ext_t* ext) {
+    ufr_args_index_t* index = ext->index;
+    ext->index = NULL;
+    while ( index != NULL ) {
+        ufr_args_t* child = index->child;
+        free(index->table);
+        free(index->entries);
+        free(index);
+        if ( child == NULL ) {
+            break;
+        }
+        ufr_args_ext_t* child_ext = ufr_args_ext_find(child);
+        index = child_ext->index;
+        child_ext->index = NULL;
+        ufr_args_ext_put(child_ext);
+        free(child);
+    }
+}
+
+/**
+ * @brief Tokeniza args->text uma unica vez e monta uma tabela com as entradas
+ * "@nome valor". Depois disso, todos os getters consultam a tabela em vez de
+ * percorrer o texto. Um ufr_args_t nao compilado continua funcionando como
+ * antes, percorrendo o texto a cada consulta. As entradas apontam para o
+ * texto, que deve continuar valido enquanto o indice existir. Os valores
+ * literais sao convertidos para numero aqui, uma unica vez; os %s de arg[]
+ * sao lidos a cada consulta e podem mudar depois da compilacao.
+ *   ex: ufr_args_t args = {.text="@port %d @baud 9600", .arg[0].i32=80};
+ *       ufr_args_compile(&args);
+ *       ufr_args_geti(&args, "@port", 0) -> 80
+ *       ufr_args_free(&args);
+ * 
+ * @param[inout] args estrutura de argumentos variaveis
+ * @return int UFR_OK ou UFR_ARGS_ERROR_NOMEM
+ */
+int ufr_args_compile(ufr_args_t* args) {
+    ufr_args_ext_t* ext = ufr_args_ext_get(args);
+    if ( ext == NULL ) {
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+    ufr_args_index_release(ext);
+
+    ufr_args_index_t* index = calloc(1, sizeof(ufr_args_index_t));
+    if ( index == NULL ) {
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+
+    char head[3];
+    ufr_args_span_t span;
+    uint32_t entries_max = 0;
+    uint32_t i_token = 0;
+    uint32_t count_arg = 0;
+    size_t cursor = 0;
+    bool has_token = ufr_args_flex_span(args->text, &cursor, &span, ' ');
+    while ( has_token ) {
+        ufr_args_span_head(args->text, &span, head);
+        if ( head[0] != '@' ) {
+            if ( head[0] == '%' ) {
+                count_arg += 1;
+            }
+            has_token = ufr_args_flex_span(args->text, &cursor, &span, ' ');
+            i_token += 1;
+            continue;
+        }
+
+        // aumenta o vetor de entradas
+        if ( index->count == entries_max ) {
+            const uint32_t new_max = (entries_max == 0) ? 16 : entries_max * 2;
+            ufr_args_entry_t* new_entries = realloc(index->entries, new_max * sizeof(ufr_args_entry_t));
+            if ( new_entries == NULL ) {
+                free(index->entries);
+                free(index);
+                return UFR_ARGS_ERROR_NOMEM;
+            }
+            index->entries = new_entries;
+            entries_max = new_max;
+        }
+
+        // nome do argumento
+        ufr_args_entry_t* entry = &index->entries[index->count];
+        entry->name = span;
+        entry->hash = ufr_args_span_hash(args->text, &span);
+        entry->token = i_token;
+        entry->slot = count_arg;
+
+        // valor do argumento, o proximo token tambem pode ser um nome
+        has_token = ufr_args_flex_span(args->text, &cursor, &span, ' ');
+        i_token += 1;
+        if ( has_token ) {
+            ufr_args_span_head(args->text, &span, head);
+            entry->value = span;
+            entry->type = ufr_args_head_type(head);
+        } else {
+            entry->value.ini = cursor;
+            entry->value.len = 0;
+            entry->value.quoted = false;
+            entry->type = '\0';
+        }
+        if ( entry->type == '\0' ) {
+            ufr_args_span_number(args->text, &entry->value, &entry->number);
+        } else {
+            entry->number.i64 = 0;
+            entry->number.f64 = 0.0;
+            entry->number.i64_status = UFR_ARGS_ERROR_INVALID;
+            entry->number.f64_status = UFR_ARGS_ERROR_INVALID;
+        }
+        index->count += 1;
+    }
+
+    if ( ufr_args_index_build_table(index, args->text) != UFR_OK ) {
+        free(index->entries);
+        free(index);
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+
+    // success
+    ext->index = index;
+    return UFR_OK;
+}
+
+/**
+ * @brief libera o indice criado por ufr_args_compile e os argumentos alem de
+ * arg[6]. O ufr_args_t volta a consultar o texto diretamente. Sem estado
+ * externo (por exemplo, uma copia), nao faz nada.
+ * 
+ * @param[inout] args estrutura de argumentos variaveis
+ */
+void ufr_args_free(ufr_args_t* args) {
+    ufr_args_ext_t* ext = ufr_args_ext_find(args);
+    if ( ext == NULL ) {
+        return;
+    }
+    ufr_args_index_release(ext);
+    ufr_args_arena_free(ext);
+    ufr_args_ext_put(ext);
+}
+
+/**
+ * @brief monta o nivel seguinte a partir das entradas do nivel atual, sem
+ * tokenizar o texto de novo. Ficam as entradas com pelo menos dois '@' no nome
+ * (relativo ao nivel atual), com um '@' a menos na visao do nome. Valores que
+ * sao nomes descartados neste nivel ficam vazios, como em ufr_args_extract_level.
+ * 
+ * @return int UFR_OK ou UFR_ARGS_ERROR_NOMEM; *out fica NULL se o nivel e vazio
+ */
+static int ufr_args_index_child(const ufr_args_t* parent, const ufr_args_index_t* pindex, ufr_args_t** out) {
+    const char* text = parent->text;
+    *out = NULL;
+
+    uint32_t count = 0;
+    for (uint32_t i=0; i<pindex->count; i++) {
+        const ufr_args_span_t* name = &pindex->entries[i].name;
+        if ( name->len >= 2 && text[name->ini + 1] == '@' ) {
+            count += 1;
+        }
+    }
+    if ( count == 0 ) {
+        return UFR_OK;
+    }
+
+    ufr_args_t* child = malloc(sizeof(ufr_args_t));
+    ufr_args_index_t* index = calloc(1, sizeof(ufr_args_index_t));
+    ufr_args_entry_t* entries = malloc(count * sizeof(ufr_args_entry_t));
+    if ( child == NULL || index == NULL || entries == NULL ) {
+        free(entries);
+        free(index);
+        free(child);
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+
+    for (uint32_t i=0; i<pindex->count; i++) {
+        const ufr_args_entry_t* pentry = &pindex->entries[i];
+        if ( pentry->name.len < 2 || text[pentry->name.ini + 1] != '@' ) {
+            continue;
+        }
+
+        ufr_args_entry_t* entry = &entries[index->count];
+        *entry = *pentry;
+        entry->name.ini += 1;
+        entry->name.len -= 1;
+        entry->hash = ufr_args_span_hash(text, &entry->name);
+
+        ufr_args_span_t* value = &entry->value;
+        if ( value->quoted == false && value->len > 0 && text[value->ini] == '@' ) {
+            if ( value->len >= 2 && text[value->ini + 1] == '@' ) {
+                value->ini += 1;
+                value->len -= 1;
+            } else {
+                value->len = 0;
+            }
+        }
+        index->count += 1;
+    }
+
+    index->entries = entries;
+    if ( ufr_args_index_build_table(index, text) != UFR_OK ) {
+        free(entries);
+        free(index);
+        free(child);
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+
+    // o filho compartilha o texto; os argumentos sao lidos da raiz, assim
+    // escritas e o crescimento do vetor externo depois da compilacao valem
+    // para todos os niveis
+    index->level = pindex->level + 1;
+    index->root = ( pindex->root != NULL ) ? pindex->root : parent;
+    memset(child, 0, sizeof(ufr_args_t));
+    child->text = text;
+    ufr_args_ext_t* ext = ufr_args_ext_get(child);
+    if ( ext == NULL ) {
+        free(entries);
+        free(index->table);
+        free(index);
+        free(child);
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+    ext->index = index;
+    *out = child;
+    return UFR_OK;
+}
+
+/**
+ * @brief Compila todos os niveis do texto de uma vez. O texto e tokenizado uma
+ * unica vez; cada nivel e um ufr_args_t filho com um indice proprio, cujas
+ * entradas sao visoes do texto original sem os '@' do nivel. O resultado de
+ * ufr_args_child(args) equivale a compilar ufr_args_decrease_level(args->text),
+ * sem copia do texto. Os filhos leem os argumentos %d, %f, %s e %p pelo
+ * endereco de args, que nao pode ser movido enquanto a arvore existir; uma
+ * copia de args nao tem a arvore.
+ *   ex: ufr_args_t args = {.text="@new a @@new b @@@new c @@id 0"};
+ *       ufr_args_compile_tree(&args);
+ *       const ufr_args_t* l1 = ufr_args_child(&args);
+ *       ufr_args_gets(l1, buffer, "@new", "") -> "b"
+ *       ufr_args_geti(l1, "@id", -1) -> 0
+ *       ufr_args_gets(ufr_args_child(l1), buffer, "@new", "") -> "c"
+ *       ufr_args_free(&args);
+ * 
+ * @param[inout] args estrutura de argumentos variaveis
+ * @return int UFR_OK ou UFR_ARGS_ERROR_NOMEM
+ */
+int ufr_args_compile_tree(ufr_args_t* args) {
+    const int error = ufr_args_compile(args);
+    if ( error != UFR_OK ) {
+        return error;
+    }
+
+    ufr_args_ext_t* ext = ufr_args_ext_find(args);
+    ufr_args_t* level = args;
+    while ( level != NULL ) {
+        ufr_args_index_t* index = ufr_args_ext_find(level)->index;
+        ufr_args_t* child;
+        if ( ufr_args_index_child(level, index, &child) != UFR_OK ) {
+            ufr_args_index_release(ext);
+            return UFR_ARGS_ERROR_NOMEM;
+        }
+        index->child = child;
+        level = child;
+    }
+
+    // success
+    return UFR_OK;
+}
+
+/**
+ * @brief retorna o nivel seguinte de um ufr_args_t compilado por
+ * ufr_args_compile_tree. O filho pertence ao pai: nao deve ser liberado e vale
+ * ate ufr_args_free(pai).
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @return const ufr_args_t* nivel seguinte, ou NULL se nao existe
+ */
+const ufr_args_t* ufr_args_child(const ufr_args_t* args) {
+    const ufr_args_index_t* index = ufr_args_index(args);
+    if ( index == NULL ) {
+        return NULL;
+    }
+    return index->child;
+}
+
+// ============================================================================
+//  UFR ARGS - Busca
+// ============================================================================
+
+// estado da busca de um nome, com ou sem indice compilado
+typedef struct {
+    ufr_args_span_t value;
+    char type;
+    bool found;
+    uint32_t slot;
+    uint32_t count_arg;
+    size_t cursor;
+    uint32_t entry;
+    const ufr_args_index_t* index;  // indice de args, lido na primeira busca
+} ufr_args_match_t;
+
+static void ufr_args_match_init(ufr_args_match_t* match) {
+    match->type = '\0';
+    match->found = false;
+    match->slot = 0;
+    match->count_arg = 0;
+    match->cursor = 0;
+    match->entry = UFR_ARGS_NONE;
+    match->index = NULL;
+}
+
+/**
+ * @brief Procura a proxima ocorrencia de "name" seguida do seu valor. Os getters
+ * chamam novamente quando o valor encontrado nao serve para o tipo pedido, e a
+ * busca continua depois do valor, como no laco original sobre o texto.
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[inout] match estado da busca; value, type e slot recebem o valor
+ * @return true encontrou uma ocorrencia
+ * @return false fim do texto
+ */
+static bool ufr_args_match_next(const ufr_args_t* args, const char* name, ufr_args_match_t* match) {
+    // busca pelo indice compilado
+    if ( match->found == false && match->cursor == 0 ) {
+        match->index = ufr_args_index(args);
+    }
+    const ufr_args_index_t* index = match->index;
+    if ( index != NULL ) {
+        uint32_t i_entry;
+        if ( match->found == false ) {
+            i_entry = ufr_args_index_find(index, args->text, name);
+        } else {
+            // pula as ocorrencias que foram consumidas como valor da anterior
+            const uint32_t value_token = index->entries[match->entry].token + 1;
+            i_entry = index->entries[match->entry].next;
+            while ( i_entry != UFR_ARGS_NONE && index->entries[i_entry].token <= value_token ) {
+                i_entry = index->entries[i_entry].next;
+            }
+        }
+        if ( i_entry == UFR_ARGS_NONE ) {
+            return false;
+        }
+        const ufr_args_entry_t* entry = &index->entries[i_entry];
+        match->entry = i_entry;
+        match->found = true;
+        match->slot = entry->slot;
+        match->value = entry->value;
+        match->type = entry->type;
+        return true;
+    }
+
+    // busca percorrendo o texto
+    char head[3];
+    ufr_args_span_t span;
+    while( ufr_args_flex_span(args->text, &match->cursor, &span, ' ') ) {
+        // jump case word is not name
+        ufr_args_span_head(args->text, &span, head);
+        if ( head[0] != '@' ) {
+            if ( head[0] == '%' ) {
+                match->count_arg += 1;
+            }
+            continue;
+        }
+
+        // check if the name is correct
+        if ( ufr_args_span_equal(args->text, &span, name) ) {
+            if ( ufr_args_flex_span(args->text, &match->cursor, &match->value, ' ') ) {
+                ufr_args_span_head(args->text, &match->value, head);
+                match->type = ufr_args_head_type(head);
+            } else {
+                match->type = '\0';
+            }
+            match->found = true;
+            match->slot = match->count_arg;
+
+            // o valor consumido tambem ocupa um indice, como no ufr_args_compile
+            if ( match->type != '\0' ) {
+                match->count_arg += 1;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief copia o valor literal encontrado para um buffer pequeno, usado
+ * somente para converter numeros
+ */
+static const char* ufr_args_match_copy(const ufr_args_t* args, const ufr_args_match_t* match, char* buffer, const size_t size) {
+    ufr_args_span_copy(args->text, &match->value, buffer, size);
+    return buffer;
+}
+
+// ============================================================================
+//  UFR ARGS - Conversao dos valores
+// ============================================================================
+
+// resultado de ufr_args_resolve
+#define UFR_ARGS_RESOLVE_NEXT    0  // valor nao serve para o tipo, continua a busca
+#define UFR_ARGS_RESOLVE_VALUE   1  // valor convertido em out
+#define UFR_ARGS_RESOLVE_DEFAULT 2  // usa o valor padrao
+
+/**
+ * @brief usa o numero convertido por ufr_args_compile, quando a ocorrencia
+ * veio do indice e o texto e um numero valido. O %s nao fica na entrada e e
+ * convertido a cada consulta, com a mesma regra. Sem indice, os getters
+ * continuam com atoi/atof, que aceitam lixo no fim do texto.
+ */
+static bool ufr_args_match_cached(const ufr_args_t* args, const ufr_args_match_t* match, const char type, item_t* out) {
+    if ( match->entry == UFR_ARGS_NONE || match->index == NULL ) {
+        return false;
+    }
+    ufr_args_number_t parsed;
+    const ufr_args_number_t* number = &match->index->entries[match->entry].number;
+    if ( match->type == 's' ) {
+        const item_t* arg = ufr_args_slot(args, match->slot);
+        if ( arg == NULL || arg->str == NULL ) {
+            return false;
+        }
+        ufr_args_number_parse(arg->str, strlen(arg->str), &parsed);
+        number = &parsed;
+    }
+    if ( type == UFR_ARGS_TYPE_F ) {
+        if ( number->f64_status != UFR_OK ) {
+            return false;
+        }
+        out->f32 = (float) number->f64;
+        return true;
+    }
+    if ( number->i64_status != UFR_OK ) {
+        return false;
+    }
+    if ( type == UFR_ARGS_TYPE_U ) { out->u64 = (size_t) number->i64; }
+    else { out->i32 = (int) number->i64; }
+    return true;
+}
+
+/**
+ * @brief Converte o valor encontrado para o tipo pedido, com as mesmas regras
+ * de cada getter. Usado pelos getters e por ufr_args_get_many.
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] match ocorrencia encontrada
+ * @param[in] type UFR_ARGS_TYPE_U, UFR_ARGS_TYPE_I, UFR_ARGS_TYPE_F, UFR_ARGS_TYPE_P ou UFR_ARGS_TYPE_S
+ * @param[out] out valor convertido
+ * @param[inout] buffer local para copiar valores literais do tipo UFR_ARGS_TYPE_S
+ * @return int UFR_ARGS_RESOLVE_NEXT, UFR_ARGS_RESOLVE_VALUE ou UFR_ARGS_RESOLVE_DEFAULT
+ */
+static int ufr_args_resolve(const ufr_args_t* args, const ufr_args_match_t* match, const char type, item_t* out, char* buffer) {
+    char number[UFR_ARGS_NUMBER];
+    const item_t* arg = ufr_args_slot(args, match->slot);
+    if ( arg == NULL && match->type != '\0' ) {
+        // argumento nao preenchido: usa o valor padrao, exceto quando um
+        // valor de outro tipo seria pulado
+        const bool is_number = ( type == UFR_ARGS_TYPE_U || type == UFR_ARGS_TYPE_I || type == UFR_ARGS_TYPE_F );
+        if ( is_number && match->type != 'd' && match->type != 's' && match->type != 'f' ) {
+            return UFR_ARGS_RESOLVE_NEXT;
+        }
+        return UFR_ARGS_RESOLVE_DEFAULT;
+    }
+
+    switch (type) {
+        case UFR_ARGS_TYPE_U:
+        case UFR_ARGS_TYPE_I:
+        case UFR_ARGS_TYPE_F:
+            if ( match->type != '\0' ) {
+                if ( match->type == 'd' ) {
+                    if ( type == UFR_ARGS_TYPE_U ) { out->u64 = (size_t) arg->i32; }
+                    else if ( type == UFR_ARGS_TYPE_I ) { out->i32 = arg->i32; }
+                    else { out->f32 = arg->i32; }
+                } else if ( match->type == 's' ) {
+                    if ( ufr_args_match_cached(args, match, type, out) ) {
+                        return UFR_ARGS_RESOLVE_VALUE;
+                    }
+                    if ( type == UFR_ARGS_TYPE_U ) { out->u64 = (size_t) atoi(arg->str); }
+                    else if ( type == UFR_ARGS_TYPE_I ) { out->i32 = atoi(arg->str); }
+                    else { out->f32 = (float) atof(arg->str); }
+                } else if ( match->type == 'f' ) {
+                    if ( type == UFR_ARGS_TYPE_U ) { out->u64 = (size_t) arg->f32; }
+                    else if ( type == UFR_ARGS_TYPE_I ) { out->i32 = (int) arg->f32; }
+                    else { out->f32 = arg->f32; }
+                } else {
+                    return UFR_ARGS_RESOLVE_NEXT;
+                }
+            } else {
+                if ( ufr_args_match_cached(args, match, type, out) ) {
+                    return UFR_ARGS_RESOLVE_VALUE;
+                }
+                ufr_args_match_copy(args, match, number, sizeof(number));
+                if ( type == UFR_ARGS_TYPE_U ) { out->u64 = (size_t) atoi(number); }
+                else if ( type == UFR_ARGS_TYPE_I ) { out->i32 = atoi(number); }
+                else { out->f32 = (float) atof(number); }
+            }
+            return UFR_ARGS_RESOLVE_VALUE;
+
+        case UFR_ARGS_TYPE_P:
+            if ( match->type == '\0' ) {
+                return UFR_ARGS_RESOLVE_NEXT;
+            } else if ( match->type == 'p' ) {
+                out->ptr = arg->ptr;
+                return UFR_ARGS_RESOLVE_VALUE;
+            }
+            return UFR_ARGS_RESOLVE_DEFAULT;
+
+        case UFR_ARGS_TYPE_S:
+            if ( match->type == '\0' ) {
+                ufr_args_span_copy(args->text, &match->value, buffer, UFR_ARGS_TOKEN);
+                out->str = buffer;
+                return UFR_ARGS_RESOLVE_VALUE;
+            } else if ( match->type == 's' ) {
+                out->str = arg->str;
+                return UFR_ARGS_RESOLVE_VALUE;
+            }
+            return UFR_ARGS_RESOLVE_DEFAULT;
+    }
+
+    return UFR_ARGS_RESOLVE_DEFAULT;
+}
+
+/**
+ * @brief procura name e converte o primeiro valor que serve para o tipo
+ * 
+ * @return true valor encontrado em out
+ * @return false usar o valor padrao
+ */
+static bool ufr_args_get(const ufr_args_t* args, const char* name, const char type, item_t* out, char* buffer) {
+    ufr_args_match_t match;
+    ufr_args_match_init(&match);
+    while( ufr_args_match_next(args, name, &match) ) {
+        const int res = ufr_args_resolve(args, &match, type, out, buffer);
+        if ( res == UFR_ARGS_RESOLVE_VALUE ) {
+            return true;
+        } else if ( res == UFR_ARGS_RESOLVE_DEFAULT ) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief procura name e converte o valor de forma estrita, com os limites do
+ * tipo pedido. Valores %p sao pulados, como nos getters.
+ * 
+ * @return int UFR_OK, UFR_ARGS_ERROR_NOTFOUND, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+static int ufr_args_try_get(const ufr_args_t* args, const char* name, const char type, item_t* out) {
+    ufr_args_match_t match;
+    ufr_args_match_init(&match);
+    while( ufr_args_match_next(args, name, &match) ) {
+        if ( match.type == 'p' ) {
+            continue;
+        }
+        ufr_args_number_t number;
+        if ( ufr_args_value_number(args, match.index, match.entry, match.type, match.slot, &match.value, &number) == false ) {
+            return UFR_ARGS_ERROR_INVALID;
+        }
+
+        if ( type == UFR_ARGS_TYPE_F ) {
+            if ( number.f64_status != UFR_OK ) {
+                return number.f64_status;
+            }
+            if ( number.f64 > FLT_MAX || number.f64 < -FLT_MAX ) {
+                return UFR_ARGS_ERROR_RANGE;
+            }
+            out->f32 = (float) number.f64;
+            return UFR_OK;
+        }
+
+        if ( number.i64_status != UFR_OK ) {
+            return number.i64_status;
+        }
+        if ( type == UFR_ARGS_TYPE_U ) {
+            if ( number.i64 < 0 || (uint64_t) number.i64 > SIZE_MAX ) {
+                return UFR_ARGS_ERROR_RANGE;
+            }
+            out->u64 = (size_t) number.i64;
+        } else {
+            if ( number.i64 < INT_MIN || number.i64 > INT_MAX ) {
+                return UFR_ARGS_ERROR_RANGE;
+            }
+            out->i32 = (int) number.i64;
+        }
+        return UFR_OK;
+    }
+    return UFR_ARGS_ERROR_NOTFOUND;
+}
+
+// ============================================================================
+//  UFR ARGS - Getters
+// ============================================================================
+
+/**
+ * @brief retorna um número positivo do argumento indicado por name
+ *   ex1: ufr_args_getu({.text="@nome 'teste jjj hhh   ggggg' @pontos 10"}, "@pontos", 0) -> 10
+ *   ex2: ufr_args_getu({.text="@nome    teste    @pontos %d", .arg[0].i32=20}, "@pontos", 0) -> 20
+ *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0) -> 0
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
+ * @return size_t valor do argumento
+ */
+size_t ufr_args_getu(const ufr_args_t* args, const char* name, const size_t default_value) {
+    item_t value;
+    return ufr_args_get(args, name, UFR_ARGS_TYPE_U, &value, NULL) ? value.u64 : default_value;
+}
+
+/**
+ * @brief retorna um número positivo do argumento indicado por name
+ *   ex1: ufr_args_getu({.text="@nome teste @pontos 10"}, "@pontos", 0) -> 10
+ *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20}, "@pontos", 0) -> 20
+ *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0) -> 0
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
+ * @return size_t valor do argumento
+ */
+int ufr_args_geti(const ufr_args_t* args, const char* name, const int default_value) {
+    item_t value;
+    return ufr_args_get(args, name, UFR_ARGS_TYPE_I, &value, NULL) ? value.i32 : default_value;
+}
+
+/**
+ * @brief retorna um ponto flutuante do argumento indicado por name
+ *   ex1: ufr_args_getu({.text="@nome teste @pontos 10.5"}, "@pontos", 0) -> 10.5
+ *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20.5}, "@pontos", 0) -> 20.5
+ *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0.0) -> 0.0
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
+ * @return size_t valor do argumento
+ */
+float ufr_args_getf(const ufr_args_t* args, const char* name, const float default_value) {
+    item_t value;
+    return ufr_args_get(args, name, UFR_ARGS_TYPE_F, &value, NULL) ? value.f32 : default_value;
+}
+
+/**
+ * @brief retorna um ponteiro do argumento indicado por name
+ *   ex1: ufr_args_getp({.text="@nome teste @pontos %p", .arg[0].i32=0x1000}, "@pontos", NULL) -> 0x1000
  *   ex2: ufr_args_getp({.text="@nome teste"}, "@pontos", NULL) -> NULL
  * 
  * @param[in] args estrutura de argumentos variaveis
@@ -362,73 +1745,546 @@ const char* ufr_args_gets(const ufr_args_t* args, char* buffer, const char* name
  * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
  * @return size_t valor do argumento
  */
+const void* ufr_args_getp(const ufr_args_t* args, const char* name, const void* default_value) {
+    item_t value;
+    return ufr_args_get(args, name, UFR_ARGS_TYPE_P, &value, NULL) ? value.ptr : default_value;
+}
+
+/**
+ * @brief retorna uma string com o valor do argumento indicado por name
+ *   ex1: ufr_args_getu({.text="@nome teste @pontos 10.5"}, "@pontos", 0) -> 10.5
+ *   ex2: ufr_args_getu({.text="@nome teste @pontos %d", .arg[0].i32=20.5}, "@pontos", 0) -> 20.5
+ *   ex3: ufr_args_getu({.text="@nome teste"}, "@pontos", 0.0) -> 0.0
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[inout] buffer local de memoria para guardar a string do text
+ * @param[in] name nome do argumento
+ * @param[in] default_value valor padrão do argumento, caso ela não esteja no text
+ * @return const char* ponteiro para a string do valor do argumento
+ */
+const char* ufr_args_gets(const ufr_args_t* args, char* buffer, const char* name, const char* default_value) {
+    item_t value;
+    return ufr_args_get(args, name, UFR_ARGS_TYPE_S, &value, buffer) ? value.str : default_value;
+}
+
+/**
+ * @brief retorna a funcao construtora indicada por name: um %p passado em arg[]
+ * ou um plugin "lib:class", carregado por ufr_args_load_library
+ *   ex1: ufr_args_getfunc({.text="@new %p", .arg[0].ptr=func}, "gtw", "@new", NULL) -> func
+ *   ex2: ufr_args_getfunc({.text="@new posix:pipe"}, "gtw", "@new", NULL) -> ufr_gtw_posix_new_pipe
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] type tipo do plugin
+ * @param[in] name nome do argumento
+ * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
+ * @return void* funcao construtora, NULL se o plugin nao foi encontrado ou
+ *         se o valor tem UFR_ARGS_TOKEN caracteres ou mais
+ */
 void* ufr_args_getfunc(const ufr_args_t* args, const char* type, const char* name, void* default_value) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
-    while( ufr_args_flex(args->text, &cursor, token, sizeof(token)) ) {
-        // jump case word is not name
-        if ( token[0] != '@' ) {
-            if ( token[0] == '%' ) {
-                count_arg += 1;
+    ufr_args_match_t match;
+    ufr_args_match_init(&match);
+    while( ufr_args_match_next(args, name, &match) ) {
+        if ( match.type != '\0' ) {
+            const item_t* arg = ufr_args_slot(args, match.slot);
+            if ( match.type == 'p' && arg != NULL ) {
+                return arg->ptr;
+            } else {
+                return default_value;
+            }
+        } else {
+            char value[UFR_ARGS_TOKEN];
+            char dl_name[512];
+            char dl_class[512];
+            uint16_t dl_cursor = 0;
+            if ( match.value.len >= sizeof(value) ) {
+                // nome que nao cabe no buffer: falha em vez de truncar
+                return NULL;
+            }
+            ufr_args_span_copy(args->text, &match.value, value, sizeof(value));
+            ufr_args_flex_div(value, &dl_cursor, dl_name, sizeof(dl_name), ':');
+            if ( ufr_args_flex_div(value, &dl_cursor, dl_class, sizeof(dl_class), ':') == false ) {
+                dl_class[0] = '\0';
+            }
+            return ufr_args_load_library(type, dl_name, dl_class);
+        }
+    }
+
+    // not found, return default value
+    return default_value;
+}
+
+/**
+ * @brief Versao de ufr_args_getu que informa o erro em vez de retornar 0 ou o
+ * valor padrao. O valor e convertido sem locale e deve ser um inteiro completo
+ * e nao negativo. Com o indice compilado, a conversao ja foi feita no
+ * ufr_args_compile e a consulta e O(1).
+ *   ex1: ufr_args_try_getu({.text="@pontos 10"}, "@pontos", &out) -> UFR_OK, out=10
+ *   ex2: ufr_args_try_getu({.text="@pontos 10x"}, "@pontos", &out) -> UFR_ARGS_ERROR_INVALID
+ *   ex3: ufr_args_try_getu({.text="@pontos -1"}, "@pontos", &out) -> UFR_ARGS_ERROR_RANGE
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[out] out valor do argumento, alterado somente com UFR_OK
+ * @return int UFR_OK, UFR_ARGS_ERROR_NOTFOUND, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+int ufr_args_try_getu(const ufr_args_t* args, const char* name, size_t* out) {
+    item_t value;
+    const int error = ufr_args_try_get(args, name, UFR_ARGS_TYPE_U, &value);
+    if ( error == UFR_OK ) {
+        *out = value.u64;
+    }
+    return error;
+}
+
+/**
+ * @brief Versao de ufr_args_geti que informa o erro; o valor deve caber em int
+ *   ex1: ufr_args_try_geti({.text="@porta %d", .arg[0].i32=80}, "@porta", &out) -> UFR_OK, out=80
+ *   ex2: ufr_args_try_geti({.text="@porta 1.5"}, "@porta", &out) -> UFR_ARGS_ERROR_INVALID
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[out] out valor do argumento, alterado somente com UFR_OK
+ * @return int UFR_OK, UFR_ARGS_ERROR_NOTFOUND, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+int ufr_args_try_geti(const ufr_args_t* args, const char* name, int* out) {
+    item_t value;
+    const int error = ufr_args_try_get(args, name, UFR_ARGS_TYPE_I, &value);
+    if ( error == UFR_OK ) {
+        *out = value.i32;
+    }
+    return error;
+}
+
+/**
+ * @brief Versao de ufr_args_getf que informa o erro; o valor deve caber em float
+ *   ex1: ufr_args_try_getf({.text="@ganho 1.5e-3"}, "@ganho", &out) -> UFR_OK, out=0.0015
+ *   ex2: ufr_args_try_getf({.text="@ganho 1,5"}, "@ganho", &out) -> UFR_ARGS_ERROR_INVALID
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] name nome do argumento
+ * @param[out] out valor do argumento, alterado somente com UFR_OK
+ * @return int UFR_OK, UFR_ARGS_ERROR_NOTFOUND, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+ */
+int ufr_args_try_getf(const ufr_args_t* args, const char* name, float* out) {
+    item_t value;
+    const int error = ufr_args_try_get(args, name, UFR_ARGS_TYPE_F, &value);
+    if ( error == UFR_OK ) {
+        *out = value.f32;
+    }
+    return error;
+}
+
+// ============================================================================
+//  UFR ARGS - Varios argumentos
+// ============================================================================
+
+/**
+ * @brief compara o token indicado pelo span com uma string, na ordem de strcmp
+ */
+static int ufr_args_span_cmp(const char* text, const ufr_args_span_t* span, const char* str) {
+    if ( span->quoted ) {
+        char token[UFR_ARGS_TOKEN];
+        ufr_args_span_copy(text, span, token, sizeof(token));
+        return strcmp(token, str);
+    }
+    const int res = strncmp(&text[span->ini], str, span->len);
+    if ( res != 0 ) {
+        return res;
+    }
+    return ( str[span->len] == '\0' ) ? 0 : -1;
+}
+
+static int ufr_args_get_cmp(const void* a, const void* b) {
+    const ufr_args_get_t* item_a = *(const ufr_args_get_t* const*) a;
+    const ufr_args_get_t* item_b = *(const ufr_args_get_t* const*) b;
+    return strcmp(item_a->name, item_b->name);
+}
+
+/**
+ * @brief escreve o valor em out conforme o tipo
+ */
+static void ufr_args_store(const char type, void* out, const item_t* value) {
+    switch (type) {
+        case UFR_ARGS_TYPE_U: *(size_t*) out = value->u64; break;
+        case UFR_ARGS_TYPE_I: *(int*) out = value->i32; break;
+        case UFR_ARGS_TYPE_F: *(float*) out = value->f32; break;
+        case UFR_ARGS_TYPE_P: *(const void**) out = value->ptr; break;
+        case UFR_ARGS_TYPE_S: *(const char**) out = value->str; break;
+    }
+}
+
+static void ufr_args_get_store(ufr_args_get_t* item, const item_t* value) {
+    ufr_args_store(item->type, item->out, value);
+}
+
+/**
+ * @brief Le varios argumentos de uma vez. Cada item tem o nome, o tipo, o
+ * valor padrao e o ponteiro de saida. Os nomes sao ordenados e o texto e
+ * percorrido uma unica vez, procurando cada nome por busca binaria; com o
+ * indice compilado, cada item e uma consulta na tabela hash. O resultado de
+ * cada item e o mesmo do getter correspondente.
+ *   ex: int port; float timeout;
+ *       ufr_args_get_t items[] = {
+ *           {.name="@port", .type=UFR_ARGS_TYPE_I, .default_value.i32=80, .out=&port},
+ *           {.name="@timeout", .type=UFR_ARGS_TYPE_F, .default_value.f32=1.0, .out=&timeout},
+ *       };
+ *       ufr_args_get_many(&args, items, 2);
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[inout] items descritores dos argumentos; para UFR_ARGS_TYPE_S, buffer
+ *          recebe os valores literais e deve ter UFR_ARGS_TOKEN bytes
+ * @param[in] count quantidade de itens
+ * @return int quantidade de itens encontrados no texto
+ */
+int ufr_args_get_many(const ufr_args_t* args, ufr_args_get_t* items, const size_t count) {
+    int found = 0;
+
+    // com indice compilado cada busca ja e O(1)
+    if ( ufr_args_index(args) != NULL ) {
+        for (size_t i=0; i<count; i++) {
+            item_t value;
+            if ( ufr_args_get(args, items[i].name, items[i].type, &value, items[i].buffer) ) {
+                found += 1;
+            } else {
+                value = items[i].default_value;
+            }
+            ufr_args_get_store(&items[i], &value);
+        }
+        return found;
+    }
+
+    // ordena os itens pelo nome
+    ufr_args_get_t* sorted_local[32];
+    uint32_t skip_local[32];
+    uint8_t state_local[32];
+    ufr_args_get_t** sorted = sorted_local;
+    uint32_t* skip = skip_local;
+    uint8_t* state = state_local;
+    if ( count > 32 ) {
+        sorted = malloc(count * (sizeof(ufr_args_get_t*) + sizeof(uint32_t) + sizeof(uint8_t)));
+        if ( sorted == NULL ) {
+            return 0;
+        }
+        skip = (uint32_t*) &sorted[count];
+        state = (uint8_t*) &skip[count];
+    }
+    for (size_t i=0; i<count; i++) {
+        sorted[i] = &items[i];
+        skip[i] = 0;
+        state[i] = UFR_ARGS_RESOLVE_NEXT;
+    }
+    qsort(sorted, count, sizeof(ufr_args_get_t*), ufr_args_get_cmp);
+
+    // percorre o texto uma vez
+    char head[3];
+    ufr_args_span_t span;
+    ufr_args_match_t match;
+    ufr_args_match_init(&match);
+    uint32_t i_token = 0;
+    size_t pending = count;
+    size_t cursor = 0;
+    while( pending > 0 && ufr_args_flex_span(args->text, &cursor, &span, ' ') ) {
+        i_token += 1;
+        ufr_args_span_head(args->text, &span, head);
+        if ( head[0] != '@' ) {
+            if ( head[0] == '%' ) {
+                match.count_arg += 1;
             }
             continue;
         }
 
-        // check if the name is correct
-        if ( strcmp(name, token) == 0 ) {
-            ufr_args_flex(args->text, &cursor, token, sizeof(token));
-            if ( token[0] == '%' ) {
-                if ( token[1] == 'p' ) {
-                    return args->arg[count_arg].ptr;
-                } else {
-                    return default_value;
-                }
+        // busca binaria pelo primeiro item com o nome
+        size_t ini = 0;
+        size_t end = count;
+        while ( ini < end ) {
+            const size_t mid = (ini + end) / 2;
+            if ( ufr_args_span_cmp(args->text, &span, sorted[mid]->name) > 0 ) {
+                ini = mid + 1;
             } else {
-#if __linux__
-/*
-                char dl_name[512];
-                char dl_class[512];
-                uint16_t dl_cursor = 0;
-                ufr_args_flex_div(token, &dl_cursor, dl_name, sizeof(dl_name), ':');
-                ufr_args_flex_div(token, &dl_cursor, dl_class, sizeof(dl_class), ':');
-                return ufr_linux_load_library(type, dl_name, dl_class);
-*/
-                return NULL;
-#else
-                return NULL;
-#endif
+                end = mid;
+            }
+        }
+        if ( ini == count || ufr_args_span_cmp(args->text, &span, sorted[ini]->name) != 0 ) {
+            continue;
+        }
+
+        // o valor e o proximo token, que continua sendo lido como token normal
+        size_t value_cursor = cursor;
+        if ( ufr_args_flex_span(args->text, &value_cursor, &match.value, ' ') ) {
+            ufr_args_span_head(args->text, &match.value, head);
+            match.type = ufr_args_head_type(head);
+        } else {
+            match.type = '\0';
+        }
+        match.slot = match.count_arg;
+
+        for (size_t i=ini; i<count && strcmp(sorted[i]->name, sorted[ini]->name) == 0; i++) {
+            // pendente e nao consumido como valor da ocorrencia anterior
+            if ( state[i] != UFR_ARGS_RESOLVE_NEXT || i_token <= skip[i] ) {
+                continue;
+            }
+            item_t value;
+            state[i] = ufr_args_resolve(args, &match, sorted[i]->type, &value, sorted[i]->buffer);
+            if ( state[i] == UFR_ARGS_RESOLVE_VALUE ) {
+                ufr_args_get_store(sorted[i], &value);
+                found += 1;
+                pending -= 1;
+            } else if ( state[i] == UFR_ARGS_RESOLVE_DEFAULT ) {
+                pending -= 1;
+            } else {
+                skip[i] = i_token + 1;
             }
         }
     }
 
-    // not found, return default value
-    return default_value;
+    // itens sem valor recebem o padrao
+    for (size_t i=0; i<count; i++) {
+        if ( state[i] != UFR_ARGS_RESOLVE_VALUE ) {
+            ufr_args_get_store(sorted[i], &sorted[i]->default_value);
+        }
+    }
+
+    if ( sorted != sorted_local ) {
+        free(sorted);
+    }
+    return found;
+}
+
+// ============================================================================
+//  UFR ARGS - Esquemas
+// ============================================================================
+
+/**
+ * @brief Le todos os campos de um esquema em uma passada pelo texto. O nome
+ * de cada token '@' e identificado por schema->lookup, gerado pelas macros
+ * UFR_ARGS_SCHEMA_*, sem comparar com cada nome do esquema. Cada campo recebe
+ * o mesmo valor do getter correspondente, ou o valor padrao.
+ *   ex: ver UFR_ARGS_SCHEMA_DEFINE em ufr_args.h
+ * 
+ * @param[in] args estrutura de argumentos variaveis
+ * @param[in] schema campos e funcao de busca dos nomes
+ * @param[out] out estrutura gerada pelo esquema
+ * @return int quantidade de campos encontrados no texto
+ */
+int ufr_args_parse(const ufr_args_t* args, const ufr_args_schema_t* schema, void* out) {
+    char* base = (char*) out;
+    const size_t count = schema->count;
+    int found = 0;
+
+    // com indice compilado cada busca ja e O(1)
+    if ( ufr_args_index(args) != NULL ) {
+        for (size_t i=0; i<count; i++) {
+            const ufr_args_field_t* field = &schema->fields[i];
+            item_t value;
+            if ( ufr_args_get(args, field->name, field->type, &value, &base[field->buffer]) ) {
+                found += 1;
+            } else {
+                value = field->default_value;
+            }
+            ufr_args_store(field->type, &base[field->offset], &value);
+        }
+        return found;
+    }
+
+    uint32_t skip_local[32];
+    uint8_t state_local[32];
+    uint32_t* skip = skip_local;
+    uint8_t* state = state_local;
+    if ( count > 32 ) {
+        skip = malloc(count * (sizeof(uint32_t) + sizeof(uint8_t)));
+        if ( skip == NULL ) {
+            return 0;
+        }
+        state = (uint8_t*) &skip[count];
+    }
+    for (size_t i=0; i<count; i++) {
+        skip[i] = 0;
+        state[i] = UFR_ARGS_RESOLVE_NEXT;
+    }
+
+    // percorre o texto uma vez
+    char head[3];
+    char name[UFR_ARGS_TOKEN];
+    ufr_args_span_t span;
+    ufr_args_match_t match;
+    ufr_args_match_init(&match);
+    uint32_t i_token = 0;
+    size_t pending = count;
+    size_t cursor = 0;
+    while( pending > 0 && ufr_args_flex_span(args->text, &cursor, &span, ' ') ) {
+        i_token += 1;
+        ufr_args_span_head(args->text, &span, head);
+        if ( head[0] != '@' ) {
+            if ( head[0] == '%' ) {
+                match.count_arg += 1;
+            }
+            continue;
+        }
+
+        // nome com aspas precisa ser copiado antes da busca
+        int i;
+        if ( span.quoted ) {
+            const size_t len = ufr_args_span_copy(args->text, &span, name, sizeof(name));
+            i = schema->lookup(name, len);
+        } else {
+            i = schema->lookup(&args->text[span.ini], span.len);
+        }
+        if ( i < 0 || state[i] != UFR_ARGS_RESOLVE_NEXT || i_token <= skip[i] ) {
+            continue;
+        }
+
+        // o valor e o proximo token, que continua sendo lido como token normal
+        size_t value_cursor = cursor;
+        if ( ufr_args_flex_span(args->text, &value_cursor, &match.value, ' ') ) {
+            ufr_args_span_head(args->text, &match.value, head);
+            match.type = ufr_args_head_type(head);
+        } else {
+            match.type = '\0';
+        }
+        match.slot = match.count_arg;
+
+        const ufr_args_field_t* field = &schema->fields[i];
+        item_t value;
+        state[i] = ufr_args_resolve(args, &match, field->type, &value, &base[field->buffer]);
+        if ( state[i] == UFR_ARGS_RESOLVE_VALUE ) {
+            ufr_args_store(field->type, &base[field->offset], &value);
+            found += 1;
+            pending -= 1;
+        } else if ( state[i] == UFR_ARGS_RESOLVE_DEFAULT ) {
+            pending -= 1;
+        } else {
+            skip[i] = i_token + 1;
+        }
+    }
+
+    // campos sem valor recebem o padrao
+    for (size_t i=0; i<count; i++) {
+        if ( state[i] != UFR_ARGS_RESOLVE_VALUE ) {
+            const ufr_args_field_t* field = &schema->fields[i];
+            ufr_args_store(field->type, &base[field->offset], &field->default_value);
+        }
+    }
+
+    if ( skip != skip_local ) {
+        free(skip);
+    }
+    return found;
 }
 
+// ============================================================================
+//  UFR ARGS - Niveis
+// ============================================================================
+
 /**
- * @brief converte os valores de uma lista de va_list para ufr_args
+ * @brief Preenche os argumentos de ufr_args com os valores de uma va_list, em
+ * uma unica passada pelo texto. Cada token que comeca com '%' ocupa um indice,
+ * como nos getters: %d le um int, %f um double (float promovido), %s um
+ * const char* e %p um void*. Outros tipos ocupam o indice sem ler da lista.
+ * Depois do setimo, os argumentos vao para o vetor externo, liberado por
+ * ufr_args_free. O estado externo que ainda estiver no endereco de args
+ * (indice ou argumentos de um uso anterior) e liberado antes.
+ *   ex: ufr_args_load_from_va(&args, "@port %d @gain %f @topic %s", list)
+ * 
  * @param[out] args estrutura de argumentos variaveis
- * @param[in] name nome do argumento
- * @param[in] default_value valor padrão do argumento, caso ela não esteja na frase
- * @return size_t valor do argumento
+ * @param[in] text texto dos argumentos, deve continuar valido enquanto args existir
+ * @param[in] list valores na ordem dos '%' do texto
+ * @return int UFR_OK ou UFR_ARGS_ERROR_NOMEM
  */
-void ufr_args_load_from_va(ufr_args_t* args, const char* text, va_list list) {
-    char token[512];
-    uint8_t  count_arg = 0;
-    uint16_t cursor = 0;
+int ufr_args_load_from_va(ufr_args_t* args, const char* text, va_list list) {
+    char head[3];
+    ufr_args_span_t span;
+    uint32_t count_arg = 0;
+    size_t cursor = 0;
+    int error = UFR_OK;
+    ufr_args_free(args);
+    args->text = text;
 
     // for each word in the text
-    while( ufr_args_flex(text, &cursor, token, sizeof(token)) ) {
-        if ( token[0] == '%' && token[1] == 'p' ) {               
-            void* ptr = va_arg(list, void*);
-            args->arg[ count_arg ].ptr = ptr;
-            count_arg += 1;
+    while( ufr_args_flex_span(text, &cursor, &span, ' ') ) {
+        ufr_args_span_head(text, &span, head);
+        if ( head[0] != '%' ) {
+            continue;
+        }
+        item_t value;
+        value.u64 = 0;
+        switch ( head[1] ) {
+            case 'd': value.i32 = va_arg(list, int); break;
+            case 'f': value.f32 = (float) va_arg(list, double); break;
+            case 's': value.str = va_arg(list, const char*); break;
+            case 'p': value.ptr = va_arg(list, void*); break;
+            default: break;
+        }
+
+        // continua lendo a lista mesmo sem memoria, para nao desalinhar
+        item_t* arg = ufr_args_arg(args, count_arg);
+        if ( arg != NULL ) {
+            *arg = value;
+        } else {
+            error = UFR_ARGS_ERROR_NOMEM;
         }
+        count_arg += 1;
     }
 
     // success
-    args->text = text;
+    return error;
+}
+
+/**
+ * @brief Extrai um nivel das variaveis de um texto, em uma unica passada
+ *   ex1: level=1, "@new teste @path file @@new opencv @@id 0" -> "@new opencv @id 0 "
+ *   ex2: level=2, "@new a @@new b @@@new c @@@@id 0" -> "@new c @@id 0 "
+ * 
+ * @param[in] src texto dos argumentos variaveis
+ * @param[in] level numero de '@' removidos de cada nome; nomes com level ou
+ *                  menos '@' sao ignorados junto com os seus valores
+ * @param[out] dst texto do nivel extraido, cada token seguido de espaco
+ * @param[in] dst_max tamanho de dst, incluindo o '\0'
+ * @return int UFR_OK, ou UFR_ARGS_ERROR_NOMEM se dst nao couber o resultado
+ *             (dst fica com os tokens que couberam)
+ */
+int ufr_args_extract_level(const char* src, const int level, char* dst, const size_t dst_max) {
+    if ( dst_max == 0 ) {
+        return UFR_ARGS_ERROR_NOMEM;
+    }
+
+    const size_t n_level = ( level > 0 ) ? (size_t) level : 0;
+    ufr_args_span_t span;
+    size_t i_dst = 0;
+    size_t cursor = 0;
+    bool ignore = ( n_level > 0 );
+    while( ufr_args_flex_span(src, &cursor, &span, ' ') ) {
+        // conta os '@' do nome; valores herdam a decisao do ultimo nome
+        size_t skip = 0;
+        if ( span.quoted == false && src[span.ini] == '@' ) {
+            size_t count = 1;
+            while ( count < span.len && src[span.ini + count] == '@' ) {
+                count += 1;
+            }
+            ignore = ( count <= n_level );
+            skip = n_level;
+        }
+        if ( ignore ) {
+            continue;
+        }
+
+        // token + espaco + '\0'; para texto com aspas, span.len e o maximo
+        const size_t len = span.len - skip;
+        if ( len + 2 > dst_max - i_dst ) {
+            dst[i_dst] = '\0';
+            return UFR_ARGS_ERROR_NOMEM;
+        }
+        if ( span.quoted == false ) {
+            memcpy(&dst[i_dst], &src[span.ini + skip], len);
+            i_dst += len;
+        } else {
+            i_dst += ufr_args_span_copy(src, &span, &dst[i_dst], len + 1);
+        }
+        dst[i_dst] = ' ';
+        i_dst += 1;
+    }
+
+    dst[i_dst] = '\0';
+    return UFR_OK;
 }
 
 /**
@@ -436,34 +2292,226 @@ void ufr_args_load_from_va(ufr_args_t* args, const char* text, va_list list) {
  *   ex1: "@new teste @path file @@new opencv @@id 0" -> "@new opencv @id 0"
  * 
  * @param[in] src texto dos argumentos variaveis
- * @param[out] dst texto com somente os argumentos de nivel superior
+ * @param[out] dst texto com somente os argumentos de nivel superior, com
+ *                 espaco para strlen(src) + 2 bytes; com um limite menor,
+ *                 use ufr_args_extract_level(src, 1, dst, dst_max)
  * @return int 0 -> OK
  */
 int ufr_args_decrease_level(const char* src, char* dst) {
-    dst[0] = '\0';
-    char token[512];
-    uint8_t count_arg = 0;
-    uint16_t cursor = 0;
-    bool ignore = true;
-    while( ufr_args_flex(src, &cursor, token, sizeof(token)) ) {
-        // uint32_t len = strlen(token);
-        // if ( len > 2 ) {
-        if ( token[0] == '@' ) {
-            if ( token[1] == '@' ) {
-                strcat(dst, &token[1]);
-                strcat(dst, " ");
-                ignore = false;
-            } else {
-                ignore = true;
-            }
+    return ufr_args_extract_level(src, 1, dst, strlen(src) + 2);
+}
+
+// ============================================================================
+//  UFR ARGS - Bibliotecas
+// ============================================================================
+
+#if __linux__
+
+// biblioteca aberta, compartilhada por todas as classes dela
+typedef struct {
+    char* name;         // "type_lib"
+    void* handle;
+} ufr_args_library_t;
+
+// simbolo ja resolvido, chave (type, lib, class)
+typedef struct {
+    char* key;          // "type\0lib\0class"
+    size_t key_len;
+    uint32_t hash;
+    void* func;
+} ufr_args_symbol_t;
+
+static pthread_mutex_t g_library_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ufr_args_library_t* g_libraries = NULL;
+static size_t g_libraries_count = 0;
+static ufr_args_symbol_t* g_symbols = NULL;
+static size_t g_symbols_count = 0;
+
+/**
+ * @brief retorna o handle de libufr_{type}_{lib}.so, abrindo a biblioteca so
+ * na primeira vez. Chamado com g_library_mutex travado.
+ */
+static void* ufr_args_library_open(const char* type, const char* lib) {
+    char name[1024];
+    const int name_len = snprintf(name, sizeof(name), "%s_%s", type, lib);
+    if ( name_len < 0 || (size_t) name_len >= sizeof(name) ) {
+        return NULL;
+    }
+    for (size_t i=0; i<g_libraries_count; i++) {
+        if ( strcmp(g_libraries[i].name, name) == 0 ) {
+            return g_libraries[i].handle;
+        }
+    }
+
+    // "libufr_" + name + ".so"
+    char filename[sizeof(name) + 10];
+    snprintf(filename, sizeof(filename), "libufr_%s.so", name);
+    void* handle = dlopen(filename, RTLD_LAZY);
+    if ( handle == NULL ) {
+        fprintf(stderr, "%s\n", dlerror());
+        return NULL;
+    }
+
+    ufr_args_library_t* new_libraries = realloc(g_libraries, (g_libraries_count + 1) * sizeof(ufr_args_library_t));
+    char* new_name = strdup(name);
+    if ( new_libraries == NULL || new_name == NULL ) {
+        g_libraries = ( new_libraries != NULL ) ? new_libraries : g_libraries;
+        free(new_name);
+        dlclose(handle);
+        return NULL;
+    }
+    g_libraries = new_libraries;
+    g_libraries[g_libraries_count].name = new_name;
+    g_libraries[g_libraries_count].handle = handle;
+    g_libraries_count += 1;
+    return handle;
+}
+
+/**
+ * @brief Carrega o construtor de uma classe de plugin. O simbolo
+ * ufr_{type}_{lib}_new_{class} e procurado em libufr_{type}_{lib}.so; sem
+ * classe, o simbolo e ufr_{type}_{lib}_new. Os handles do dlopen e os simbolos
+ * resolvidos ficam em um cache do processo, entao as proximas chamadas com a
+ * mesma chave nao chamam dlopen nem dlsym. Seguro para varias threads.
+ *   ex: ufr_args_load_library("gtw", "posix", "pipe")
+ *       -> ufr_gtw_posix_new_pipe de libufr_gtw_posix.so
+ * 
+ * @param[in] type tipo do plugin (ex: "gtw", "enc", "dcr")
+ * @param[in] lib nome da biblioteca
+ * @param[in] classname nome da classe, ou "" para o construtor padrao
+ * @return void* ponteiro da funcao, ou NULL se nao encontrou
+ */
+void* ufr_args_load_library(const char* type, const char* lib, const char* classname) {
+    const size_t type_len = strlen(type);
+    const size_t lib_len = strlen(lib);
+    const size_t class_len = strlen(classname);
+    const size_t key_len = type_len + lib_len + class_len + 3;
+    char key[1024];
+    if ( key_len > sizeof(key) ) {
+        return NULL;
+    }
+    memcpy(key, type, type_len + 1);
+    memcpy(&key[type_len + 1], lib, lib_len + 1);
+    memcpy(&key[type_len + lib_len + 2], classname, class_len + 1);
+
+    // FNV-1a da chave inteira, com os separadores
+    uint32_t hash = 2166136261u;
+    for (size_t i=0; i<key_len; i++) {
+        hash = (hash ^ (uint8_t) key[i]) * 16777619u;
+    }
+
+    pthread_mutex_lock(&g_library_mutex);
+    for (size_t i=0; i<g_symbols_count; i++) {
+        const ufr_args_symbol_t* symbol = &g_symbols[i];
+        if ( symbol->hash == hash && symbol->key_len == key_len && memcmp(symbol->key, key, key_len) == 0 ) {
+            void* func = symbol->func;
+            pthread_mutex_unlock(&g_library_mutex);
+            return func;
+        }
+    }
+
+    // primeira chamada para a chave
+    void* func = NULL;
+    void* handle = ufr_args_library_open(type, lib);
+    if ( handle != NULL ) {
+        char func_name[1024];
+        int func_len;
+        if ( class_len > 0 ) {
+            func_len = snprintf(func_name, sizeof(func_name), "ufr_%s_%s_new_%s", type, lib, classname);
         } else {
-            if ( ignore == false ) {
-                strcat(dst, token);
-                strcat(dst, " ");
+            func_len = snprintf(func_name, sizeof(func_name), "ufr_%s_%s_new", type, lib);
+        }
+        if ( func_len >= 0 && (size_t) func_len < sizeof(func_name) ) {
+            func = dlsym(handle, func_name);
+            if ( func == NULL ) {
+                fprintf(stderr, "%s\n", dlerror());
             }
         }
+    }
 
+    // so guarda os simbolos encontrados
+    if ( func != NULL ) {
+        ufr_args_symbol_t* new_symbols = realloc(g_symbols, (g_symbols_count + 1) * sizeof(ufr_args_symbol_t));
+        char* new_key = malloc(key_len);
+        if ( new_symbols != NULL ) {
+            g_symbols = new_symbols;
+        }
+        if ( new_symbols != NULL && new_key != NULL ) {
+            memcpy(new_key, key, key_len);
+            g_symbols[g_symbols_count].key = new_key;
+            g_symbols[g_symbols_count].key_len = key_len;
+            g_symbols[g_symbols_count].hash = hash;
+            g_symbols[g_symbols_count].func = func;
+            g_symbols_count += 1;
+        } else {
+            free(new_key);
+        }
     }
+    pthread_mutex_unlock(&g_library_mutex);
+    return func;
+}
 
-    return UFR_OK;
+/**
+ * @brief Carrega uma lista de plugins no inicio do programa, assim a primeira
+ * construcao de cada um ja encontra o simbolo no cache.
+ *   ex: ufr_args_preload_libraries("gtw", "posix:pipe posix:file zmq:topic")
+ * 
+ * @param[in] type tipo dos plugins
+ * @param[in] text lista de "lib:class" separados por espaco
+ * @return int quantidade de plugins que nao foram encontrados
+ */
+int ufr_args_preload_libraries(const char* type, const char* text) {
+    int errors = 0;
+    char value[UFR_ARGS_TOKEN];
+    char dl_name[512];
+    char dl_class[512];
+    size_t cursor = 0;
+    while ( ufr_args_flex_sz(text, &cursor, value, sizeof(value)) ) {
+        uint16_t dl_cursor = 0;
+        ufr_args_flex_div(value, &dl_cursor, dl_name, sizeof(dl_name), ':');
+        if ( ufr_args_flex_div(value, &dl_cursor, dl_class, sizeof(dl_class), ':') == false ) {
+            dl_class[0] = '\0';
+        }
+        if ( ufr_args_load_library(type, dl_name, dl_class) == NULL ) {
+            errors += 1;
+        }
+    }
+    return errors;
 }
+
+/**
+ * @brief Esvazia o cache e fecha as bibliotecas. Os ponteiros retornados antes
+ * deixam de ser validos; use somente no fim do programa ou em testes.
+ */
+void ufr_args_unload_libraries() {
+    pthread_mutex_lock(&g_library_mutex);
+    for (size_t i=0; i<g_symbols_count; i++) {
+        free(g_symbols[i].key);
+    }
+    for (size_t i=0; i<g_libraries_count; i++) {
+        dlclose(g_libraries[i].handle);
+        free(g_libraries[i].name);
+    }
+    free(g_symbols);
+    free(g_libraries);
+    g_symbols = NULL;
+    g_symbols_count = 0;
+    g_libraries = NULL;
+    g_libraries_count = 0;
+    pthread_mutex_unlock(&g_library_mutex);
+}
+
+#else
+
+void* ufr_args_load_library(const char* type, const char* lib, const char* classname) {
+    return NULL;
+}
+
+int ufr_args_preload_libraries(const char* type, const char* text) {
+    return 0;
+}
+
+void ufr_args_unload_libraries() {
+}
+
+#endif
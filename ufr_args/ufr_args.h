@@ -34,6 +34,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
 
 struct _link;
 #define UFR_OK 0
@@ -55,17 +57,90 @@ typedef union {
     int         (*func)(struct _link*, int);
 } item_t;
 
-// 64 bytes for #64
+// token como visao do texto original, sem copia
+typedef struct {
+    size_t   ini;       // posicao do primeiro caractere do token no texto
+    size_t   len;       // quantidade de caracteres do texto ocupados pelo token
+    bool     quoted;    // o token tem aspas ou '\n', que nao fazem parte da palavra
+} ufr_args_span_t;
+
+#define UFR_ARGS_INLINE 7
+
+// 64 bytes: text + arg[7], o caminho rapido. O indice de ufr_args_compile e os
+// argumentos alem de arg[6] ficam fora da estrutura, em uma tabela pelo
+// endereco do ufr_args_t:
+//  - libere com ufr_args_free quando usar ufr_args_compile, _compile_tree,
+//    ufr_args_arg alem de arg[6] ou ufr_args_load_from_va
+//  - uma copia le so o texto e arg[], sem o indice e sem os argumentos
+//    externos; liberar a copia nao mexe no original
+//  - trocar args->text descarta o estado externo, que vale para o texto
+//    com que foi criado
+//  - os niveis de _compile_tree leem os argumentos pelo endereco da raiz,
+//    que nao pode ser movida enquanto a arvore existir
 typedef struct {
     const char* text;
-    item_t arg[7];
+    item_t arg[UFR_ARGS_INLINE];
 } ufr_args_t;
 
+// argumentos %d, %f, %s e %p a partir do indice UFR_ARGS_INLINE
+typedef struct _ufr_args_spill {
+    uint32_t count;
+    uint32_t max;
+    item_t arg[];
+} ufr_args_spill_t;
+
+// ============================================================================
+//  UFR ARGS - Indice compilado
+// ============================================================================
+
+#define UFR_ARGS_ERROR_NOMEM    1
+#define UFR_ARGS_ERROR_NOTFOUND 2   // nome nao existe no texto
+#define UFR_ARGS_ERROR_INVALID  3   // valor nao e um numero do tipo pedido
+#define UFR_ARGS_ERROR_RANGE    4   // numero fora do intervalo do tipo pedido
+#define UFR_ARGS_NONE 0xFFFFFFFF
+
+// numero convertido uma unica vez, pelo ufr_args_compile
+typedef struct {
+    int64_t  i64;
+    double   f64;
+    uint8_t  i64_status;    // UFR_OK, UFR_ARGS_ERROR_INVALID ou UFR_ARGS_ERROR_RANGE
+    uint8_t  f64_status;
+} ufr_args_number_t;
+
+// argumento "@nome valor" ja tokenizado
+typedef struct {
+    ufr_args_span_t name;
+    ufr_args_span_t value;
+    uint32_t hash;      // hash do nome
+    uint32_t token;     // posicao do nome na sequencia de tokens
+    uint32_t next;      // proxima entrada com o mesmo nome ou UFR_ARGS_NONE
+    uint32_t slot;      // indice em arg[] quando o valor e %d, %s, %f ou %p
+    char     type;      // 'd', 's', 'f', 'p' ou '\0' para valor literal
+    ufr_args_number_t number;   // valor literal convertido
+} ufr_args_entry_t;
+
+typedef struct _ufr_args_index {
+    uint32_t count;
+    uint32_t mask;
+    uint32_t* table;    // hash -> primeira entrada do nome + 1 (0 = vazio)
+    ufr_args_entry_t* entries;
+    uint32_t level;     // quantidade de '@' removidos dos nomes deste nivel
+    ufr_args_t* child;  // proximo nivel, criado por ufr_args_compile_tree, ou NULL
+    const ufr_args_t* root;     // dono de arg[] e do vetor externo nos niveis filhos, ou NULL
+} ufr_args_index_t;
+
 // ============================================================================
 //  UFR ARGS
 // ============================================================================
 
 #define UFR_ARGS_TOKEN 512
+#define UFR_ARGS_NUMBER 64
+
+// implementacoes da busca de delimitadores do tokenizador
+#define UFR_ARGS_SIMD_AUTO   -1
+#define UFR_ARGS_SIMD_SCALAR  0
+#define UFR_ARGS_SIMD_SSE2    1
+#define UFR_ARGS_SIMD_AVX2    2
 
 size_t ufr_args_getu(const ufr_args_t* args, const char* noun, const size_t default_value);
 int    ufr_args_geti(const ufr_args_t* args, const char* noun, const int default_value);
@@ -76,9 +151,204 @@ const char* ufr_args_gets(const ufr_args_t* args, char* buffer, const char* noun
 
 void* ufr_args_getfunc(const ufr_args_t* args, const char* type, const char* noun, void* default_value);
 
+int ufr_args_try_getu(const ufr_args_t* args, const char* noun, size_t* out);
+int ufr_args_try_geti(const ufr_args_t* args, const char* noun, int* out);
+int ufr_args_try_getf(const ufr_args_t* args, const char* noun, float* out);
+
+// tipos de valor de ufr_args_get_many
+#define UFR_ARGS_TYPE_U 'u'     // size_t
+#define UFR_ARGS_TYPE_I 'i'     // int
+#define UFR_ARGS_TYPE_F 'f'     // float
+#define UFR_ARGS_TYPE_P 'p'     // const void*
+#define UFR_ARGS_TYPE_S 's'     // const char*
+
+typedef struct {
+    const char* name;
+    char        type;           // UFR_ARGS_TYPE_*
+    item_t      default_value;
+    void*       out;            // ponteiro para uma variavel do tipo
+    char*       buffer;         // somente UFR_ARGS_TYPE_S, com UFR_ARGS_TOKEN bytes
+} ufr_args_get_t;
+
+int ufr_args_get_many(const ufr_args_t* args, ufr_args_get_t* items, const size_t count);
+
+// ============================================================================
+//  UFR ARGS - Esquemas
+// ============================================================================
+
+// campo de um esquema, gerado por UFR_ARGS_SCHEMA_DEFINE
+typedef struct {
+    const char* name;
+    char        type;           // UFR_ARGS_TYPE_*
+    size_t      offset;         // posicao do campo na estrutura
+    size_t      buffer;         // posicao do buffer do campo UFR_ARGS_TYPE_S
+    item_t      default_value;
+} ufr_args_field_t;
+
+typedef struct {
+    const ufr_args_field_t* fields;
+    size_t count;
+    int (*lookup)(const char* name, const size_t len);  // indice do campo ou -1
+} ufr_args_schema_t;
+
+int ufr_args_parse(const ufr_args_t* args, const ufr_args_schema_t* schema, void* out);
+
+/*
+ * Esquema declarativo: uma lista X(campo, tipo, nome, padrao) gera a
+ * estrutura tipada e o parser especializado nos nomes: um switch no tamanho
+ * do nome (ate UFR_ARGS_SCHEMA_NAME_MAX caracteres) e, dentro de cada
+ * tamanho, o segundo caractere antes do memcmp de tamanho constante.
+ *   ex: #define SERIAL_SCHEMA(X) \
+ *           X(port,    I, "@port",    80) \
+ *           X(timeout, F, "@timeout", 1.0) \
+ *           X(topic,   S, "@topic",   "/data")
+ *       UFR_ARGS_SCHEMA_DECLARE(serial, SERIAL_SCHEMA)   // no .h
+ *       UFR_ARGS_SCHEMA_DEFINE(serial, SERIAL_SCHEMA)    // no .c
+ *       serial_t cfg;
+ *       serial_parse(&args, &cfg);   // cfg.port, cfg.timeout, cfg.topic
+ *
+ * Os tipos sao U (size_t), I (int), F (float), P (const void*) e
+ * S (const char*, com o buffer campo_buffer de UFR_ARGS_TOKEN bytes).
+ */
+
+#define UFR_ARGS_SCHEMA_MEMBER_U(field) size_t field;
+#define UFR_ARGS_SCHEMA_MEMBER_I(field) int field;
+#define UFR_ARGS_SCHEMA_MEMBER_F(field) float field;
+#define UFR_ARGS_SCHEMA_MEMBER_P(field) const void* field;
+#define UFR_ARGS_SCHEMA_MEMBER_S(field) const char* field; char field##_buffer[UFR_ARGS_TOKEN];
+
+#define UFR_ARGS_SCHEMA_ITEM_U u64
+#define UFR_ARGS_SCHEMA_ITEM_I i32
+#define UFR_ARGS_SCHEMA_ITEM_F f32
+#define UFR_ARGS_SCHEMA_ITEM_P ptr
+#define UFR_ARGS_SCHEMA_ITEM_S str
+
+#define UFR_ARGS_SCHEMA_BUFFER_U(type, field) 0
+#define UFR_ARGS_SCHEMA_BUFFER_I(type, field) 0
+#define UFR_ARGS_SCHEMA_BUFFER_F(type, field) 0
+#define UFR_ARGS_SCHEMA_BUFFER_P(type, field) 0
+#define UFR_ARGS_SCHEMA_BUFFER_S(type, field) offsetof(type, field##_buffer)
+
+#define UFR_ARGS_SCHEMA_X_MEMBER(field, type, name, def) \
+    UFR_ARGS_SCHEMA_MEMBER_##type(field)
+
+#define UFR_ARGS_SCHEMA_X_ENUM(field, type, name, def) \
+    ufr_args_field_##field,
+
+// len_ e constante em cada case do switch, entao os campos de outro tamanho
+// somem na compilacao e sobra a comparacao de um caractere antes do memcmp
+#define UFR_ARGS_SCHEMA_X_LOOKUP(field, type, name, def) \
+    if ( sizeof(name) - 1 == len_ && name_[1] == name[1] && memcmp(name_, name, sizeof(name) - 1) == 0 ) { \
+        return ufr_args_field_##field; \
+    }
+
+#define UFR_ARGS_SCHEMA_X_LOOKUP_LONG(field, type, name, def) \
+    if ( sizeof(name) - 1 > UFR_ARGS_SCHEMA_NAME_MAX && len == sizeof(name) - 1 && \
+         name_[1] == name[1] && memcmp(name_, name, sizeof(name) - 1) == 0 ) { \
+        return ufr_args_field_##field; \
+    }
+
+#define UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, n) \
+    case n: { \
+        enum { len_ = n }; \
+        SCHEMA(UFR_ARGS_SCHEMA_X_LOOKUP) \
+        return -1; \
+    }
+
+// nomes maiores usam a busca linear
+#define UFR_ARGS_SCHEMA_NAME_MAX 32
+
+#define UFR_ARGS_SCHEMA_LOOKUP_SWITCH(SCHEMA) \
+    switch ( len ) { \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 2) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 3) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 4) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 5) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 6) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 7) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 8) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 9) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 10) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 11) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 12) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 13) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 14) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 15) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 16) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 17) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 18) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 19) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 20) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 21) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 22) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 23) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 24) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 25) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 26) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 27) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 28) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 29) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 30) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 31) \
+        UFR_ARGS_SCHEMA_LEN_CASE(SCHEMA, 32) \
+        default: \
+            SCHEMA(UFR_ARGS_SCHEMA_X_LOOKUP_LONG) \
+            return -1; \
+    }
+
+#define UFR_ARGS_SCHEMA_X_FIELD(field, type, name, def) \
+    { name, UFR_ARGS_TYPE_##type, offsetof(ufr_args_schema_out_t, field), \
+      UFR_ARGS_SCHEMA_BUFFER_##type(ufr_args_schema_out_t, field), \
+      { .UFR_ARGS_SCHEMA_ITEM_##type = def } },
+
+#define UFR_ARGS_SCHEMA_DECLARE(prefix, SCHEMA) \
+    typedef struct { SCHEMA(UFR_ARGS_SCHEMA_X_MEMBER) } prefix##_t; \
+    int prefix##_parse(const ufr_args_t* args, prefix##_t* out);
+
+#define UFR_ARGS_SCHEMA_DEFINE(prefix, SCHEMA) \
+    static int prefix##_lookup(const char* name_, const size_t len) { \
+        enum { SCHEMA(UFR_ARGS_SCHEMA_X_ENUM) }; \
+        UFR_ARGS_SCHEMA_LOOKUP_SWITCH(SCHEMA) \
+    } \
+    int prefix##_parse(const ufr_args_t* args, prefix##_t* out) { \
+        typedef prefix##_t ufr_args_schema_out_t; \
+        static const ufr_args_field_t fields[] = { SCHEMA(UFR_ARGS_SCHEMA_X_FIELD) }; \
+        static const ufr_args_schema_t schema = { \
+            fields, sizeof(fields) / sizeof(fields[0]), prefix##_lookup }; \
+        return ufr_args_parse(args, &schema, out); \
+    }
+
+// ============================================================================
+//  UFR ARGS - Tokens
+// ============================================================================
+
+
 bool ufr_args_flex_div(const char* text, uint16_t* cursor_ini, char* token, const uint16_t token_max, const char div);
+bool ufr_args_flex_div_scalar(const char* text, uint16_t* cursor_ini, char* token, const uint16_t token_max, const char div);
 bool ufr_args_flex(const char* text, uint16_t* cursor_ini, char* token, const uint16_t token_max);
 
+bool ufr_args_flex_div_sz(const char* text, size_t* cursor_ini, char* token, const size_t token_max, const char div);
+bool ufr_args_flex_sz(const char* text, size_t* cursor_ini, char* token, const size_t token_max);
+
+int ufr_args_simd_select(const int level);
+
+bool   ufr_args_flex_span(const char* text, size_t* cursor_ini, ufr_args_span_t* span, const char div);
+size_t ufr_args_span_copy(const char* text, const ufr_args_span_t* span, char* token, const size_t token_max);
+bool   ufr_args_span_equal(const char* text, const ufr_args_span_t* span, const char* str);
+
 int ufr_args_decrease_level(const char* src, char* dst);
+int ufr_args_extract_level(const char* src, const int level, char* dst, const size_t dst_max);
+
+int  ufr_args_load_from_va(ufr_args_t* args, const char* text, va_list list);
+item_t* ufr_args_arg(ufr_args_t* args, const uint32_t slot);
+
+int  ufr_args_compile(ufr_args_t* args);
+int  ufr_args_compile_tree(ufr_args_t* args);
+void ufr_args_free(ufr_args_t* args);
+const ufr_args_t* ufr_args_child(const ufr_args_t* args);
+const ufr_args_index_t* ufr_args_index(const ufr_args_t* args);
+const ufr_args_spill_t* ufr_args_spill(const ufr_args_t* args);
 
-void ufr_args_load_from_va(ufr_args_t* args, const char* text, va_list list);
+void* ufr_args_load_library(const char* type, const char* lib, const char* classname);
+int   ufr_args_preload_libraries(const char* type, const char* text);
+void  ufr_args_unload_libraries();
@@ -0,0 +1,479 @@
+/* BSD 2-Clause License
+ * 
+ * Copyright (c) 2024, Visao Robotica e Imagem (VRI)
+ *  - Felipe Bombardelli <felipebombardelli@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// ============================================================================
+//  Header
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "ufr_args.h"
+
+// ============================================================================
+//  Benchmark
+// ============================================================================
+
+// evita que o compilador descarte os resultados
+static volatile int g_bench_sink;
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Gera um texto de argumentos com varios niveis e valores entre aspas. Com
+// long_values, cada valor tem algumas centenas de caracteres.
+static char* bench_make_text(size_t size, bool long_values) {
+    char* text = malloc(size + 1);
+    char value[300];
+    size_t len = 0;
+    int i = 0;
+    const size_t value_len = long_values ? sizeof(value) - 1 : 8;
+    memset(value, 'x', value_len);
+    value[value_len] = '\0';
+    while ( len + 128 + value_len * 2 < size ) {
+        len += snprintf(&text[len], size - len, "@name%d %s @@sub%d 'quoted %s' @port %%d ", i, value, i, value);
+        i += 1;
+    }
+    text[len] = '\0';
+    return text;
+}
+
+// Tokens/segundo de um tokenizador sobre o texto todo.
+static double bench_tokens(const char* text, const int rounds, const int mode) {
+    char token[UFR_ARGS_TOKEN];
+    ufr_args_span_t span;
+    size_t count = 0;
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        uint16_t cursor16 = 0;
+        size_t cursor = 0;
+        if ( mode == 0 ) {
+            while ( ufr_args_flex_div_scalar(text, &cursor16, token, sizeof(token), ' ') ) {
+                count += 1;
+            }
+        } else if ( mode == 1 ) {
+            while ( ufr_args_flex_sz(text, &cursor, token, sizeof(token)) ) {
+                count += 1;
+            }
+        } else {
+            while ( ufr_args_flex_span(text, &cursor, &span, ' ') ) {
+                count += 1;
+            }
+        }
+    }
+    return count / (bench_now() - ini);
+}
+
+// Compara tokens/segundo do tokenizador com copia e do tokenizador com spans,
+// para cada implementacao da busca de delimitadores.
+void bench_flex(bool long_values) {
+    const char* names[] = {"escalar", "sse2", "avx2"};
+    char* text = bench_make_text(60000, long_values);
+    printf("Texto de %zu bytes, valores %s\n", strlen(text), long_values ? "longos" : "curtos");
+    const int rounds = 2000;
+
+    printf("flex_div_scalar (referencia): %8.2f Mtokens/s\n", bench_tokens(text, rounds, 0) / 1e6);
+    const int max_level = ufr_args_simd_select(UFR_ARGS_SIMD_AUTO);
+    for (int level=UFR_ARGS_SIMD_SCALAR; level<=max_level; level++) {
+        ufr_args_simd_select(level);
+        printf("flex (copia, %-7s):        %8.2f Mtokens/s\n", names[level], bench_tokens(text, rounds, 1) / 1e6);
+        printf("flex_span (%-7s):          %8.2f Mtokens/s\n", names[level], bench_tokens(text, rounds, 2) / 1e6);
+    }
+    ufr_args_simd_select(UFR_ARGS_SIMD_AUTO);
+    free(text);
+}
+
+// Le textos de 1 MB, 10 MB e 100 MB, maiores que o antigo limite de 65535
+// caracteres do cursor, e mede o throughput do tokenizador, da compilacao do
+// indice e de uma busca pelo ultimo nome do texto.
+void bench_large_text() {
+    const size_t sizes[] = {1 << 20, 10 << 20, 100 << 20};
+    char token[UFR_ARGS_TOKEN];
+    ufr_args_span_t span;
+
+    for (int i=0; i<3; i++) {
+        char* text = bench_make_text(sizes[i], false);
+        const size_t len = strlen(text);
+        const double mb = len / 1e6;
+        printf("Texto de %.1f MB\n", mb);
+
+        double ini = bench_now();
+        size_t cursor = 0;
+        size_t count = 0;
+        while ( ufr_args_flex_sz(text, &cursor, token, sizeof(token)) ) {
+            count += 1;
+        }
+        printf("  flex_sz:          %8.1f MB/s (%zu tokens)\n", mb / (bench_now() - ini), count);
+
+        ini = bench_now();
+        cursor = 0;
+        while ( ufr_args_flex_span(text, &cursor, &span, ' ') ) {
+        }
+        printf("  flex_span:        %8.1f MB/s\n", mb / (bench_now() - ini));
+
+        // o ultimo nome gerado por bench_make_text, 6 tokens por repeticao
+        char last[32];
+        snprintf(last, sizeof(last), "@name%zu", count / 6 - 1);
+        ufr_args_t args = {.text=text};
+        ini = bench_now();
+        const int value_text = ufr_args_geti(&args, last, -1);
+        printf("  geti sem indice:  %8.1f MB/s\n", mb / (bench_now() - ini));
+
+        ini = bench_now();
+        ufr_args_compile(&args);
+        printf("  compile:          %8.1f MB/s\n", mb / (bench_now() - ini));
+        const int value_index = ufr_args_geti(&args, last, -1);
+        ufr_args_free(&args);
+        if ( value_text != value_index ) {
+            printf("  erro: %d != %d\n", value_text, value_index);
+        }
+        free(text);
+    }
+}
+
+// Compara 12 getters seguidos com uma chamada de ufr_args_get_many, no texto
+// tipico do construtor de um driver.
+void bench_get_many() {
+    const char* names[12] = {"@port", "@baud", "@timeout", "@topic", "@parity", "@bits",
+                             "@stop", "@flow", "@retry", "@rate", "@frame", "@queue"};
+    ufr_args_t args = {.text="@new serial @@new ros @port /dev/ttyUSB0 @baud 115200 "
+        "@timeout 0.25 @topic '/robot/serial/raw' @parity none @bits 8 @stop 1 "
+        "@flow none @retry 3 @rate 100 @frame 'base_link' @queue 16 @debug 0 "
+        "@@topic /robot/out @@qos 10 @log /tmp/serial.log"};
+    int values[12];
+    ufr_args_get_t items[12];
+    for (int i=0; i<12; i++) {
+        items[i] = (ufr_args_get_t) {.name=names[i], .type=UFR_ARGS_TYPE_I, .out=&values[i]};
+    }
+    const int rounds = 200000;
+    int sum = 0;
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=0; i<12; i++) {
+            sum += ufr_args_geti(&args, names[i], 0);
+        }
+    }
+    const double time_getters = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_args_get_many(&args, items, 12);
+        sum += values[r % 12];
+    }
+    const double time_many = bench_now() - ini;
+
+    ufr_args_compile(&args);
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_args_get_many(&args, items, 12);
+        sum += values[r % 12];
+    }
+    const double time_index = bench_now() - ini;
+    ufr_args_free(&args);
+
+    printf("12 x geti:                %8.2f us/construtor\n", time_getters / rounds * 1e6);
+    printf("get_many:                 %8.2f us/construtor\n", time_many / rounds * 1e6);
+    printf("get_many (compilado):     %8.2f us/construtor\n", time_index / rounds * 1e6);
+    g_bench_sink = sum;
+}
+
+#define BENCH_SCHEMA(X) \
+    X(port,    I, "@port",    0) \
+    X(baud,    I, "@baud",    0) \
+    X(timeout, I, "@timeout", 0) \
+    X(topic,   I, "@topic",   0) \
+    X(parity,  I, "@parity",  0) \
+    X(bits,    I, "@bits",    0) \
+    X(stop,    I, "@stop",    0) \
+    X(flow,    I, "@flow",    0) \
+    X(retry,   I, "@retry",   0) \
+    X(rate,    I, "@rate",    0) \
+    X(frame,   I, "@frame",   0) \
+    X(queue,   I, "@queue",   0)
+
+UFR_ARGS_SCHEMA_DECLARE(bench_schema, BENCH_SCHEMA)
+UFR_ARGS_SCHEMA_DEFINE(bench_schema, BENCH_SCHEMA)
+
+// Os mesmos 12 argumentos de bench_get_many lidos pelo parser do esquema.
+void bench_schema() {
+    ufr_args_t args = {.text="@new serial @@new ros @port /dev/ttyUSB0 @baud 115200 "
+        "@timeout 0.25 @topic '/robot/serial/raw' @parity none @bits 8 @stop 1 "
+        "@flow none @retry 3 @rate 100 @frame 'base_link' @queue 16 @debug 0 "
+        "@@topic /robot/out @@qos 10 @log /tmp/serial.log"};
+    bench_schema_t cfg;
+    const int rounds = 200000;
+    int sum = 0;
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        bench_schema_parse(&args, &cfg);
+        sum += cfg.baud;
+    }
+    const double time_schema = bench_now() - ini;
+
+    printf("esquema:                  %8.2f us/construtor\n", time_schema / rounds * 1e6);
+    g_bench_sink = sum;
+}
+
+/* Versao antiga de ufr_args_decrease_level, com strcat, como referencia. */
+static void bench_decrease_level_strcat(const char* src, char* dst) {
+    dst[0] = '\0';
+    char token[512];
+    uint16_t cursor = 0;
+    bool ignore = true;
+    while( ufr_args_flex(src, &cursor, token, sizeof(token)) ) {
+        if ( token[0] == '@' ) {
+            if ( token[1] == '@' ) {
+                strcat(dst, &token[1]);
+                strcat(dst, " ");
+                ignore = false;
+            } else {
+                ignore = true;
+            }
+        } else if ( ignore == false ) {
+            strcat(dst, token);
+            strcat(dst, " ");
+        }
+    }
+}
+
+/* Configuracao de pipeline com 8 niveis de 30 argumentos; extrai o nivel 7
+ * aplicando decrease_level 7 vezes ou com ufr_args_extract_level. */
+void bench_levels() {
+    const int depth = 8;
+    const int rounds = 2000;
+    char* text = malloc(32 << 10);
+    char* dst = malloc(32 << 10);
+    char* tmp = malloc(32 << 10);
+    size_t len = 0;
+    for (int l=1; l<=depth; l++) {
+        for (int i=0; i<30; i++) {
+            for (int a=0; a<l; a++) {
+                text[len++] = '@';
+            }
+            len += (size_t) sprintf(&text[len], "arg%d /pipeline/stage%d/value ", i, l);
+        }
+    }
+    text[len] = '\0';
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        strcpy(tmp, text);
+        for (int l=1; l<depth; l++) {
+            bench_decrease_level_strcat(tmp, dst);
+            strcpy(tmp, dst);
+        }
+        g_bench_sink += (int) strlen(dst);
+    }
+    const double time_strcat = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        strcpy(tmp, text);
+        for (int l=1; l<depth; l++) {
+            ufr_args_decrease_level(tmp, dst);
+            strcpy(tmp, dst);
+        }
+        g_bench_sink += (int) strlen(dst);
+    }
+    const double time_decrease = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_args_extract_level(text, depth - 1, dst, 32 << 10);
+        g_bench_sink += (int) strlen(dst);
+    }
+    const double time_extract = bench_now() - ini;
+    free(text);
+    free(dst);
+    free(tmp);
+
+    printf("%zu bytes, nivel %d:\n", len, depth - 1);
+    printf("  decrease_level strcat:  %8.2f us\n", time_strcat / rounds * 1e6);
+    printf("  decrease_level x%d:      %8.2f us\n", depth - 1, time_decrease / rounds * 1e6);
+    printf("  extract_level:          %8.2f us\n", time_extract / rounds * 1e6);
+}
+
+void bench_tree() {
+    const int depth = 8;
+    const int rounds = 2000;
+    char* text = malloc(32 << 10);
+    char* levels[8];
+    size_t len = 0;
+    for (int l=1; l<=depth; l++) {
+        for (int i=0; i<30; i++) {
+            for (int a=0; a<l; a++) {
+                text[len++] = '@';
+            }
+            len += (size_t) sprintf(&text[len], "arg%d %d ", i, l);
+        }
+    }
+    text[len] = '\0';
+    for (int l=0; l<depth; l++) {
+        levels[l] = malloc(32 << 10);
+    }
+
+    // um texto e um indice por nivel
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        strcpy(levels[0], text);
+        for (int l=1; l<depth; l++) {
+            ufr_args_decrease_level(levels[l-1], levels[l]);
+        }
+        for (int l=0; l<depth; l++) {
+            ufr_args_t args = {.text=levels[l]};
+            ufr_args_compile(&args);
+            g_bench_sink += ufr_args_geti(&args, "@arg7", 0);
+            ufr_args_free(&args);
+        }
+    }
+    const double time_flat = bench_now() - ini;
+
+    // uma arvore de visoes sobre o texto original
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_args_t args = {.text=text};
+        ufr_args_compile_tree(&args);
+        for (const ufr_args_t* level=&args; level != NULL; level=ufr_args_child(level)) {
+            g_bench_sink += ufr_args_geti(level, "@arg7", 0);
+        }
+        ufr_args_free(&args);
+    }
+    const double time_tree = bench_now() - ini;
+
+    free(text);
+    for (int l=0; l<depth; l++) {
+        free(levels[l]);
+    }
+
+    printf("%zu bytes, %d niveis:\n", len, depth);
+    printf("  decrease_level+compile: %8.2f us\n", time_flat / rounds * 1e6);
+    printf("  compile_tree:           %8.2f us\n", time_tree / rounds * 1e6);
+}
+
+void bench_library() {
+    const int rounds = 200;
+    const int cached_rounds = 1000000;
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        g_bench_sink += (ufr_args_load_library("gtw", "test", "pipe") != NULL);
+        ufr_args_unload_libraries();
+    }
+    const double time_cold = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<cached_rounds; r++) {
+        g_bench_sink += (ufr_args_load_library("gtw", "test", "pipe") != NULL);
+    }
+    const double time_cached = bench_now() - ini;
+    ufr_args_unload_libraries();
+
+    printf("load_library libufr_gtw_test.so:\n");
+    printf("  dlopen+dlsym:           %8.2f us\n", time_cold / rounds * 1e6);
+    printf("  cache:                  %8.3f us\n", time_cached / cached_rounds * 1e6);
+}
+
+void bench_numbers() {
+    const int rounds = 200000;
+    ufr_args_t args = {.text="@port 8080 @baud 115200 @timeout 0.25 @gain 1.5e-3 @width 1920 @height 1080 @fps 29.97 @id %s"};
+    args.arg[0].str = "12345";
+    ufr_args_compile(&args);
+    const char* names[] = {"@port", "@baud", "@timeout", "@gain", "@width", "@height", "@fps", "@id"};
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=0; i<8; i++) {
+            g_bench_sink += ufr_args_geti(&args, names[i], 0);
+            g_bench_sink += (int) ufr_args_getf(&args, names[i], 0.0);
+        }
+    }
+    const double time_get = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=0; i<8; i++) {
+            int value_i = 0;
+            float value_f = 0.0;
+            g_bench_sink += ufr_args_try_geti(&args, names[i], &value_i) + value_i;
+            g_bench_sink += ufr_args_try_getf(&args, names[i], &value_f) + (int) value_f;
+        }
+    }
+    const double time_try = bench_now() - ini;
+    ufr_args_free(&args);
+
+    printf("geti+getf compilado, 8 nomes:\n");
+    printf("  getters:                %8.3f us\n", time_get / rounds * 1e6);
+    printf("  try_getters:            %8.3f us\n", time_try / rounds * 1e6);
+}
+
+static int bench_load_from_va(ufr_args_t* args, const char* text, ...) {
+    va_list list;
+    va_start(list, text);
+    const int error = ufr_args_load_from_va(args, text, list);
+    va_end(list);
+    return error;
+}
+
+void bench_spill() {
+    const int rounds = 200000;
+    const char* text = "@a %d @b %f @c %s @d %p @e %d @f %d @g %d @h %d @i %f @j %s @k %p @l %d";
+    int valor = 0;
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_args_t args;
+        bench_load_from_va(&args, text, 1, 2.5, "3", &valor, 5, 6, 7, 8, 9.5, "10", &valor, r);
+        g_bench_sink += ufr_args_geti(&args, "@l", 0) + ufr_args_geti(&args, "@a", 0);
+        ufr_args_free(&args);
+    }
+    const double time_spill = bench_now() - ini;
+
+    printf("load_from_va, 12 argumentos (5 no vetor externo):\n");
+    printf("  load+geti x2+free:      %8.3f us\n", time_spill / rounds * 1e6);
+}
+
+int main() {
+    bench_flex(false);
+    bench_flex(true);
+    bench_get_many();
+    bench_schema();
+    bench_large_text();
+    bench_levels();
+    bench_tree();
+    bench_library();
+    bench_numbers();
+    bench_spill();
+    return 0;
+}
@@ -34,6 +34,29 @@
 #include "ufr_args.h"
 #include "ufr_test.h"
 
+#define TEST_SCHEMA(X) \
+    X(port,    I, "@port",    80) \
+    X(baud,    U, "@baud",    115200) \
+    X(timeout, F, "@timeout", 1.0) \
+    X(topic,   S, "@topic",   "") \
+    X(name,    S, "@name",    "none") \
+    X(ptr,     P, "@ptr",     NULL) \
+    X(a,       P, "@a",       NULL) \
+    X(ab,      I, "@ab",      -1)
+
+UFR_ARGS_SCHEMA_DECLARE(test_schema, TEST_SCHEMA)
+UFR_ARGS_SCHEMA_DEFINE(test_schema, TEST_SCHEMA)
+
+// mesmo tamanho e mesmo segundo caractere, e um nome maior que UFR_ARGS_SCHEMA_NAME_MAX
+#define TEST_SCHEMA_NAMES(X) \
+    X(baud,  I, "@baud",  1) \
+    X(bits,  I, "@bits",  2) \
+    X(busy,  I, "@busy",  3) \
+    X(longo, I, "@nome_de_argumento_com_mais_de_32_caracteres", 4)
+
+UFR_ARGS_SCHEMA_DECLARE(test_names, TEST_SCHEMA_NAMES)
+UFR_ARGS_SCHEMA_DEFINE(test_names, TEST_SCHEMA_NAMES)
+
 //============================================================================
 //  Tests
 // ============================================================================
@@ -225,11 +248,879 @@ void test_ufr_args_flex_div () {
     printf ("\n");
 }
 
+void test_ufr_args_compile () {
+
+    printf ("==========Iniciando testes p/ ufr_args_compile==========\n");
+    printf ("\n");
+
+    // Teste 1: mesmos valores com e sem indice compilado
+    {
+        int valor = 0;
+        ufr_args_t args = {.text="@nome 'teste jjj' @pontos 10 @porta %d @ganho %f @ptr %p @topic %s @vazio"};
+        args.arg[0].i32 = 8080;
+        args.arg[1].f32 = 1.5;
+        args.arg[2].ptr = &valor;
+        args.arg[3].str = "/camera";
+
+        printf ("          Teste 1 - getters com e sem indice\n\n");
+        char buffer1[UFR_ARGS_TOKEN];
+        char buffer2[UFR_ARGS_TOKEN];
+        for (int i=0; i<2; i++) {
+            if ( i == 1 ) {
+                UFR_TEST_OK (ufr_args_compile (&args));
+                UFR_TEST_NOT_NULL (ufr_args_index (&args));
+            }
+            UFR_TEST_EQUAL_U32 (ufr_args_getu (&args, "@pontos", 0), 10);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@porta", 0), 8080);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@ganho", 0), 1);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@ganho", 0.0), 1.5);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@naoexiste", 2.5), 2.5);
+            UFR_TEST_TRUE ((ufr_args_getp (&args, "@ptr", NULL) == &valor));
+            UFR_TEST_NULL (ufr_args_getp (&args, "@porta", NULL));
+            UFR_TEST_EQUAL_STR (ufr_args_gets (&args, buffer1, "@nome", ""), "teste jjj");
+            UFR_TEST_EQUAL_STR (ufr_args_gets (&args, buffer2, "@topic", ""), "/camera");
+            UFR_TEST_EQUAL_STR (ufr_args_gets (&args, buffer2, "@vazio", "padrao"), "");
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@vazio", 7), 0);
+        }
+        ufr_args_free (&args);
+        UFR_TEST_NULL (ufr_args_index (&args));
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: nome repetido, a busca continua depois do valor
+    {
+        int valor = 0;
+        ufr_args_t args = {.text="@a @a %p @b 1 @b 2 @a %p"};
+        args.arg[1].ptr = &valor;
+
+        printf ("          Teste 2 - nome repetido\n\n");
+        UFR_TEST_OK (ufr_args_compile (&args));
+        UFR_TEST_EQUAL_U32 (ufr_args_index (&args)->count, 5);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@b", 0), 1);
+        UFR_TEST_TRUE ((ufr_args_getp (&args, "@a", NULL) == &valor));
+        ufr_args_free (&args);
+        UFR_TEST_TRUE ((ufr_args_getp (&args, "@a", NULL) == &valor));
+
+        // o valor %p pulado ocupa um indice com e sem indice compilado
+        ufr_args_t pulo = {.text="@a %p @a %d"};
+        pulo.arg[0].ptr = &valor;
+        pulo.arg[1].i32 = 5;
+        const int sem_indice = ufr_args_geti (&pulo, "@a", 0);
+        UFR_TEST_EQUAL_I32 (sem_indice, 5);
+        UFR_TEST_OK (ufr_args_compile (&pulo));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&pulo, "@a", 0), sem_indice);
+        ufr_args_free (&pulo);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 3: texto maior que o limite de um cursor de 16 bits
+    {
+        const size_t len = 200000;
+        char* text = malloc (len + 1);
+        memset (text, ' ', len);
+        memcpy (&text[10], "@inicio 1", 9);
+        memcpy (&text[len - 20], "@fim %d @ultimo 42", 18);
+        text[len] = '\0';
+
+        printf ("          Teste 3 - texto com %ld caracteres\n\n", (long) len);
+        ufr_args_t args = {.text=text, .arg[0].i32=7};
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@inicio", 0), 1);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@fim", 0), 7);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@ultimo", 0), 42);
+        UFR_TEST_OK (ufr_args_compile (&args));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@fim", 0), 7);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@ultimo", 0), 42);
+        ufr_args_free (&args);
+        free (text);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+void test_ufr_args_flex_span () {
+
+    printf ("==========Iniciando testes p/ ufr_args_flex_span==========\n");
+    printf ("\n");
+
+    // Teste 1: visao dos tokens no texto original
+    {
+        const char* text = "@nome 'a b' 10";
+        size_t cursor = 0;
+        ufr_args_span_t span;
+        char token[50];
+
+        printf ("          Teste 1 - posicao e tamanho dos tokens\n\n");
+        UFR_TEST_TRUE (ufr_args_flex_span (text, &cursor, &span, ' '));
+        UFR_TEST_EQUAL (span.ini, 0);
+        UFR_TEST_EQUAL (span.len, 5);
+        UFR_TEST_FALSE (span.quoted);
+        UFR_TEST_TRUE (ufr_args_span_equal (text, &span, "@nome"));
+
+        UFR_TEST_TRUE (ufr_args_flex_span (text, &cursor, &span, ' '));
+        UFR_TEST_EQUAL (span.ini, 6);
+        UFR_TEST_EQUAL (span.len, 5);
+        UFR_TEST_TRUE (span.quoted);
+        UFR_TEST_TRUE (ufr_args_span_equal (text, &span, "a b"));
+        ufr_args_span_copy (text, &span, token, sizeof(token));
+        UFR_TEST_EQUAL_STR (token, "a b");
+
+        UFR_TEST_TRUE (ufr_args_flex_span (text, &cursor, &span, ' '));
+        UFR_TEST_EQUAL (span.ini, 12);
+        UFR_TEST_FALSE (ufr_args_span_equal (text, &span, "1"));
+        UFR_TEST_FALSE (ufr_args_flex_span (text, &cursor, &span, ' '));
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: mesmos tokens e cursores de ufr_args_flex_div em frases aleatorias
+    {
+        const char alfabeto[] = "ab@% ,'\n";
+        char text[64];
+        char token1[UFR_ARGS_TOKEN];
+        char token2[UFR_ARGS_TOKEN];
+
+        printf ("          Teste 2 - equivalencia com ufr_args_flex_div_scalar\n\n");
+        srand (10);
+        for (int i=0; i<10000; i++) {
+            const int len = rand() % (sizeof(text) - 1);
+            for (int j=0; j<len; j++) {
+                text[j] = alfabeto[ rand() % (sizeof(alfabeto) - 1) ];
+            }
+            text[len] = '\0';
+
+            const char div = (i % 2 == 0) ? ' ' : ',';
+            uint16_t cursor1 = 0;
+            size_t cursor2 = 0;
+            while (1) {
+                ufr_args_span_t span;
+                const bool res1 = ufr_args_flex_div_scalar (text, &cursor1, token1, sizeof(token1), div);
+                const bool res2 = ufr_args_flex_span (text, &cursor2, &span, div);
+                ufr_args_span_copy (text, &span, token2, sizeof(token2));
+                if ( res1 != res2 || cursor1 != cursor2 || strcmp(token1, token2) != 0 ) {
+                    printf ("Erro na frase \"%s\": \"%s\" e \"%s\"\n", text, token1, token2);
+                    exit (1);
+                }
+                if ( res1 == false ) {
+                    break;
+                }
+            }
+        }
+        UFR_TEST_TRUE (true);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 3: ufr_args_decrease_level
+    {
+        char dst[128];
+
+        printf ("          Teste 3 - ufr_args_decrease_level\n\n");
+        UFR_TEST_OK (ufr_args_decrease_level ("@new teste @path file @@new opencv @@id 0", dst));
+        UFR_TEST_EQUAL_STR (dst, "@new opencv @id 0 ");
+        UFR_TEST_OK (ufr_args_decrease_level ("@@@new 'a b' @@x 1", dst));
+        UFR_TEST_EQUAL_STR (dst, "@@new a b @x 1 ");
+        UFR_TEST_OK (ufr_args_decrease_level ("@new teste", dst));
+        UFR_TEST_EQUAL_STR (dst, "");
+
+        // qualquer nivel em uma passada, igual a aplicar decrease_level varias vezes
+        const char* deep = "@new a @x 1 @@new b @@y 2 @@@new c @@@z 'q r' @@@@new d @@@@w 4";
+        char step[128];
+        UFR_TEST_OK (ufr_args_extract_level (deep, 0, dst, sizeof(dst)));
+        UFR_TEST_EQUAL_STR (dst, "@new a @x 1 @@new b @@y 2 @@@new c @@@z q r @@@@new d @@@@w 4 ");
+        UFR_TEST_OK (ufr_args_extract_level (deep, 2, dst, sizeof(dst)));
+        UFR_TEST_EQUAL_STR (dst, "@new c @z q r @@new d @@w 4 ");
+        UFR_TEST_OK (ufr_args_decrease_level (deep, step));
+        UFR_TEST_OK (ufr_args_decrease_level (step, dst));
+        UFR_TEST_EQUAL_STR (dst, "@new c @z q r @@new d @@w 4 ");
+        UFR_TEST_OK (ufr_args_extract_level (deep, 4, dst, sizeof(dst)));
+        UFR_TEST_EQUAL_STR (dst, "");
+
+        // dst limitado: erro e somente os tokens que couberam
+        UFR_TEST_EQUAL_U64 (ufr_args_extract_level (deep, 3, dst, 10), UFR_ARGS_ERROR_NOMEM);
+        UFR_TEST_EQUAL_STR (dst, "@new d ");
+        UFR_TEST_OK (ufr_args_extract_level (deep, 3, dst, 13));
+        UFR_TEST_EQUAL_STR (dst, "@new d @w 4 ");
+        UFR_TEST_EQUAL_U64 (ufr_args_extract_level (deep, 3, dst, 12), UFR_ARGS_ERROR_NOMEM);
+        UFR_TEST_EQUAL_U64 (ufr_args_extract_level (deep, 1, dst, 0), UFR_ARGS_ERROR_NOMEM);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+void test_ufr_args_simd () {
+
+    printf ("==========Iniciando testes p/ busca vetorizada==========\n");
+    printf ("\n");
+
+    // Teste 1: tokens iguais a versao escalar, para cada nivel suportado
+    {
+        const char alfabeto[] = "abcdefgh@%  ,,'\n";
+        char memoria[700];
+        char token1[UFR_ARGS_TOKEN];
+        char token2[UFR_ARGS_TOKEN];
+        const int max_level = ufr_args_simd_select (UFR_ARGS_SIMD_AUTO);
+
+        printf ("          Teste 1 - equivalencia com ufr_args_flex_div_scalar\n\n");
+        srand (20);
+        for (int level=UFR_ARGS_SIMD_SCALAR; level<=max_level; level++) {
+            UFR_TEST_EQUAL (ufr_args_simd_select (level), level);
+            printf ("Nivel %d\n", level);
+            for (int i=0; i<20000; i++) {
+                // desloca o inicio para testar todos os alinhamentos
+                char* text = &memoria[ rand() % 64 ];
+                const int len = rand() % 600;
+                for (int j=0; j<len; j++) {
+                    text[j] = alfabeto[ rand() % (sizeof(alfabeto) - 1) ];
+                }
+                text[len] = '\0';
+
+                const char div = (i % 3 == 0) ? ',' : ' ';
+                const uint16_t token_max = (i % 5 == 0) ? 8 : sizeof(token1);
+                uint16_t cursor1 = 0;
+                uint16_t cursor2 = 0;
+                while (1) {
+                    const bool res1 = ufr_args_flex_div_scalar (text, &cursor1, token1, token_max, div);
+                    const bool res2 = ufr_args_flex_div (text, &cursor2, token2, token_max, div);
+                    if ( res1 != res2 || cursor1 != cursor2 || strcmp(token1, token2) != 0 ) {
+                        printf ("Erro na frase \"%s\": \"%s\" e \"%s\"\n", text, token1, token2);
+                        exit (1);
+                    }
+                    if ( res1 == false ) {
+                        break;
+                    }
+                }
+            }
+            UFR_TEST_TRUE (true);
+        }
+        ufr_args_simd_select (UFR_ARGS_SIMD_AUTO);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+void test_ufr_args_get_many () {
+
+    printf ("==========Iniciando testes p/ ufr_args_get_many==========\n");
+    printf ("\n");
+
+    // Teste 1: mesmos valores dos getters individuais
+    {
+        int valor = 0;
+        ufr_args_t args = {.text="@port %d @baud 9600 @timeout 0.5 @topic '/camera 1' @ptr %p @name %s @a @a %p"};
+        args.arg[0].i32 = 8080;
+        args.arg[1].ptr = &valor;
+        args.arg[2].str = "sensor";
+        args.arg[3].ptr = &valor;
+
+        size_t baud;
+        int port, missing;
+        float timeout;
+        const void* ptr;
+        const void* ptr_a;
+        const char* topic;
+        const char* name;
+        char buffer[UFR_ARGS_TOKEN];
+        ufr_args_get_t items[] = {
+            {.name="@timeout", .type=UFR_ARGS_TYPE_F, .default_value.f32=1.0, .out=&timeout},
+            {.name="@port", .type=UFR_ARGS_TYPE_I, .default_value.i32=80, .out=&port},
+            {.name="@baud", .type=UFR_ARGS_TYPE_U, .default_value.u64=115200, .out=&baud},
+            {.name="@topic", .type=UFR_ARGS_TYPE_S, .default_value.str="", .out=&topic, .buffer=buffer},
+            {.name="@ptr", .type=UFR_ARGS_TYPE_P, .default_value.ptr=NULL, .out=&ptr},
+            {.name="@name", .type=UFR_ARGS_TYPE_S, .default_value.str="", .out=&name},
+            {.name="@missing", .type=UFR_ARGS_TYPE_I, .default_value.i32=-1, .out=&missing},
+            {.name="@a", .type=UFR_ARGS_TYPE_P, .default_value.ptr=NULL, .out=&ptr_a},
+        };
+
+        printf ("          Teste 1 - ufr_args_get_many com e sem indice\n\n");
+        for (int i=0; i<2; i++) {
+            if ( i == 1 ) {
+                UFR_TEST_OK (ufr_args_compile (&args));
+            }
+            UFR_TEST_EQUAL (ufr_args_get_many (&args, items, 8), 6);
+            UFR_TEST_EQUAL_F32 (timeout, 0.5);
+            UFR_TEST_EQUAL_I32 (port, 8080);
+            UFR_TEST_EQUAL_U32 (baud, 9600);
+            UFR_TEST_EQUAL_STR (topic, "/camera 1");
+            UFR_TEST_TRUE ((ptr == &valor));
+            UFR_TEST_EQUAL_STR (name, "sensor");
+            UFR_TEST_EQUAL_I32 (missing, -1);
+            UFR_TEST_NULL (ptr_a);
+            UFR_TEST_TRUE ((ptr_a == ufr_args_getp (&args, "@a", NULL)));
+        }
+        ufr_args_free (&args);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+
+void test_ufr_args_schema () {
+
+    printf ("==========Iniciando testes p/ ufr_args_parse==========\n");
+    printf ("\n");
+
+    // Teste 1: mesmos valores dos getters individuais
+    {
+        int valor = 0;
+        ufr_args_t args = {.text="@port %d @baud 9600 @timeout 0.5 @topic '/camera 1' @ptr %p @'ab' 7 @a @a %p"};
+        args.arg[0].i32 = 8080;
+        args.arg[1].ptr = &valor;
+        args.arg[2].ptr = &valor;
+        test_schema_t cfg;
+
+        printf ("          Teste 1 - esquema com e sem indice\n\n");
+        for (int i=0; i<2; i++) {
+            if ( i == 1 ) {
+                UFR_TEST_OK (ufr_args_compile (&args));
+            }
+            memset (&cfg, 0, sizeof(cfg));
+            UFR_TEST_EQUAL (test_schema_parse (&args, &cfg), 6);
+            UFR_TEST_EQUAL_I32 (cfg.port, 8080);
+            UFR_TEST_EQUAL_U32 (cfg.baud, 9600);
+            UFR_TEST_EQUAL_F32 (cfg.timeout, 0.5);
+            UFR_TEST_EQUAL_STR (cfg.topic, "/camera 1");
+            UFR_TEST_TRUE ((cfg.topic == cfg.topic_buffer));
+            UFR_TEST_EQUAL_STR (cfg.name, "none");
+            UFR_TEST_TRUE ((cfg.ptr == &valor));
+            UFR_TEST_TRUE ((cfg.a == ufr_args_getp (&args, "@a", NULL)));
+            UFR_TEST_EQUAL_I32 (cfg.ab, ufr_args_geti (&args, "@ab", -1));
+        }
+        ufr_args_free (&args);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: texto sem os nomes do esquema
+    {
+        ufr_args_t args = {.text="@new serial @porta 10 @@port 20"};
+        test_schema_t cfg;
+
+        printf ("          Teste 2 - valores padrao\n\n");
+        UFR_TEST_EQUAL (test_schema_parse (&args, &cfg), 0);
+        UFR_TEST_EQUAL_I32 (cfg.port, 80);
+        UFR_TEST_EQUAL_U32 (cfg.baud, 115200);
+        UFR_TEST_EQUAL_F32 (cfg.timeout, 1.0);
+        UFR_TEST_EQUAL_STR (cfg.topic, "");
+        UFR_TEST_NULL (cfg.ptr);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 3: despacho pelo tamanho do nome
+    {
+        ufr_args_t args = {.text="@bits 7 @busy 9 @bitz 0 @nome_de_argumento_com_mais_de_32_caracteres 40 @nome_de_argumento_com_mais_de_32_caracterez 0"};
+        test_names_t cfg;
+
+        printf ("          Teste 3 - nomes com mesmo tamanho e nomes longos\n\n");
+        UFR_TEST_EQUAL (test_names_parse (&args, &cfg), 3);
+        UFR_TEST_EQUAL_I32 (cfg.baud, 1);
+        UFR_TEST_EQUAL_I32 (cfg.bits, 7);
+        UFR_TEST_EQUAL_I32 (cfg.busy, 9);
+        UFR_TEST_EQUAL_I32 (cfg.longo, 40);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+
+
+void test_ufr_args_tree () {
+
+    printf ("==========Iniciando testes p/ ufr_args_compile_tree==========\n");
+    printf ("\n");
+
+    // Teste 1: cada nivel igual ao texto de ufr_args_extract_level
+    {
+        const char* text = "@new teste @path file @@new opencv @@id 0 @@@new face @@@@id 3 @@x @y";
+        const char* names[] = {"@new", "@path", "@id", "@@id", "@x", "@@new", "@y"};
+        ufr_args_t args = {.text=text};
+
+        printf ("          Teste 1 - niveis iguais a extract_level\n\n");
+        UFR_TEST_OK (ufr_args_compile_tree (&args));
+        const ufr_args_t* level = &args;
+        char expected[256];
+        char buffer1[UFR_ARGS_TOKEN];
+        char buffer2[UFR_ARGS_TOKEN];
+        int i_level = 0;
+        while ( level != NULL ) {
+            UFR_TEST_TRUE ((level->text == text));
+            UFR_TEST_EQUAL_U32 (ufr_args_index (level)->level, i_level);
+            UFR_TEST_OK (ufr_args_extract_level (text, i_level, expected, sizeof(expected)));
+            ufr_args_t flat = {.text=expected};
+            for (int i=0; i<7; i++) {
+                UFR_TEST_EQUAL_STR (ufr_args_gets (level, buffer1, names[i], "-"), ufr_args_gets (&flat, buffer2, names[i], "-"));
+            }
+            level = ufr_args_child (level);
+            i_level += 1;
+        }
+        UFR_TEST_EQUAL (i_level, 4);
+
+        const ufr_args_t* l1 = ufr_args_child (&args);
+        UFR_TEST_EQUAL_STR (ufr_args_gets (l1, buffer1, "@new", ""), "opencv");
+        UFR_TEST_EQUAL_STR (ufr_args_gets (l1, buffer1, "@x", "-"), "");
+        UFR_TEST_EQUAL_STR (ufr_args_gets (ufr_args_child (l1), buffer1, "@new", ""), "face");
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (ufr_args_child (l1), "@@id", -1), 3);
+        ufr_args_free (&args);
+        UFR_TEST_NULL (ufr_args_index (&args));
+        UFR_TEST_NULL (ufr_args_child (&args));
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: os filhos usam os argumentos %d/%p do pai
+    {
+        int valor = 0;
+        ufr_args_t args = {.text="@port %d @@port %d @@ptr %p @@name 'a b' @sub"};
+        args.arg[0].i32 = 80;
+        args.arg[1].i32 = 8080;
+        args.arg[2].ptr = &valor;
+
+        printf ("          Teste 2 - argumentos variaveis nos niveis\n\n");
+        UFR_TEST_OK (ufr_args_compile_tree (&args));
+        const ufr_args_t* l1 = ufr_args_child (&args);
+        UFR_TEST_NOT_NULL (l1);
+        UFR_TEST_NULL (ufr_args_child (l1));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@port", 0), 80);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (l1, "@port", 0), 8080);
+        UFR_TEST_TRUE ((ufr_args_getp (l1, "@ptr", NULL) == &valor));
+        UFR_TEST_EQUAL_U32 (ufr_args_getu (l1, "@sub", 5), 5);
+        char buffer[UFR_ARGS_TOKEN];
+        UFR_TEST_EQUAL_STR (ufr_args_gets (l1, buffer, "@name", ""), "a b");
+        ufr_args_free (&args);
+
+        // escritas na raiz depois da compilacao chegam aos filhos
+        ufr_args_t raiz = {.text="@x %d @@y %d @@z %d @@w %d @@v %d @@u %d @@t %d @@s %d"};
+        raiz.arg[1].i32 = 2;
+        UFR_TEST_OK (ufr_args_compile_tree (&raiz));
+        const ufr_args_t* filho = ufr_args_child (&raiz);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (filho, "@y", 0), 2);
+        raiz.arg[1].i32 = 42;
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (filho, "@y", 0), 42);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (filho, "@s", -1), -1);
+
+        // o vetor externo da raiz pode crescer depois da compilacao
+        ufr_args_arg (&raiz, 7)->i32 = 77;
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (filho, "@s", -1), 77);
+        ufr_args_arg (&raiz, 100)->i32 = 1;
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (filho, "@s", -1), 77);
+        ufr_args_free (&raiz);
+
+        // texto sem niveis
+        ufr_args_t flat = {.text="@a 1 @b 2"};
+        UFR_TEST_OK (ufr_args_compile_tree (&flat));
+        UFR_TEST_NULL (ufr_args_child (&flat));
+        ufr_args_free (&flat);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+
+
+void test_ufr_args_library () {
+
+    printf ("==========Iniciando testes p/ ufr_args_load_library==========\n");
+    printf ("\n");
+
+    // Teste 1: construtores de libufr_gtw_test.so
+    {
+        typedef int (*test_new_t)(void*, int);
+        printf ("          Teste 1 - carregamento e cache\n\n");
+        test_new_t pipe = (test_new_t) ufr_args_load_library ("gtw", "test", "pipe");
+        UFR_TEST_NOT_NULL (pipe);
+        UFR_TEST_EQUAL_I32 (pipe (NULL, 0), 2);
+        UFR_TEST_TRUE (((void*) pipe == ufr_args_load_library ("gtw", "test", "pipe")));
+
+        test_new_t def = (test_new_t) ufr_args_load_library ("gtw", "test", "");
+        UFR_TEST_NOT_NULL (def);
+        UFR_TEST_EQUAL_I32 (def (NULL, 0), 1);
+        UFR_TEST_NULL (ufr_args_load_library ("gtw", "test", "naoexiste"));
+        UFR_TEST_NULL (ufr_args_load_library ("gtw", "naoexiste", "pipe"));
+
+        // nomes que nao cabem nos buffers internos falham em vez de truncar
+        char longo[1100];
+        memset (longo, 'x', sizeof(longo) - 1);
+        longo[sizeof(longo) - 1] = '\0';
+        UFR_TEST_NULL (ufr_args_load_library ("gtw", longo, "pipe"));
+        UFR_TEST_NULL (ufr_args_load_library ("gtw", &longo[100], ""));
+        UFR_TEST_NULL (ufr_args_load_library ("gtw", "test", &longo[89]));
+
+        // pelo texto dos argumentos
+        int valor = 0;
+        ufr_args_t args = {.text="@new test:file @@new test @sub %p", .arg[0].ptr=&valor};
+        test_new_t file = (test_new_t) ufr_args_getfunc (&args, "gtw", "@new", NULL);
+        UFR_TEST_NOT_NULL (file);
+        UFR_TEST_EQUAL_I32 (file (NULL, 0), 3);
+        UFR_TEST_TRUE ((ufr_args_getfunc (&args, "gtw", "@@new", NULL) == (void*) def));
+        UFR_TEST_TRUE ((ufr_args_getfunc (&args, "gtw", "@sub", NULL) == &valor));
+        UFR_TEST_NULL (ufr_args_getfunc (&args, "gtw", "@naoexiste", NULL));
+
+        // valor longo demais para o buffer do getfunc falha em vez de truncar
+        char texto[700];
+        memset (texto, 'x', sizeof(texto) - 1);
+        texto[sizeof(texto) - 1] = '\0';
+        memcpy (texto, "@new test:", 10);
+        ufr_args_t longos = {.text=texto};
+        UFR_TEST_NULL (ufr_args_getfunc (&longos, "gtw", "@new", (void*) def));
+
+        // pre-carregamento
+        ufr_args_unload_libraries ();
+        UFR_TEST_EQUAL (ufr_args_preload_libraries ("gtw", "test:pipe test:file test"), 0);
+        UFR_TEST_EQUAL (ufr_args_preload_libraries ("gtw", "test:pipe naoexiste:x"), 1);
+        pipe = (test_new_t) ufr_args_load_library ("gtw", "test", "pipe");
+        UFR_TEST_EQUAL_I32 (pipe (NULL, 0), 2);
+        ufr_args_unload_libraries ();
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+
+
+void test_ufr_args_try_get () {
+
+    printf ("==========Iniciando testes p/ ufr_args_try_get==========\n");
+    printf ("\n");
+
+    // Teste 1: conversao estrita, com e sem indice
+    {
+        ufr_args_t args = {.text="@a 10 @b -7 @c 10x @d 1.5e3 @e '42' @f 99999999999 @g -1 @h 1,5 @i %d @j %s @k %f @l %p @m @n 1e400 @o 2 @o 3 @p %p @p 4 @q .5 @r - @s 1e"};
+        int valor = 0;
+        args.arg[0].i32 = -3;
+        args.arg[1].str = "2.25";
+        args.arg[2].f32 = 8.0;
+        args.arg[3].ptr = &valor;
+        args.arg[4].ptr = &valor;
+
+        printf ("          Teste 1 - try_getu, try_geti e try_getf\n\n");
+        for (int i=0; i<2; i++) {
+            if ( i == 1 ) {
+                UFR_TEST_OK (ufr_args_compile (&args));
+            }
+            size_t u = 0;
+            int v = 0;
+            float f = 0.0;
+            UFR_TEST_OK (ufr_args_try_getu (&args, "@a", &u));
+            UFR_TEST_EQUAL_U32 (u, 10);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@b", &v));
+            UFR_TEST_EQUAL_I32 (v, -7);
+            UFR_TEST_EQUAL (ufr_args_try_getu (&args, "@b", &u), UFR_ARGS_ERROR_RANGE);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@c", &v), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@d", &v), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_OK (ufr_args_try_getf (&args, "@d", &f));
+            UFR_TEST_EQUAL_F32 (f, 1500.0);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@e", &v));
+            UFR_TEST_EQUAL_I32 (v, 42);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@f", &v), UFR_ARGS_ERROR_RANGE);
+            UFR_TEST_OK (ufr_args_try_getf (&args, "@g", &f));
+            UFR_TEST_EQUAL_F32 (f, -1.0);
+            UFR_TEST_EQUAL (ufr_args_try_getf (&args, "@h", &f), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@i", &v));
+            UFR_TEST_EQUAL_I32 (v, -3);
+            UFR_TEST_EQUAL (ufr_args_try_getu (&args, "@i", &u), UFR_ARGS_ERROR_RANGE);
+            UFR_TEST_OK (ufr_args_try_getf (&args, "@j", &f));
+            UFR_TEST_EQUAL_F32 (f, 2.25);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@j", &v), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@k", &v));
+            UFR_TEST_EQUAL_I32 (v, 8);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@l", &v), UFR_ARGS_ERROR_NOTFOUND);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@m", &v), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_EQUAL (ufr_args_try_getf (&args, "@n", &f), UFR_ARGS_ERROR_RANGE);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@o", &v));
+            UFR_TEST_EQUAL_I32 (v, 2);
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@p", &v));
+            UFR_TEST_EQUAL_I32 (v, 4);
+            UFR_TEST_OK (ufr_args_try_getf (&args, "@q", &f));
+            UFR_TEST_EQUAL_F32 (f, 0.5);
+            UFR_TEST_EQUAL (ufr_args_try_getf (&args, "@r", &f), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_EQUAL (ufr_args_try_getf (&args, "@s", &f), UFR_ARGS_ERROR_INVALID);
+            UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@naoexiste", &v), UFR_ARGS_ERROR_NOTFOUND);
+            UFR_TEST_EQUAL_I32 (v, 4);
+
+            // os getters continuam com o comportamento do atoi
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@c", 0), 10);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@d", 0), 1);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@d", 0.0), 1500.0);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@e", 0), 42);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@j", 0.0), 2.25);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@j", 0), 2);
+        }
+        ufr_args_free (&args);
+
+        // %s trocado depois da compilacao e convertido de novo
+        int v = 0;
+        float f = 0.0;
+        ufr_args_t texto = {.text="@n %s"};
+        char numero[8] = "10";
+        texto.arg[0].str = numero;
+        UFR_TEST_OK (ufr_args_compile (&texto));
+        UFR_TEST_OK (ufr_args_try_geti (&texto, "@n", &v));
+        UFR_TEST_EQUAL_I32 (v, 10);
+        texto.arg[0].str = "7";
+        UFR_TEST_OK (ufr_args_try_geti (&texto, "@n", &v));
+        UFR_TEST_EQUAL_I32 (v, 7);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&texto, "@n", 0), 7);
+        texto.arg[0].str = numero;
+        strcpy (numero, "2.5");
+        UFR_TEST_OK (ufr_args_try_getf (&texto, "@n", &f));
+        UFR_TEST_EQUAL_F32 (f, 2.5);
+        UFR_TEST_EQUAL (ufr_args_try_geti (&texto, "@n", &v), UFR_ARGS_ERROR_INVALID);
+        ufr_args_free (&texto);
+
+        // filho do compile_tree le o %s atual da raiz
+        ufr_args_t raiz = {.text="@a 1 @@n %s"};
+        raiz.arg[0].str = "3";
+        UFR_TEST_OK (ufr_args_compile_tree (&raiz));
+        const ufr_args_t* filho = ufr_args_child (&raiz);
+        UFR_TEST_OK (ufr_args_try_geti (filho, "@n", &v));
+        UFR_TEST_EQUAL_I32 (v, 3);
+        raiz.arg[0].str = "7";
+        UFR_TEST_OK (ufr_args_try_geti (filho, "@n", &v));
+        UFR_TEST_EQUAL_I32 (v, 7);
+        UFR_TEST_EQUAL_U32 (ufr_args_getu (filho, "@n", 0), 7);
+        ufr_args_free (&raiz);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: limites do conversor
+    {
+        ufr_args_t args = {.text="@max 9223372036854775807 @min -9223372036854775808 @over -9223372036854775809 @int 2147483648 @big 123456789012345678901234 @tiny 1e-400"};
+
+        printf ("          Teste 2 - limites\n\n");
+        UFR_TEST_OK (ufr_args_compile (&args));
+        const ufr_args_entry_t* entries = ufr_args_index (&args)->entries;
+        UFR_TEST_EQUAL (entries[0].number.i64_status, UFR_OK);
+        UFR_TEST_TRUE ((entries[0].number.i64 == INT64_MAX));
+        UFR_TEST_EQUAL (entries[1].number.i64_status, UFR_OK);
+        UFR_TEST_TRUE ((entries[1].number.i64 == INT64_MIN));
+        UFR_TEST_EQUAL (entries[2].number.i64_status, UFR_ARGS_ERROR_RANGE);
+        UFR_TEST_EQUAL (entries[2].number.f64_status, UFR_OK);
+
+        int v = 0;
+        float f = 0.0;
+        UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@int", &v), UFR_ARGS_ERROR_RANGE);
+        UFR_TEST_OK (ufr_args_try_getf (&args, "@big", &f));
+        UFR_TEST_TRUE ((f > 1.2345678e23 && f < 1.2345680e23));
+        UFR_TEST_OK (ufr_args_try_getf (&args, "@tiny", &f));
+        UFR_TEST_EQUAL_F32 (f, 0.0);
+        ufr_args_free (&args);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
+
+
+static int test_load_from_va (ufr_args_t* args, const char* text, ...) {
+    va_list list;
+    va_start (list, text);
+    const int error = ufr_args_load_from_va (args, text, list);
+    va_end (list);
+    return error;
+}
+
+void test_ufr_args_spill () {
+
+    printf ("==========Iniciando testes p/ argumentos alem de arg[6]==========\n");
+    printf ("\n");
+
+    // Teste 1: load_from_va com todos os tipos e mais de 7 argumentos
+    {
+        int valor = 0;
+        char buffer[UFR_ARGS_TOKEN];
+        ufr_args_t args;
+        printf ("          Teste 1 - load_from_va\n\n");
+        UFR_TEST_OK (test_load_from_va (&args,
+            "@a %d @b %f @c %s @d %p @e 5 @f %d @g %d @h %d @i %f @j %s @k %p @l %d @m %x @n %d",
+            1, 2.5, "tres", &valor, 6, 7, 8, 9.5, "dez", &valor, 12, 14));
+        UFR_TEST_NOT_NULL (ufr_args_spill (&args));
+        UFR_TEST_EQUAL_U32 (ufr_args_spill (&args)->count, 6);
+        for (int i=0; i<2; i++) {
+            if ( i == 1 ) {
+                UFR_TEST_OK (ufr_args_compile (&args));
+            }
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@a", 0), 1);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@b", 0.0), 2.5);
+            UFR_TEST_EQUAL_STR (ufr_args_gets (&args, buffer, "@c", ""), "tres");
+            UFR_TEST_TRUE ((ufr_args_getp (&args, "@d", NULL) == &valor));
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@e", 0), 5);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@g", 0), 7);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@h", 0), 8);
+            UFR_TEST_EQUAL_F32 (ufr_args_getf (&args, "@i", 0.0), 9.5);
+            UFR_TEST_EQUAL_STR (ufr_args_gets (&args, buffer, "@j", ""), "dez");
+            UFR_TEST_TRUE ((ufr_args_getp (&args, "@k", NULL) == &valor));
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@l", 0), 12);
+            UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@n", 0), 14);
+            int v = 0;
+            UFR_TEST_OK (ufr_args_try_geti (&args, "@n", &v));
+            UFR_TEST_EQUAL_I32 (v, 14);
+            float f = 0.0;
+            UFR_TEST_EQUAL (ufr_args_try_getf (&args, "@j", &f), UFR_ARGS_ERROR_INVALID);
+        }
+        ufr_args_free (&args);
+        UFR_TEST_NULL (ufr_args_spill (&args));
+        UFR_TEST_NULL (ufr_args_index (&args));
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 2: ufr_args_arg e argumentos nao preenchidos
+    {
+        ufr_args_t args = {.text="@a %d @b %d @c %d @d %d @e %d @f %d @g %d @h %d @i %s @j %p"};
+        printf ("          Teste 2 - ufr_args_arg\n\n");
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@h", -1), -1);
+        UFR_TEST_NULL (ufr_args_getp (&args, "@j", NULL));
+        UFR_TEST_TRUE ((ufr_args_arg (&args, 3) == &args.arg[3]));
+        UFR_TEST_NULL (ufr_args_spill (&args));
+        ufr_args_arg (&args, 7)->i32 = 80;
+        UFR_TEST_EQUAL_U32 (ufr_args_spill (&args)->count, 1);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@h", -1), 80);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@i", -1), -1);
+        int v = 0;
+        UFR_TEST_EQUAL (ufr_args_try_geti (&args, "@i", &v), UFR_ARGS_ERROR_INVALID);
+
+        // o vetor cresce e mantem os valores
+        ufr_args_arg (&args, 100)->i32 = 5;
+        UFR_TEST_EQUAL_U32 (ufr_args_spill (&args)->count, 94);
+        UFR_TEST_TRUE ((ufr_args_spill (&args)->max >= 94));
+        UFR_TEST_EQUAL_I32 (ufr_args_arg (&args, 7)->i32, 80);
+        UFR_TEST_EQUAL_I32 (ufr_args_arg (&args, 50)->i32, 0);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@h", -1), 80);
+        ufr_args_arg (&args, 8)->str = "9";
+        UFR_TEST_OK (ufr_args_compile_tree (&args));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@i", -1), 9);
+        UFR_TEST_NOT_NULL (ufr_args_spill (&args));
+        ufr_args_free (&args);
+        UFR_TEST_NULL (ufr_args_spill (&args));
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    // Teste 3: estado fora da estrutura; copias nao dividem o indice
+    {
+        const char* text = "@a %d @b %d @c %d @d %d @e %d @f %d @g %d @h %d @x 3";
+        ufr_args_t args = {.text=text};
+        printf ("          Teste 3 - 64 bytes e copias\n\n");
+        UFR_TEST_EQUAL_U64 (sizeof (ufr_args_t), 64);
+        args.arg[0].i32 = 1;
+        ufr_args_arg (&args, 7)->i32 = 8;
+        UFR_TEST_OK (ufr_args_compile (&args));
+
+        // a copia le o texto e arg[], sem o indice e o vetor externo
+        ufr_args_t copia = args;
+        UFR_TEST_NULL (ufr_args_index (&copia));
+        UFR_TEST_NULL (ufr_args_spill (&copia));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&copia, "@a", 0), 1);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&copia, "@x", 0), 3);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&copia, "@h", -1), -1);
+        ufr_args_free (&copia);
+        UFR_TEST_NOT_NULL (ufr_args_index (&args));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@h", -1), 8);
+        ufr_args_free (&args);
+        ufr_args_free (&args);
+        UFR_TEST_NULL (ufr_args_index (&args));
+
+        // outro texto no mesmo endereco nao usa o estado antigo
+        UFR_TEST_OK (ufr_args_compile (&args));
+        args.text = "@x 4";
+        UFR_TEST_NULL (ufr_args_index (&args));
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@x", 0), 4);
+        UFR_TEST_OK (ufr_args_compile (&args));
+        UFR_TEST_EQUAL_U32 (ufr_args_index (&args)->count, 1);
+        UFR_TEST_EQUAL_I32 (ufr_args_geti (&args, "@x", 0), 4);
+        ufr_args_free (&args);
+
+        // muitos ufr_args_t com estado ao mesmo tempo
+        ufr_args_t* many = calloc (1000, sizeof (ufr_args_t));
+        for (int i=0; i<1000; i++) {
+            many[i].text = text;
+            ufr_args_arg (&many[i], 7)->i32 = i;
+        }
+        int errors = 0;
+        for (int i=0; i<1000; i++) {
+            errors += ufr_args_geti (&many[i], "@h", -1) != i;
+            ufr_args_free (&many[i]);
+        }
+        UFR_TEST_ZERO (errors);
+        free (many);
+
+        ufr_test_print_result ();
+        printf ("------------------------------------------------------------------------------");
+        printf ("\n");
+    }
+
+    printf ("\n");
+}
+
 
 
 int main () {
 
     test_ufr_args_flex_div ();
+    test_ufr_args_flex_span ();
+    test_ufr_args_simd ();
+    test_ufr_args_compile ();
+    test_ufr_args_get_many ();
+    test_ufr_args_schema ();
+    test_ufr_args_tree ();
+    test_ufr_args_library ();
+    test_ufr_args_try_get ();
+    test_ufr_args_spill ();
 
     return 0;
 }
\ No newline at end of file
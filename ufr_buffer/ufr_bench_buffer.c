@@ -0,0 +1,771 @@
+/* BSD 2-Clause License
+ * 
+ * Copyright (c) 2024, Visao Robotica e Imagem (VRI)
+ *  - Felipe Bombardelli <felipebombardelli@gmail.com>
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// ============================================================================
+//  Header
+// ============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ufr_buffer.h"
+
+// ============================================================================
+//  Benchmark
+// ============================================================================
+
+// evita que o compilador descarte os resultados
+static volatile int g_bench_sink;
+
+static double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Caminho antigo de ufr_buffer_put_i32_as_str, usado como referencia.
+static void bench_put_i32_snprintf(ufr_buffer_t* buffer, int32_t val) {
+    ufr_buffer_check_size(buffer, 15);
+    char* base = &buffer->ptr[buffer->size];
+    size_t size = 0;
+    if ( buffer->size == 0 ) {
+        size = snprintf(base, 15, "%d", val);
+    } else {
+        size = snprintf(base, 15, " %d", val);
+    }
+    buffer->size += size;
+}
+
+// Numeros/segundo escritos no buffer, que e limpo a cada 1000 numeros como
+// em uma mensagem de telemetria.
+static double bench_numbers(const int32_t* values, const int count, const int rounds, const int mode) {
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<count; i++) {
+            if ( mode == 0 ) {
+                bench_put_i32_snprintf(&buffer, values[i]);
+            } else {
+                ufr_buffer_put_i32_as_str(&buffer, values[i]);
+            }
+        }
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time = bench_now() - ini;
+    ufr_buffer_free(&buffer);
+    return (double) count * rounds / time;
+}
+
+// Compara snprintf com a conversao por tabela para inteiros pequenos, tipicos
+// de telemetria, e para inteiros de 32 bits quaisquer.
+void bench_integers() {
+    const int count = 1000;
+    const int rounds = 5000;
+    int32_t small[1000];
+    int32_t large[1000];
+    srand(10);
+    for (int i=0; i<count; i++) {
+        small[i] = rand() % 2000 - 1000;
+        large[i] = (int32_t) (((uint32_t) rand() << 16) ^ (uint32_t) rand());
+    }
+
+    printf("i32 pequeno, snprintf:    %8.2f Mnumeros/s\n", bench_numbers(small, count, rounds, 0) / 1e6);
+    printf("i32 pequeno, tabela:      %8.2f Mnumeros/s\n", bench_numbers(small, count, rounds, 1) / 1e6);
+    printf("i32 qualquer, snprintf:   %8.2f Mnumeros/s\n", bench_numbers(large, count, rounds, 0) / 1e6);
+    printf("i32 qualquer, tabela:     %8.2f Mnumeros/s\n", bench_numbers(large, count, rounds, 1) / 1e6);
+}
+
+// Caminho antigo de ufr_buffer_put_f32_as_str e "%.17g" para double, que e
+// o que seria preciso para o snprintf garantir a ida e volta.
+static void bench_put_float_snprintf(ufr_buffer_t* buffer, double val, const int is_f64) {
+    ufr_buffer_check_size(buffer, 32);
+    char* base = &buffer->ptr[buffer->size];
+    const char* format;
+    if ( is_f64 ) {
+        format = ( buffer->size == 0 ) ? "%.17g" : " %.17g";
+    } else {
+        format = ( buffer->size == 0 ) ? "%f" : " %f";
+    }
+    buffer->size += snprintf(base, 32, format, val);
+}
+
+// Numeros/segundo de float e double, como em bench_numbers.
+static double bench_float_numbers(const double* values, const int count, const int rounds, const int mode) {
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<count; i++) {
+            switch (mode) {
+                case 0: bench_put_float_snprintf(&buffer, (float) values[i], 0); break;
+                case 1: ufr_buffer_put_f32_as_str(&buffer, (float) values[i]); break;
+                case 2: bench_put_float_snprintf(&buffer, values[i], 1); break;
+                default: ufr_buffer_put_f64_as_str(&buffer, values[i]); break;
+            }
+        }
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time = bench_now() - ini;
+    ufr_buffer_free(&buffer);
+    return (double) count * rounds / time;
+}
+
+// Compara snprintf com o texto curto (Grisu2) para leituras de sensores.
+void bench_floats() {
+    const int count = 1000;
+    const int rounds = 2000;
+    double values[1000];
+    srand(10);
+    for (int i=0; i<count; i++) {
+        values[i] = (rand() / (double) RAND_MAX - 0.5) * 200.0;
+    }
+
+    printf("f32, snprintf \"%%f\":      %8.2f Mnumeros/s\n", bench_float_numbers(values, count, rounds, 0) / 1e6);
+    printf("f32, texto curto:         %8.2f Mnumeros/s\n", bench_float_numbers(values, count, rounds, 1) / 1e6);
+    printf("f64, snprintf \"%%.17g\":   %8.2f Mnumeros/s\n", bench_float_numbers(values, count, rounds, 2) / 1e6);
+    printf("f64, texto curto:         %8.2f Mnumeros/s\n", bench_float_numbers(values, count, rounds, 3) / 1e6);
+}
+
+// Scan de laser de 1080 pontos: uma chamada por elemento contra uma
+// chamada para o vetor todo.
+void bench_arrays() {
+    const int rounds = 2000;
+    float scan[1080];
+    int32_t ticks[1080];
+    for (int i=0; i<1080; i++) {
+        scan[i] = (float) i * 0.0137f - 3.0f;
+        ticks[i] = i * 37 - 20000;
+    }
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<1080; i++) {
+            ufr_buffer_put_f32_as_str(&buffer, scan[i]);
+        }
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_f32 = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        ufr_buffer_put_f32_array(&buffer, scan, 1080);
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_f32_array = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<1080; i++) {
+            ufr_buffer_put_i32_as_str(&buffer, ticks[i]);
+        }
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_i32 = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        ufr_buffer_put_i32_array(&buffer, ticks, 1080);
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_i32_array = bench_now() - ini;
+    ufr_buffer_free(&buffer);
+
+    printf("1080 x put_f32_as_str:    %8.2f us/scan\n", time_f32 / rounds * 1e6);
+    printf("put_f32_array:            %8.2f us/scan\n", time_f32_array / rounds * 1e6);
+    printf("1080 x put_i32_as_str:    %8.2f us/scan\n", time_i32 / rounds * 1e6);
+    printf("put_i32_array:            %8.2f us/scan\n", time_i32_array / rounds * 1e6);
+}
+
+// Scan de 1080 floats escrito e lido de volta, no modo texto e no binario.
+static double bench_mode_scan(const float* scan, const uint8_t mode, const int rounds) {
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    ufr_buffer_set_mode(&buffer, mode);
+    ufr_buffer_reader_t reader;
+    float sum = 0;
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<1080; i++) {
+            ufr_buffer_put_f32(&buffer, scan[i]);
+        }
+        ufr_buffer_reader_init(&reader, buffer.ptr, buffer.size, buffer.mode);
+        float val;
+        while ( ufr_buffer_get_f32(&reader, &val) == UFR_OK ) {
+            sum += val;
+        }
+    }
+    const double time = bench_now() - ini;
+    g_bench_sink += (int) sum;
+    ufr_buffer_free(&buffer);
+    return time / rounds;
+}
+
+void bench_modes() {
+    const int rounds = 2000;
+    float scan[1080];
+    for (int i=0; i<1080; i++) {
+        scan[i] = (float) i * 0.0137f - 3.0f;
+    }
+    printf("scan texto (ida e volta):   %8.2f us\n", bench_mode_scan(scan, UFR_BUFFER_TEXT, rounds) * 1e6);
+    printf("scan binario (ida e volta): %8.2f us\n", bench_mode_scan(scan, UFR_BUFFER_BINARY, rounds) * 1e6);
+}
+
+// Le de volta um scan de 1080 floats e 1080 inteiros em texto, com sscanf
+// e %n para avancar no texto, e com o leitor.
+void bench_reader() {
+    const int rounds = 2000;
+    float scan[1080];
+    int32_t ticks[1080];
+    for (int i=0; i<1080; i++) {
+        scan[i] = (float) i * 0.0137f - 3.0f;
+        ticks[i] = i * 37 - 20000;
+    }
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    ufr_buffer_put_f32_array(&buffer, scan, 1080);
+    ufr_buffer_put_i32_array(&buffer, ticks, 1080);
+
+    float sum = 0;
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        const char* p = buffer.ptr;
+        int n;
+        float val;
+        int ival;
+        for (int i=0; i<1080; i++) {
+            sscanf(p, "%f%n", &val, &n);
+            p += n;
+            sum += val;
+        }
+        for (int i=0; i<1080; i++) {
+            sscanf(p, "%d%n", &ival, &n);
+            p += n;
+            sum += ival;
+        }
+    }
+    const double time_sscanf = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_reader_t reader;
+        ufr_buffer_reader_init(&reader, buffer.ptr, buffer.size, UFR_BUFFER_TEXT);
+        float val;
+        int32_t ival;
+        for (int i=0; i<1080; i++) {
+            ufr_buffer_get_f32(&reader, &val);
+            sum += val;
+        }
+        for (int i=0; i<1080; i++) {
+            ufr_buffer_get_i32(&reader, &ival);
+            sum += ival;
+        }
+    }
+    const double time_reader = bench_now() - ini;
+    g_bench_sink += (int) sum;
+    ufr_buffer_free(&buffer);
+
+    printf("2160 valores, sscanf:     %8.2f us/scan\n", time_sscanf / rounds * 1e6);
+    printf("2160 valores, leitor:     %8.2f us/scan\n", time_reader / rounds * 1e6);
+}
+
+// Frame de 4 MB copiado em blocos de 64 KB para um buffer novo, partindo
+// de MESSAGE_ITEM_SIZE e da capacidade exata.
+void bench_growth() {
+    const int rounds = 200;
+    const size_t frame = 4 << 20;
+    const size_t block = 64 << 10;
+    char* data = malloc(block);
+    memset(data, 'x', block);
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_t buffer;
+        ufr_buffer_init(&buffer);
+        for (size_t i=0; i<frame; i+=block) {
+            ufr_buffer_put(&buffer, data, block);
+        }
+        g_bench_sink += (int) buffer.size;
+        ufr_buffer_free(&buffer);
+    }
+    const double time_init = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_t buffer;
+        ufr_buffer_init_with_capacity(&buffer, frame + 1);
+        for (size_t i=0; i<frame; i+=block) {
+            ufr_buffer_put(&buffer, data, block);
+        }
+        g_bench_sink += (int) buffer.size;
+        ufr_buffer_free(&buffer);
+    }
+    const double time_capacity = bench_now() - ini;
+    free(data);
+
+    printf("frame 4 MB, init:         %8.2f us\n", time_init / rounds * 1e6);
+    printf("frame 4 MB, capacidade:   %8.2f us\n", time_capacity / rounds * 1e6);
+}
+
+static long bench_rss_kb() {
+    long pages = 0, resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if ( file == NULL ) {
+        return 0;
+    }
+    if ( fscanf(file, "%ld %ld", &pages, &resident) != 2 ) {
+        resident = 0;
+    }
+    fclose(file);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* Ciclo tipico de mensagens: cria um lote de buffers, escreve e libera. */
+static double bench_alloc_batch(ufr_buffer_allocator_t* allocator, ufr_buffer_arena_t* arena, const int rounds) {
+    enum { BATCH = 256 };
+    ufr_buffer_t* items[BATCH];
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        for (int i=0; i<BATCH; i++) {
+            items[i] = ufr_buffer_new_with_allocator(allocator);
+            ufr_buffer_put_i32_as_str(items[i], i);
+            // alguns buffers crescem alem da capacidade inicial
+            if ( (i & 7) == 0 ) {
+                ufr_buffer_check_size(items[i], 2000 + i * 16);
+            }
+        }
+        for (int i=0; i<BATCH; i++) {
+            g_bench_sink += (int) items[i]->size;
+            if ( arena == NULL ) {
+                ufr_buffer_delete(items[i]);
+            }
+        }
+        if ( arena ) {
+            ufr_buffer_arena_reset(arena);
+        }
+    }
+    return (bench_now() - ini) / ((double) rounds * BATCH);
+}
+
+void bench_allocators() {
+    const int rounds = 4000;
+    ufr_buffer_arena_t arena;
+    ufr_buffer_arena_init(&arena, 256 << 10);
+
+    const double time_malloc = bench_alloc_batch(NULL, NULL, rounds);
+    const long rss_malloc = bench_rss_kb();
+    const double time_pool = bench_alloc_batch(ufr_buffer_pool_allocator(), NULL, rounds);
+    const long rss_pool = bench_rss_kb();
+    const double time_arena = bench_alloc_batch(&arena.base, &arena, rounds);
+    const long rss_arena = bench_rss_kb();
+
+    ufr_buffer_arena_free(&arena);
+    ufr_buffer_pool_trim();
+
+    // RSS acumulado do processo apos cada alocador
+    printf("malloc: %8.2f ns/buffer %8ld kB RSS\n", time_malloc * 1e9, rss_malloc);
+    printf("pool:   %8.2f ns/buffer %8ld kB RSS\n", time_pool * 1e9, rss_pool);
+    printf("arena:  %8.2f ns/buffer %8ld kB RSS\n", time_arena * 1e9, rss_arena);
+}
+
+/* Mensagem de controle tipica, menor que UFR_BUFFER_INLINE_SIZE. */
+void bench_small_messages() {
+    const int rounds = 2000000;
+    const double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_t buffer;
+        ufr_buffer_init(&buffer);
+        ufr_buffer_put_str(&buffer, "cmd");
+        ufr_buffer_put_i32_as_str(&buffer, r);
+        ufr_buffer_put_f32_as_str(&buffer, 0.5f);
+        g_bench_sink += buffer.ptr[0] + (int) buffer.size;
+        ufr_buffer_free(&buffer);
+    }
+    const double time_small = bench_now() - ini;
+    printf("mensagem pequena:         %8.2f ns\n", time_small / rounds * 1e9);
+}
+
+/* Cabecalho seguido de um payload grande, enviado para /dev/null. */
+void bench_chain() {
+    const int rounds = 2000;
+    const size_t payload_size = 1 << 20;
+    char* payload = malloc(payload_size);
+    memset(payload, 'p', payload_size);
+    const char header[] = "frame 640 480 rgb8 ";
+    FILE* null = fopen("/dev/null", "w");
+    if ( null == NULL ) {
+        free(payload);
+        return;
+    }
+    const int fd = fileno(null);
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_t buffer;
+        ufr_buffer_init(&buffer);
+        ufr_buffer_put(&buffer, header, sizeof(header) - 1);
+        ufr_buffer_put(&buffer, payload, payload_size);
+        g_bench_sink += (int) write(fd, buffer.ptr, buffer.size);
+        ufr_buffer_free(&buffer);
+    }
+    const double time_flat = bench_now() - ini;
+
+    ufr_buffer_chain_t chain;
+    ufr_buffer_chain_init(&chain, 0);
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_chain_put(&chain, header, sizeof(header) - 1);
+        ufr_buffer_chain_put_ref(&chain, payload, payload_size);
+        g_bench_sink += (int) ufr_buffer_chain_writev(&chain, fd);
+        ufr_buffer_chain_clear(&chain);
+    }
+    const double time_chain = bench_now() - ini;
+    ufr_buffer_chain_free(&chain);
+    fclose(null);
+    free(payload);
+
+    printf("1 MB, buffer continuo:    %8.2f us\n", time_flat / rounds * 1e6);
+    printf("1 MB, cadeia + writev:    %8.2f us\n", time_chain / rounds * 1e6);
+}
+
+/* Troca de mensagens de 64 bytes entre threads: anel SPSC/MPSC contra a
+ * fila com mutex de ufr_buffer_t alocados no heap. */
+#define BENCH_RING_COUNT 200000
+#define BENCH_RING_MSG 64
+
+typedef struct _bench_queue_item {
+    struct _bench_queue_item* next;
+    ufr_buffer_t* buffer;
+} bench_queue_item_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    bench_queue_item_t* first;
+    bench_queue_item_t* last;
+} bench_queue_t;
+
+typedef struct {
+    ufr_buffer_ring_t* ring;
+    bench_queue_t* queue;
+    int count;
+} bench_ring_producer_t;
+
+static void* bench_ring_producer(void* arg) {
+    bench_ring_producer_t* producer = (bench_ring_producer_t*) arg;
+    for (int i=0; i<producer->count; i++) {
+        double* record;
+        while ( (record = ufr_buffer_ring_reserve(producer->ring, BENCH_RING_MSG)) == NULL ) {
+            sched_yield();
+        }
+        record[0] = bench_now();
+        ufr_buffer_ring_commit(producer->ring, record);
+    }
+    return NULL;
+}
+
+static void* bench_queue_producer(void* arg) {
+    bench_ring_producer_t* producer = (bench_ring_producer_t*) arg;
+    char msg[BENCH_RING_MSG] = {0};
+    for (int i=0; i<producer->count; i++) {
+        bench_queue_item_t* item = malloc(sizeof(bench_queue_item_t));
+        item->buffer = ufr_buffer_new();
+        const double now = bench_now();
+        memcpy(msg, &now, sizeof(now));
+        ufr_buffer_put(item->buffer, msg, BENCH_RING_MSG);
+        item->next = NULL;
+        pthread_mutex_lock(&producer->queue->mutex);
+        if ( producer->queue->last ) {
+            producer->queue->last->next = item;
+        } else {
+            producer->queue->first = item;
+        }
+        producer->queue->last = item;
+        pthread_mutex_unlock(&producer->queue->mutex);
+    }
+    return NULL;
+}
+
+/* mode: 0 = fila com mutex, 1 = SPSC, 2 = MPSC; retorna a latencia media. */
+static double bench_ring_run(const int mode, const int producers, double* time) {
+    ufr_buffer_ring_t ring;
+    bench_queue_t queue = {PTHREAD_MUTEX_INITIALIZER, NULL, NULL};
+    pthread_t threads[8];
+    bench_ring_producer_t args[8];
+    const int total = BENCH_RING_COUNT - BENCH_RING_COUNT % producers;
+    double latency = 0;
+
+    if ( mode > 0 ) {
+        ufr_buffer_ring_init(&ring, 64 << 10, mode == 1 ? UFR_BUFFER_RING_SPSC : UFR_BUFFER_RING_MPSC);
+    }
+    const double ini = bench_now();
+    for (int p=0; p<producers; p++) {
+        args[p].ring = &ring;
+        args[p].queue = &queue;
+        args[p].count = total / producers;
+        pthread_create(&threads[p], NULL, mode > 0 ? bench_ring_producer : bench_queue_producer, &args[p]);
+    }
+    for (int received=0; received<total; ) {
+        double sent;
+        if ( mode > 0 ) {
+            size_t size;
+            const double* record = ufr_buffer_ring_peek(&ring, &size);
+            if ( record == NULL ) {
+                sched_yield();
+                continue;
+            }
+            sent = record[0];
+            ufr_buffer_ring_release(&ring);
+        } else {
+            pthread_mutex_lock(&queue.mutex);
+            bench_queue_item_t* item = queue.first;
+            if ( item ) {
+                queue.first = item->next;
+                if ( queue.first == NULL ) {
+                    queue.last = NULL;
+                }
+            }
+            pthread_mutex_unlock(&queue.mutex);
+            if ( item == NULL ) {
+                sched_yield();
+                continue;
+            }
+            memcpy(&sent, item->buffer->ptr, sizeof(sent));
+            ufr_buffer_delete(item->buffer);
+            free(item);
+        }
+        latency += bench_now() - sent;
+        received += 1;
+    }
+    *time = bench_now() - ini;
+    for (int p=0; p<producers; p++) {
+        pthread_join(threads[p], NULL);
+    }
+    if ( mode > 0 ) {
+        ufr_buffer_ring_free(&ring);
+    }
+    return latency / total;
+}
+
+void bench_ring() {
+    const char* names[] = {"mutex", "SPSC ", "MPSC "};
+    const int producers[] = {1, 2, 4};
+    for (int mode=0; mode<3; mode++) {
+        for (int p=0; p<3; p++) {
+            if ( mode == 1 && producers[p] > 1 ) {
+                continue;
+            }
+            double time;
+            const double latency = bench_ring_run(mode, producers[p], &time);
+            printf("%s %d produtor(es): %8.2f Mmsg/s %10.2f us latencia\n", names[mode], producers[p],
+                   BENCH_RING_COUNT / time / 1e6, latency * 1e6);
+        }
+    }
+}
+
+/* Gravacao de 64 MB em mensagens de 4 KB e reproducao: fwrite/fread
+ * contra o arquivo mapeado. */
+void bench_file() {
+    const char* path = "/tmp/ufr_bench_buffer.rec";
+    const uint32_t msg_size = 4096;
+    const int count = (64 << 20) / msg_size;
+    char* msg = malloc(msg_size);
+    memset(msg, 'm', msg_size);
+
+    // fwrite de cada mensagem, com o tamanho na frente
+    double ini = bench_now();
+    FILE* fp = fopen(path, "wb");
+    if ( fp == NULL ) {
+        free(msg);
+        return;
+    }
+    for (int i=0; i<count; i++) {
+        fwrite(&msg_size, sizeof(msg_size), 1, fp);
+        fwrite(msg, msg_size, 1, fp);
+    }
+    fclose(fp);
+    const double time_fwrite = bench_now() - ini;
+
+    // fread de cada mensagem para um ufr_buffer_t
+    ini = bench_now();
+    fp = fopen(path, "rb");
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    uint32_t size;
+    while ( fread(&size, sizeof(size), 1, fp) == 1 ) {
+        ufr_buffer_clear(&buffer);
+        char* base = ufr_buffer_reserve(&buffer, size);
+        ufr_buffer_commit(&buffer, fread(base, 1, size, fp));
+        g_bench_sink += buffer.ptr[size - 1];
+    }
+    ufr_buffer_free(&buffer);
+    fclose(fp);
+    const double time_fread = bench_now() - ini;
+
+    // gravacao direto no arquivo mapeado, em um arquivo novo como o fwrite
+    unlink(path);
+    ufr_buffer_file_t file;
+    ini = bench_now();
+    if ( ufr_buffer_file_create(&file, &buffer, path, 1 << 20) != UFR_OK ) {
+        free(msg);
+        return;
+    }
+    ufr_buffer_set_mode(&buffer, UFR_BUFFER_BINARY);
+    for (int i=0; i<count; i++) {
+        ufr_buffer_put_u32(&buffer, msg_size);
+        char* base = ufr_buffer_reserve(&buffer, msg_size);
+        memcpy(base, msg, msg_size);
+        ufr_buffer_commit(&buffer, msg_size);
+    }
+    ufr_buffer_file_close(&file, &buffer);
+    const double time_map_write = bench_now() - ini;
+
+    // reproducao sem copia, com o leitor no mapeamento
+    ini = bench_now();
+    ufr_buffer_file_open(&file, path);
+    ufr_buffer_reader_t reader;
+    ufr_buffer_reader_init(&reader, file.map, file.size, UFR_BUFFER_BINARY);
+    while ( ufr_buffer_get_u32(&reader, &size) == UFR_OK ) {
+        const char* view = ufr_buffer_get_view(&reader, 1, size);
+        g_bench_sink += view[size - 1];
+    }
+    ufr_buffer_file_close(&file, NULL);
+    const double time_map_read = bench_now() - ini;
+
+    unlink(path);
+    free(msg);
+    printf("64 MB, fwrite:            %8.2f ms\n", time_fwrite * 1e3);
+    printf("64 MB, mmap gravacao:     %8.2f ms\n", time_map_write * 1e3);
+    printf("64 MB, fread:             %8.2f ms\n", time_fread * 1e3);
+    printf("64 MB, mmap reproducao:   %8.2f ms\n", time_map_read * 1e3);
+}
+
+/* Mensagem chave/valor com 50 strings, como uma lista de topicos. */
+void bench_put_strv() {
+    const int rounds = 200000;
+    const char* texts[50];
+    const char* keys[] = {"topic", "/robot/camera/rgb", "encoding", "rgb8", "width", "640",
+                          "height", "480", "frame_id", "camera_link"};
+    for (int i=0; i<50; i++) {
+        texts[i] = keys[i % 10];
+    }
+
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        for (int i=0; i<50; i++) {
+            ufr_buffer_put_str(&buffer, texts[i]);
+        }
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_str = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        ufr_buffer_put_strv(&buffer, texts, 50);
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_strv = bench_now() - ini;
+    ufr_buffer_free(&buffer);
+
+    printf("50 strings, put_str:      %8.2f ns\n", time_str / rounds * 1e9);
+    printf("50 strings, put_strv:     %8.2f ns\n", time_strv / rounds * 1e9);
+}
+
+/* Mensagem de pose: puts separados, ufr_buffer_putf e snprintf. */
+void bench_putf() {
+    const int rounds = 1000000;
+    ufr_buffer_t buffer;
+    ufr_buffer_init(&buffer);
+
+    double ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        ufr_buffer_put_str(&buffer, "pose");
+        ufr_buffer_put_i32_as_str(&buffer, r);
+        ufr_buffer_put_f32_as_str(&buffer, r * 0.25f);
+        ufr_buffer_put_f32_as_str(&buffer, -1.5f);
+        ufr_buffer_put_f32_as_str(&buffer, 0.125f);
+        ufr_buffer_put_str(&buffer, "base_link");
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_puts = bench_now() - ini;
+
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        ufr_buffer_clear(&buffer);
+        ufr_buffer_putf(&buffer, "%s %d %f %f %f %s", "pose", r, r * 0.25f, -1.5f, 0.125f, "base_link");
+        g_bench_sink += (int) buffer.size;
+    }
+    const double time_putf = bench_now() - ini;
+
+    char text[128];
+    ini = bench_now();
+    for (int r=0; r<rounds; r++) {
+        g_bench_sink += snprintf(text, sizeof(text), "%s %d %g %g %g %s", "pose", r, r * 0.25f, -1.5f, 0.125f, "base_link");
+    }
+    const double time_snprintf = bench_now() - ini;
+    ufr_buffer_free(&buffer);
+
+    printf("pose, puts separados:     %8.2f ns\n", time_puts / rounds * 1e9);
+    printf("pose, putf:               %8.2f ns\n", time_putf / rounds * 1e9);
+    printf("pose, snprintf:           %8.2f ns\n", time_snprintf / rounds * 1e9);
+}
+
+int main() {
+    bench_integers();
+    bench_floats();
+    bench_arrays();
+    bench_modes();
+    bench_reader();
+    bench_growth();
+    bench_allocators();
+    bench_small_messages();
+    bench_chain();
+    bench_ring();
+    bench_file();
+    bench_put_strv();
+    bench_putf();
+    return 0;
+}
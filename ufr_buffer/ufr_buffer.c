@@ -29,306 +29,3169 @@
 //  Header
 // ============================================================================
 
+// mremap
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <locale.h>
+#include <stddef.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ufr_buffer.h"
 
+// o modo binario e little-endian em qualquer maquina
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define UFR_BUFFER_LE16(x) __builtin_bswap16(x)
+#define UFR_BUFFER_LE32(x) __builtin_bswap32(x)
+#define UFR_BUFFER_LE64(x) __builtin_bswap64(x)
+#define UFR_BUFFER_HOST_LE 0
+#else
+#define UFR_BUFFER_LE16(x) (x)
+#define UFR_BUFFER_LE32(x) (x)
+#define UFR_BUFFER_LE64(x) (x)
+#define UFR_BUFFER_HOST_LE 1
+#endif
+
+// ============================================================================
+//  Conversao de inteiros
+// ============================================================================
+
+// pares de digitos "00" ate "99", indexados por 2 * valor
+static const char g_ufr_buffer_digits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Quantidade de digitos decimais de val. */
+static size_t ufr_buffer_count_digits(uint32_t val) {
+    if ( val < 10 ) return 1;
+    if ( val < 100 ) return 2;
+    if ( val < 1000 ) return 3;
+    if ( val < 10000 ) return 4;
+    if ( val < 100000 ) return 5;
+    if ( val < 1000000 ) return 6;
+    if ( val < 10000000 ) return 7;
+    if ( val < 100000000 ) return 8;
+    if ( val < 1000000000 ) return 9;
+    return 10;
+}
+
+/* Escreve val em decimal a partir de dst, dois digitos por vez, do fim
+ * para o inicio. Retorna a quantidade de caracteres escritos. */
+static size_t ufr_buffer_format_u32(char* dst, uint32_t val) {
+    const size_t len = ufr_buffer_count_digits(val);
+    char* end = &dst[len];
+    while ( val >= 100 ) {
+        const uint32_t pos = (val % 100) * 2;
+        val /= 100;
+        end -= 2;
+        end[0] = g_ufr_buffer_digits[pos];
+        end[1] = g_ufr_buffer_digits[pos + 1];
+    }
+    if ( val >= 10 ) {
+        end[-2] = g_ufr_buffer_digits[val * 2];
+        end[-1] = g_ufr_buffer_digits[val * 2 + 1];
+    } else {
+        end[-1] = (char) ('0' + val);
+    }
+    return len;
+}
+
+/* Escreve val em decimal com o sinal. */
+static size_t ufr_buffer_format_i32(char* dst, int32_t val) {
+    if ( val < 0 ) {
+        dst[0] = '-';
+        return 1 + ufr_buffer_format_u32(&dst[1], 0u - (uint32_t) val);
+    }
+    return ufr_buffer_format_u32(dst, (uint32_t) val);
+}
+
+/* Escreve val de 64 bits em decimal; valores de 32 bits usam
+ * ufr_buffer_format_u32. */
+static size_t ufr_buffer_format_u64(char* dst, uint64_t val) {
+    if ( val <= 0xFFFFFFFFULL ) {
+        return ufr_buffer_format_u32(dst, (uint32_t) val);
+    }
+    char tmp[20];
+    char* end = &tmp[20];
+    char* p = end;
+    while ( val >= 100 ) {
+        const uint32_t pos = (uint32_t) (val % 100) * 2;
+        val /= 100;
+        p -= 2;
+        p[0] = g_ufr_buffer_digits[pos];
+        p[1] = g_ufr_buffer_digits[pos + 1];
+    }
+    if ( val >= 10 ) {
+        p -= 2;
+        p[0] = g_ufr_buffer_digits[val * 2];
+        p[1] = g_ufr_buffer_digits[val * 2 + 1];
+    } else {
+        *--p = (char) ('0' + val);
+    }
+    memcpy(dst, p, (size_t) (end - p));
+    return (size_t) (end - p);
+}
+
+/* Adiciona o inteiro ao buffer, com espaco antes se o buffer nao estiver
+ * vazio e '-' se negative. O texto termina com '\0', fora de size. */
+static void ufr_buffer_put_integer(ufr_buffer_t* buffer, uint32_t val, int negative) {
+    // espaco + sinal + 10 digitos + '\0'
+    ufr_buffer_check_size(buffer, 13);
+    char* base = &buffer->ptr[buffer->size];
+    size_t size = 0;
+    if ( buffer->size > 0 ) {
+        base[size++] = ' ';
+    }
+    if ( negative ) {
+        base[size++] = '-';
+    }
+    size += ufr_buffer_format_u32(&base[size], val);
+    base[size] = '\0';
+    buffer->size += size;
+}
+
+// ============================================================================
+//  Conversao de ponto flutuante
+// ============================================================================
+
+/*
+ * Representacao decimal curta que volta ao mesmo valor (Grisu2, Loitsch 2010).
+ * O Grisu2 nem sempre acha o menor texto: em cerca de 0.1% dos double e 0.2%
+ * dos float sai um digito a mais (ex: 2.7183163742986588e+276, que volta com
+ * 16 digitos), mas a volta pelo strtod/strtof e sempre exata.
+ * O valor e seus vizinhos sao escalados por uma potencia de 10 em cache e os
+ * digitos sao gerados com aritmetica inteira de 64 bits, sem snprintf.
+ */
+
+// numero em ponto flutuante "do it yourself": f * 2^e
+typedef struct {
+    uint64_t f;
+    int e;
+} ufr_buffer_fp_t;
+
+typedef struct {
+    uint64_t f;
+    int16_t e;
+} ufr_buffer_pow10_t;
+
+// 10^k normalizado, para k = -348, -340, ..., 340
+static const ufr_buffer_pow10_t g_ufr_buffer_pow10[87] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, // 1e-348
+    {0xbaaee17fa23ebf76ULL, -1193}, // 1e-340
+    {0x8b16fb203055ac76ULL, -1166}, // 1e-332
+    {0xcf42894a5dce35eaULL, -1140}, // 1e-324
+    {0x9a6bb0aa55653b2dULL, -1113}, // 1e-316
+    {0xe61acf033d1a45dfULL, -1087}, // 1e-308
+    {0xab70fe17c79ac6caULL, -1060}, // 1e-300
+    {0xff77b1fcbebcdc4fULL, -1034}, // 1e-292
+    {0xbe5691ef416bd60cULL, -1007}, // 1e-284
+    {0x8dd01fad907ffc3cULL,  -980}, // 1e-276
+    {0xd3515c2831559a83ULL,  -954}, // 1e-268
+    {0x9d71ac8fada6c9b5ULL,  -927}, // 1e-260
+    {0xea9c227723ee8bcbULL,  -901}, // 1e-252
+    {0xaecc49914078536dULL,  -874}, // 1e-244
+    {0x823c12795db6ce57ULL,  -847}, // 1e-236
+    {0xc21094364dfb5637ULL,  -821}, // 1e-228
+    {0x9096ea6f3848984fULL,  -794}, // 1e-220
+    {0xd77485cb25823ac7ULL,  -768}, // 1e-212
+    {0xa086cfcd97bf97f4ULL,  -741}, // 1e-204
+    {0xef340a98172aace5ULL,  -715}, // 1e-196
+    {0xb23867fb2a35b28eULL,  -688}, // 1e-188
+    {0x84c8d4dfd2c63f3bULL,  -661}, // 1e-180
+    {0xc5dd44271ad3cdbaULL,  -635}, // 1e-172
+    {0x936b9fcebb25c996ULL,  -608}, // 1e-164
+    {0xdbac6c247d62a584ULL,  -582}, // 1e-156
+    {0xa3ab66580d5fdaf6ULL,  -555}, // 1e-148
+    {0xf3e2f893dec3f126ULL,  -529}, // 1e-140
+    {0xb5b5ada8aaff80b8ULL,  -502}, // 1e-132
+    {0x87625f056c7c4a8bULL,  -475}, // 1e-124
+    {0xc9bcff6034c13053ULL,  -449}, // 1e-116
+    {0x964e858c91ba2655ULL,  -422}, // 1e-108
+    {0xdff9772470297ebdULL,  -396}, // 1e-100
+    {0xa6dfbd9fb8e5b88fULL,  -369}, // 1e-92
+    {0xf8a95fcf88747d94ULL,  -343}, // 1e-84
+    {0xb94470938fa89bcfULL,  -316}, // 1e-76
+    {0x8a08f0f8bf0f156bULL,  -289}, // 1e-68
+    {0xcdb02555653131b6ULL,  -263}, // 1e-60
+    {0x993fe2c6d07b7facULL,  -236}, // 1e-52
+    {0xe45c10c42a2b3b06ULL,  -210}, // 1e-44
+    {0xaa242499697392d3ULL,  -183}, // 1e-36
+    {0xfd87b5f28300ca0eULL,  -157}, // 1e-28
+    {0xbce5086492111aebULL,  -130}, // 1e-20
+    {0x8cbccc096f5088ccULL,  -103}, // 1e-12
+    {0xd1b71758e219652cULL,   -77}, // 1e-4
+    {0x9c40000000000000ULL,   -50}, // 1e4
+    {0xe8d4a51000000000ULL,   -24}, // 1e12
+    {0xad78ebc5ac620000ULL,     3}, // 1e20
+    {0x813f3978f8940984ULL,    30}, // 1e28
+    {0xc097ce7bc90715b3ULL,    56}, // 1e36
+    {0x8f7e32ce7bea5c70ULL,    83}, // 1e44
+    {0xd5d238a4abe98068ULL,   109}, // 1e52
+    {0x9f4f2726179a2245ULL,   136}, // 1e60
+    {0xed63a231d4c4fb27ULL,   162}, // 1e68
+    {0xb0de65388cc8ada8ULL,   189}, // 1e76
+    {0x83c7088e1aab65dbULL,   216}, // 1e84
+    {0xc45d1df942711d9aULL,   242}, // 1e92
+    {0x924d692ca61be758ULL,   269}, // 1e100
+    {0xda01ee641a708deaULL,   295}, // 1e108
+    {0xa26da3999aef774aULL,   322}, // 1e116
+    {0xf209787bb47d6b85ULL,   348}, // 1e124
+    {0xb454e4a179dd1877ULL,   375}, // 1e132
+    {0x865b86925b9bc5c2ULL,   402}, // 1e140
+    {0xc83553c5c8965d3dULL,   428}, // 1e148
+    {0x952ab45cfa97a0b3ULL,   455}, // 1e156
+    {0xde469fbd99a05fe3ULL,   481}, // 1e164
+    {0xa59bc234db398c25ULL,   508}, // 1e172
+    {0xf6c69a72a3989f5cULL,   534}, // 1e180
+    {0xb7dcbf5354e9beceULL,   561}, // 1e188
+    {0x88fcf317f22241e2ULL,   588}, // 1e196
+    {0xcc20ce9bd35c78a5ULL,   614}, // 1e204
+    {0x98165af37b2153dfULL,   641}, // 1e212
+    {0xe2a0b5dc971f303aULL,   667}, // 1e220
+    {0xa8d9d1535ce3b396ULL,   694}, // 1e228
+    {0xfb9b7cd9a4a7443cULL,   720}, // 1e236
+    {0xbb764c4ca7a44410ULL,   747}, // 1e244
+    {0x8bab8eefb6409c1aULL,   774}, // 1e252
+    {0xd01fef10a657842cULL,   800}, // 1e260
+    {0x9b10a4e5e9913129ULL,   827}, // 1e268
+    {0xe7109bfba19c0c9dULL,   853}, // 1e276
+    {0xac2820d9623bf429ULL,   880}, // 1e284
+    {0x80444b5e7aa7cf85ULL,   907}, // 1e292
+    {0xbf21e44003acdd2dULL,   933}, // 1e300
+    {0x8e679c2f5e44ff8fULL,   960}, // 1e308
+    {0xd433179d9c8cb841ULL,   986}, // 1e316
+    {0x9e19db92b4e31ba9ULL,  1013}, // 1e324
+    {0xeb96bf6ebadf77d9ULL,  1039}, // 1e332
+    {0xaf87023b9bf0ee6bULL,  1066}, // 1e340
+};
+
+static const uint64_t g_ufr_buffer_pow10_int[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* Produto arredondado dos 64 bits mais significativos. */
+static ufr_buffer_fp_t ufr_buffer_fp_mul(ufr_buffer_fp_t x, ufr_buffer_fp_t y) {
+    const uint64_t m32 = 0xFFFFFFFFULL;
+    const uint64_t a = x.f >> 32, b = x.f & m32;
+    const uint64_t c = y.f >> 32, d = y.f & m32;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+    tmp += 1ULL << 31;
+    ufr_buffer_fp_t res = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return res;
+}
+
+static ufr_buffer_fp_t ufr_buffer_fp_normalize(ufr_buffer_fp_t x) {
+    const int shift = __builtin_clzll(x.f);
+    x.f <<= shift;
+    x.e -= shift;
+    return x;
+}
+
+/* Corrige o ultimo digito para o mais proximo do valor dentro do intervalo. */
+static void ufr_buffer_grisu_round(char* digits, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while ( rest < wp_w && delta - rest >= ten_kappa
+            && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w) ) {
+        digits[len - 1] -= 1;
+        rest += ten_kappa;
+    }
+}
+
+/* Gera os digitos de w ate que o restante caiba no intervalo delta. */
+static int ufr_buffer_grisu_digits(ufr_buffer_fp_t w, ufr_buffer_fp_t mp, uint64_t delta, char* digits, int* k) {
+    const int shift = -mp.e;
+    const uint64_t one = 1ULL << shift;
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t) (mp.f >> shift);
+    uint64_t p2 = mp.f & (one - 1);
+    int len = 0;
+
+    // parte inteira
+    int kappa = 10;
+    while ( kappa > 0 && p1 < g_ufr_buffer_pow10_int[kappa - 1] ) {
+        kappa -= 1;
+    }
+    while ( kappa > 0 ) {
+        const uint32_t div = (uint32_t) g_ufr_buffer_pow10_int[kappa - 1];
+        const uint32_t d = p1 / div;
+        p1 %= div;
+        if ( d != 0 || len != 0 ) {
+            digits[len++] = (char) ('0' + d);
+        }
+        kappa -= 1;
+        const uint64_t rest = ((uint64_t) p1 << shift) + p2;
+        if ( rest <= delta ) {
+            *k += kappa;
+            ufr_buffer_grisu_round(digits, len, delta, rest, g_ufr_buffer_pow10_int[kappa] << shift, wp_w);
+            return len;
+        }
+    }
+
+    // parte fracionaria
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        const char d = (char) (p2 >> shift);
+        if ( d != 0 || len != 0 ) {
+            digits[len++] = (char) ('0' + d);
+        }
+        p2 &= one - 1;
+        kappa -= 1;
+        if ( p2 < delta ) {
+            *k += kappa;
+            const int index = -kappa;
+            ufr_buffer_grisu_round(digits, len, delta, p2, one, index < 20 ? wp_w * g_ufr_buffer_pow10_int[index] : 0);
+            return len;
+        }
+    }
+}
+
+/* Digitos de f * 2^e, tal que valor = digits * 10^k. O intervalo de
+ * arredondamento vai ate a metade da distancia aos vizinhos, que depende
+ * de lower_closer (mantissa zerada, vizinho de baixo mais proximo). */
+static int ufr_buffer_grisu2(uint64_t f, int e, int lower_closer, char* digits, int* k) {
+    ufr_buffer_fp_t v = {f, e};
+
+    // vizinhos m+ e m-
+    ufr_buffer_fp_t mp = {(f << 1) + 1, e - 1};
+    mp = ufr_buffer_fp_normalize(mp);
+    ufr_buffer_fp_t mm;
+    if ( lower_closer ) {
+        mm.f = (f << 2) - 1;
+        mm.e = e - 2;
+    } else {
+        mm.f = (f << 1) - 1;
+        mm.e = e - 1;
+    }
+    mm.f <<= mm.e - mp.e;
+    mm.e = mp.e;
+
+    // potencia de 10 que leva o expoente para [-60, -32]
+    const double dk = (-61 - mp.e) * 0.30102999566398114 + 347;
+    int ik = (int) dk;
+    if ( dk - ik > 0.0 ) {
+        ik += 1;
+    }
+    const unsigned index = (unsigned) ((ik >> 3) + 1);
+    *k = -(-348 + (int) index * 8);
+    const ufr_buffer_fp_t c = {g_ufr_buffer_pow10[index].f, g_ufr_buffer_pow10[index].e};
+
+    const ufr_buffer_fp_t w = ufr_buffer_fp_mul(ufr_buffer_fp_normalize(v), c);
+    ufr_buffer_fp_t wp = ufr_buffer_fp_mul(mp, c);
+    ufr_buffer_fp_t wm = ufr_buffer_fp_mul(mm, c);
+    wm.f += 1;
+    wp.f -= 1;
+    return ufr_buffer_grisu_digits(w, wp, wp.f - wm.f, digits, k);
+}
+
+/* Escreve digits * 10^k em notacao decimal ou cientifica, a que for usada
+ * pelo numero: 34, 0.5, -12.012346, 1e+30, 1.5e-07. Sao no maximo
+ * 17 digitos, sinal, ponto e expoente, ou seja, menos de 27 caracteres. */
+static size_t ufr_buffer_format_digits(char* dst, const char* digits, int len, int k, int max_digits) {
+    const int point = len + k;  // posicao do ponto decimal
+    char* p = dst;
+
+    if ( point > 0 && point <= max_digits ) {
+        if ( k >= 0 ) {
+            // inteiro: 1234000
+            memcpy(p, digits, len);
+            p += len;
+            memset(p, '0', k);
+            p += k;
+        } else {
+            // 12.34
+            memcpy(p, digits, point);
+            p += point;
+            *p++ = '.';
+            memcpy(p, &digits[point], len - point);
+            p += len - point;
+        }
+    } else if ( point <= 0 && point > -5 ) {
+        // 0.001234
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        p += -point;
+        memcpy(p, digits, len);
+        p += len;
+    } else {
+        // 1.234e-07, 1e+30
+        *p++ = digits[0];
+        if ( len > 1 ) {
+            *p++ = '.';
+            memcpy(p, &digits[1], len - 1);
+            p += len - 1;
+        }
+        int exp10 = point - 1;
+        *p++ = 'e';
+        if ( exp10 < 0 ) {
+            *p++ = '-';
+            exp10 = -exp10;
+        } else {
+            *p++ = '+';
+        }
+        if ( exp10 >= 100 ) {
+            *p++ = (char) ('0' + exp10 / 100);
+            exp10 %= 100;
+        }
+        *p++ = g_ufr_buffer_digits[exp10 * 2];
+        *p++ = g_ufr_buffer_digits[exp10 * 2 + 1];
+    }
+    return (size_t) (p - dst);
+}
+
+/* Escreve nan, inf e zero; retorna 0 para os demais valores. */
+static size_t ufr_buffer_format_special(char* dst, int negative, int is_nan, int is_inf, int is_zero) {
+    char* p = dst;
+    if ( is_nan ) {
+        memcpy(p, "nan", 3);
+        return 3;
+    }
+    if ( !is_inf && !is_zero ) {
+        return 0;
+    }
+    if ( negative ) {
+        *p++ = '-';
+    }
+    if ( is_inf ) {
+        memcpy(p, "inf", 3);
+        p += 3;
+    } else {
+        *p++ = '0';
+    }
+    return (size_t) (p - dst);
+}
+
+/* Texto curto de val que o strtof le de volta como val. */
+static size_t ufr_buffer_format_f32(char* dst, float val) {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const int negative = (bits >> 31) != 0;
+    const uint32_t exp = (bits >> 23) & 0xFF;
+    const uint32_t mant = bits & 0x7FFFFF;
+    const size_t special = ufr_buffer_format_special(dst, negative, exp == 0xFF && mant != 0,
+                                                     exp == 0xFF && mant == 0, exp == 0 && mant == 0);
+    if ( special > 0 ) {
+        return special;
+    }
+
+    char digits[32];
+    int k;
+    int len;
+    if ( exp != 0 ) {
+        len = ufr_buffer_grisu2(mant | 0x800000, (int) exp - 150, mant == 0 && exp > 1, digits, &k);
+    } else {
+        len = ufr_buffer_grisu2(mant, -149, 0, digits, &k);
+    }
+    size_t size = 0;
+    if ( negative ) {
+        dst[size++] = '-';
+    }
+    return size + ufr_buffer_format_digits(&dst[size], digits, len, k, 9);
+}
+
+/* Texto curto de val que o strtod le de volta como val. */
+static size_t ufr_buffer_format_f64(char* dst, double val) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const int negative = (bits >> 63) != 0;
+    const uint64_t exp = (bits >> 52) & 0x7FF;
+    const uint64_t mant = bits & 0xFFFFFFFFFFFFFULL;
+    const size_t special = ufr_buffer_format_special(dst, negative, exp == 0x7FF && mant != 0,
+                                                     exp == 0x7FF && mant == 0, exp == 0 && mant == 0);
+    if ( special > 0 ) {
+        return special;
+    }
+
+    const uint64_t hidden = 0x10000000000000ULL;
+    char digits[32];
+    int k;
+    int len;
+    if ( exp != 0 ) {
+        len = ufr_buffer_grisu2(mant | hidden, (int) exp - 1075, mant == 0 && exp > 1, digits, &k);
+    } else {
+        len = ufr_buffer_grisu2(mant, -1074, 0, digits, &k);
+    }
+    size_t size = 0;
+    if ( negative ) {
+        dst[size++] = '-';
+    }
+    return size + ufr_buffer_format_digits(&dst[size], digits, len, k, 17);
+}
+
+// ============================================================================
+//  Modo binario
+// ============================================================================
+
+/* Posicao de cursor com o preenchimento de alinhamento do modo. */
+static size_t ufr_buffer_align(size_t cursor, size_t size, uint8_t mode) {
+    if ( mode & UFR_BUFFER_ALIGNED ) {
+        return (cursor + size - 1) & ~(size - 1);
+    }
+    return cursor;
+}
+
+/* Adiciona size bytes ja em little-endian, alinhados se o modo pedir. */
+static void ufr_buffer_put_raw(ufr_buffer_t* buffer, const void* data, size_t size) {
+    const size_t ini = ufr_buffer_align(buffer->size, size, buffer->mode);
+    ufr_buffer_check_size(buffer, ini - buffer->size + size);
+    if ( ini + size > buffer->max ) {
+        return;
+    }
+    memset(&buffer->ptr[buffer->size], 0, ini - buffer->size);
+    memcpy(&buffer->ptr[ini], data, size);
+    buffer->size = ini + size;
+}
+
+/* Adiciona um vetor de valores de elem_size bytes de uma vez. */
+static void ufr_buffer_put_raw_array(ufr_buffer_t* buffer, const void* vals, size_t elem_size, size_t count) {
+    const size_t ini = ufr_buffer_align(buffer->size, elem_size, buffer->mode);
+    const size_t size = elem_size * count;
+    ufr_buffer_check_size(buffer, ini - buffer->size + size);
+    if ( ini + size > buffer->max ) {
+        return;
+    }
+    memset(&buffer->ptr[buffer->size], 0, ini - buffer->size);
+#if UFR_BUFFER_HOST_LE
+    memcpy(&buffer->ptr[ini], vals, size);
+#else
+    const uint32_t* src = (const uint32_t*) vals;
+    for (size_t i=0; i<count; i++) {
+        const uint32_t le = UFR_BUFFER_LE32(src[i]);
+        memcpy(&buffer->ptr[ini + i * 4], &le, 4);
+    }
+#endif
+    buffer->size = ini + size;
+}
+
+// ============================================================================
+//  Alocadores
+// ============================================================================
+
+static void* ufr_buffer_mem_alloc(ufr_buffer_allocator_t* allocator, size_t size) {
+    return allocator ? allocator->alloc(allocator, size) : malloc(size);
+}
+
+static void* ufr_buffer_mem_realloc(ufr_buffer_allocator_t* allocator, void* ptr, size_t old_size, size_t new_size) {
+    return allocator ? allocator->realloc(allocator, ptr, old_size, new_size) : realloc(ptr, new_size);
+}
+
+static void ufr_buffer_mem_free(ufr_buffer_allocator_t* allocator, void* ptr, size_t size) {
+    if ( allocator ) {
+        allocator->free(allocator, ptr, size);
+    } else {
+        free(ptr);
+    }
+}
+
+/*
+ * Pool por thread: blocos de 16 B a 1 MB em classes de potencias de 2, com
+ * uma lista de blocos livres por classe. Blocos maiores vao direto para o
+ * malloc. Cada classe guarda no maximo UFR_BUFFER_POOL_KEEP blocos livres,
+ * o que limita a memoria parada no pool. Um bloco liberado por outra thread
+ * entra no pool dessa thread.
+ */
+
+#define UFR_BUFFER_POOL_MIN_SHIFT 4
+#define UFR_BUFFER_POOL_MAX_SHIFT 20
+#define UFR_BUFFER_POOL_CLASSES (UFR_BUFFER_POOL_MAX_SHIFT - UFR_BUFFER_POOL_MIN_SHIFT + 1)
+#define UFR_BUFFER_POOL_KEEP 64
+
+typedef struct _ufr_buffer_pool_block {
+    struct _ufr_buffer_pool_block* next;
+} ufr_buffer_pool_block_t;
+
+typedef struct {
+    ufr_buffer_pool_block_t* free_list[UFR_BUFFER_POOL_CLASSES];
+    uint32_t count[UFR_BUFFER_POOL_CLASSES];
+} ufr_buffer_pool_t;
+
+static _Thread_local ufr_buffer_pool_t g_ufr_buffer_pool;
+
+/* Classe do bloco para size bytes, ou -1 se for maior que a maior classe. */
+static int ufr_buffer_pool_class(size_t size) {
+    if ( size <= ((size_t) 1 << UFR_BUFFER_POOL_MIN_SHIFT) ) {
+        return 0;
+    }
+    if ( size > ((size_t) 1 << UFR_BUFFER_POOL_MAX_SHIFT) ) {
+        return -1;
+    }
+    const int shift = 64 - __builtin_clzll((unsigned long long) (size - 1));
+    return shift - UFR_BUFFER_POOL_MIN_SHIFT;
+}
+
+static void* ufr_buffer_pool_alloc(ufr_buffer_allocator_t* self, size_t size) {
+    (void) self;
+    const int c = ufr_buffer_pool_class(size);
+    if ( c < 0 ) {
+        return malloc(size);
+    }
+    ufr_buffer_pool_block_t* block = g_ufr_buffer_pool.free_list[c];
+    if ( block ) {
+        g_ufr_buffer_pool.free_list[c] = block->next;
+        g_ufr_buffer_pool.count[c] -= 1;
+        return block;
+    }
+    return malloc((size_t) 1 << (c + UFR_BUFFER_POOL_MIN_SHIFT));
+}
+
+static void ufr_buffer_pool_free(ufr_buffer_allocator_t* self, void* ptr, size_t size) {
+    (void) self;
+    if ( ptr == NULL ) {
+        return;
+    }
+    const int c = ufr_buffer_pool_class(size);
+    if ( c < 0 || g_ufr_buffer_pool.count[c] >= UFR_BUFFER_POOL_KEEP ) {
+        free(ptr);
+        return;
+    }
+    ufr_buffer_pool_block_t* block = (ufr_buffer_pool_block_t*) ptr;
+    block->next = g_ufr_buffer_pool.free_list[c];
+    g_ufr_buffer_pool.free_list[c] = block;
+    g_ufr_buffer_pool.count[c] += 1;
+}
+
+static void* ufr_buffer_pool_realloc(ufr_buffer_allocator_t* self, void* ptr, size_t old_size, size_t new_size) {
+    if ( ptr == NULL ) {
+        return ufr_buffer_pool_alloc(self, new_size);
+    }
+    const int old_class = ufr_buffer_pool_class(old_size);
+    const int new_class = ufr_buffer_pool_class(new_size);
+    if ( old_class >= 0 && old_class == new_class ) {
+        return ptr;
+    }
+    if ( old_class < 0 && new_class < 0 ) {
+        return realloc(ptr, new_size);
+    }
+    void* new_ptr = ufr_buffer_pool_alloc(self, new_size);
+    if ( new_ptr ) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        ufr_buffer_pool_free(self, ptr, old_size);
+    }
+    return new_ptr;
+}
+
+static ufr_buffer_allocator_t g_ufr_buffer_pool_allocator = {
+    ufr_buffer_pool_alloc, ufr_buffer_pool_realloc, ufr_buffer_pool_free
+};
+
+/**
+ * @brief Allocator backed by a per-thread pool of size-classed blocks
+ * 
+ * @return ufr_buffer_allocator_t* allocator for ufr_buffer_init_with_allocator
+ */
+
+/* Retorna o alocador do pool por thread. */
+ufr_buffer_allocator_t* ufr_buffer_pool_allocator() {
+    return &g_ufr_buffer_pool_allocator;
+}
+
+/**
+ * @brief Release the free blocks kept by the pool of the calling thread
+ */
+
+/* Devolve ao malloc os blocos livres do pool da thread atual, por exemplo
+ * antes de a thread terminar. */
+void ufr_buffer_pool_trim() {
+    for (int c=0; c<UFR_BUFFER_POOL_CLASSES; c++) {
+        ufr_buffer_pool_block_t* block = g_ufr_buffer_pool.free_list[c];
+        while ( block ) {
+            ufr_buffer_pool_block_t* next = block->next;
+            free(block);
+            block = next;
+        }
+        g_ufr_buffer_pool.free_list[c] = NULL;
+        g_ufr_buffer_pool.count[c] = 0;
+    }
+}
+
+/*
+ * Arena: blocos alocados em sequencia dentro de chunks. free nao faz nada
+ * e ufr_buffer_arena_reset libera todos os buffers de uma vez, mantendo o
+ * primeiro chunk para o proximo lote. O ultimo bloco pode crescer no lugar.
+ */
+
+struct _ufr_buffer_arena_chunk {
+    ufr_buffer_arena_chunk_t* next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+#define UFR_BUFFER_ARENA_ALIGN 16
+
+static size_t ufr_buffer_arena_round(size_t size) {
+    return (size + UFR_BUFFER_ARENA_ALIGN - 1) & ~((size_t) UFR_BUFFER_ARENA_ALIGN - 1);
+}
+
+static void* ufr_buffer_arena_alloc(ufr_buffer_allocator_t* self, size_t size) {
+    ufr_buffer_arena_t* arena = (ufr_buffer_arena_t*) self;
+    size = ufr_buffer_arena_round(size);
+    ufr_buffer_arena_chunk_t* chunk = arena->chunk;
+    if ( chunk == NULL || chunk->used + size > chunk->size ) {
+        const size_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+        ufr_buffer_arena_chunk_t* new_chunk = malloc(sizeof(ufr_buffer_arena_chunk_t) + chunk_size);
+        if ( new_chunk == NULL ) {
+            return NULL;
+        }
+        new_chunk->next = chunk;
+        new_chunk->size = chunk_size;
+        new_chunk->used = 0;
+        arena->chunk = new_chunk;
+        chunk = new_chunk;
+    }
+    char* ptr = (char*) chunk->data + chunk->used;
+    chunk->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+static void* ufr_buffer_arena_realloc(ufr_buffer_allocator_t* self, void* ptr, size_t old_size, size_t new_size) {
+    ufr_buffer_arena_t* arena = (ufr_buffer_arena_t*) self;
+    if ( ptr == NULL ) {
+        return ufr_buffer_arena_alloc(self, new_size);
+    }
+
+    // o ultimo bloco cresce ou diminui no lugar se couber no chunk
+    ufr_buffer_arena_chunk_t* chunk = arena->chunk;
+    if ( ptr == arena->last ) {
+        const size_t ini = (size_t) ((char*) ptr - (char*) chunk->data);
+        const size_t size = ufr_buffer_arena_round(new_size);
+        if ( ini + size <= chunk->size ) {
+            chunk->used = ini + size;
+            return ptr;
+        }
+    }
+    if ( new_size <= old_size ) {
+        return ptr;
+    }
+    void* new_ptr = ufr_buffer_arena_alloc(self, new_size);
+    if ( new_ptr ) {
+        memcpy(new_ptr, ptr, old_size);
+    }
+    return new_ptr;
+}
+
+static void ufr_buffer_arena_free_block(ufr_buffer_allocator_t* self, void* ptr, size_t size) {
+    (void) self;
+    (void) ptr;
+    (void) size;
+}
+
+/**
+ * @brief Arena Constructor
+ * 
+ * @param arena Arena object, whose base is used as allocator
+ * @param chunk_size size of each chunk of memory
+ */
+
+/* Inicializa a arena; &arena->base e o alocador dos buffers do lote. */
+void ufr_buffer_arena_init(ufr_buffer_arena_t* arena, size_t chunk_size) {
+    if (!arena) {
+        fprintf (stderr, "Arena invalida!(arena_init)\n");
+        return;
+    }
+    arena->base.alloc = ufr_buffer_arena_alloc;
+    arena->base.realloc = ufr_buffer_arena_realloc;
+    arena->base.free = ufr_buffer_arena_free_block;
+    arena->chunk = NULL;
+    arena->chunk_size = chunk_size > 0 ? chunk_size : 64 * 1024;
+    arena->last = NULL;
+}
+
+/**
+ * @brief Release all buffers allocated from the arena at once
+ * 
+ * @param arena Arena object
+ */
+
+/* Libera todos os buffers da arena e mantem o maior chunk para o proximo
+ * lote. Os buffers do lote anterior nao podem mais ser usados. */
+void ufr_buffer_arena_reset(ufr_buffer_arena_t* arena) {
+    if (!arena) {
+        fprintf (stderr, "Arena invalida!(arena_reset)\n");
+        return;
+    }
+    ufr_buffer_arena_chunk_t* keep = NULL;
+    ufr_buffer_arena_chunk_t* chunk = arena->chunk;
+    while ( chunk ) {
+        ufr_buffer_arena_chunk_t* next = chunk->next;
+        if ( keep == NULL || chunk->size > keep->size ) {
+            free(keep);
+            keep = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    if ( keep ) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->chunk = keep;
+    arena->last = NULL;
+}
+
+/**
+ * @brief Arena Destructor
+ * 
+ * @param arena Arena object
+ */
+
+/* Libera toda a memoria da arena. */
+void ufr_buffer_arena_free(ufr_buffer_arena_t* arena) {
+    if (!arena) {
+        fprintf (stderr, "Arena invalida!(arena_free)\n");
+        return;
+    }
+    ufr_buffer_arena_reset(arena);
+    free(arena->chunk);
+    arena->chunk = NULL;
+}
+
 // ============================================================================
 //  Buffer
 // ============================================================================
 
+/* Troca a capacidade do buffer para new_max, movendo os dados entre o
+ * espaco local e o heap quando necessario. Retorna o novo ptr ou NULL. */
+static char* ufr_buffer_resize(ufr_buffer_t* buffer, size_t new_max) {
+    // size + 1 inclui o '\0' do modo texto; no modo binario os dados podem
+    // ocupar toda a capacidade atual, sem espaco para ele
+    size_t used = buffer->size < new_max ? buffer->size + 1 : new_max;
+    if ( used > buffer->max ) {
+        used = buffer->max;
+    }
+    char* new_ptr;
+    if ( buffer->ptr == buffer->local ) {
+        if ( new_max <= UFR_BUFFER_INLINE_SIZE ) {
+            return buffer->ptr;
+        }
+        new_ptr = ufr_buffer_mem_alloc(buffer->allocator, new_max);
+        if ( new_ptr ) {
+            memcpy(new_ptr, buffer->local, used);
+        }
+    } else if ( new_max <= UFR_BUFFER_INLINE_SIZE && buffer->ptr != NULL ) {
+        // voltou a caber no espaco local
+        memcpy(buffer->local, buffer->ptr, used);
+        ufr_buffer_mem_free(buffer->allocator, buffer->ptr, buffer->max);
+        new_ptr = buffer->local;
+        new_max = UFR_BUFFER_INLINE_SIZE;
+    } else {
+        new_ptr = ufr_buffer_mem_realloc(buffer->allocator, buffer->ptr, buffer->max, new_max);
+    }
+    if ( new_ptr ) {
+        buffer->ptr = new_ptr;
+        buffer->max = new_max;
+    }
+    return new_ptr;
+}
+
+/**
+ * @brief Create a new buffer
+ * 
+ * @return ufr_buffer_t* 
+ */
+
+/* Cria um novo buffer */
+ufr_buffer_t* ufr_buffer_new() {
+    ufr_buffer_t* buffer = malloc (sizeof(ufr_buffer_t));
+    
+    /*if (buffer == NULL) {
+        return NULL;
+    }*/
+    ufr_buffer_init(buffer);
+    return buffer;
+}
+
+/**
+ * @brief Create a new buffer, with the struct and the data from the allocator
+ * 
+ * @param allocator allocator of the buffer, NULL for malloc
+ * @return ufr_buffer_t* buffer to be released with ufr_buffer_delete
+ */
+
+/* Cria um novo buffer, com a estrutura e os dados vindos do alocador. */
+ufr_buffer_t* ufr_buffer_new_with_allocator(ufr_buffer_allocator_t* allocator) {
+    ufr_buffer_t* buffer = ufr_buffer_mem_alloc(allocator, sizeof(ufr_buffer_t));
+    if ( buffer == NULL ) {
+        return NULL;
+    }
+    ufr_buffer_init_with_allocator(buffer, allocator);
+    return buffer;
+}
+
+/**
+ * @brief Buffer Destructor for ufr_buffer_new and ufr_buffer_new_with_allocator
+ * 
+ * @param buffer Buffer object
+ */
+
+/* Libera os dados e a propria estrutura do buffer. */
+void ufr_buffer_delete(ufr_buffer_t* buffer) {
+    if (!buffer) {
+        fprintf (stderr,"Falha ao liberar memoria!(delete)\n");
+        return;
+    }
+    ufr_buffer_allocator_t* allocator = buffer->allocator;
+    ufr_buffer_free(buffer);
+    ufr_buffer_mem_free(allocator, buffer, sizeof(ufr_buffer_t));
+}
+
+/**
+ * @brief Buffer Constructor
+ * 
+ * @param buffer Buffer object
+ */
+
+/* Inicializa buffer */
+void ufr_buffer_init(ufr_buffer_t* buffer) {
+    if (!buffer) {
+        fprintf (stderr,"Falha ao liberar memoria!(init)\n");
+        return;
+    }
+    ufr_buffer_init_with_allocator(buffer, NULL);
+}
+
+/**
+ * @brief Buffer Constructor with an allocator
+ * 
+ * @param buffer Buffer object
+ * @param allocator ufr_buffer_pool_allocator(), &arena.base, a user allocator
+ *                  or NULL for malloc
+ */
+
+/* Inicializa o buffer com os dados vindos do alocador. */
+void ufr_buffer_init_with_allocator(ufr_buffer_t* buffer, ufr_buffer_allocator_t* allocator) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(init_with_allocator)\n");
+        return;
+    }
+    buffer->size = 0;
+    buffer->max = UFR_BUFFER_INLINE_SIZE;
+    buffer->allocator = allocator;
+    buffer->ptr = buffer->local;
+    buffer->ptr[0] = '\0';
+    buffer->mode = UFR_BUFFER_TEXT;
+    buffer->growth = NULL;
+}
+
+/**
+ * @brief Buffer Constructor with an initial capacity
+ * 
+ * @param buffer Buffer object
+ * @param capacity initial size of buffer->ptr
+ */
+
+/* Inicializa o buffer ja com a capacidade do maior dado esperado (ex: um
+ * frame de camera), evitando os reallocs do crescimento. */
+void ufr_buffer_init_with_capacity(ufr_buffer_t* buffer, size_t capacity) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(init_with_capacity)\n");
+        return;
+    }
+    ufr_buffer_init(buffer);
+    if ( capacity > buffer->max ) {
+        ufr_buffer_resize(buffer, capacity);
+    }
+}
+
+/**
+ * @brief Select the growth policy used by ufr_buffer_check_size
+ * 
+ * @param buffer Buffer object
+ * @param growth one of ufr_buffer_grow_* or a user function, NULL for 2x
+ */
+
+/* Seleciona a politica de crescimento do buffer. */
+void ufr_buffer_set_growth(ufr_buffer_t* buffer, ufr_buffer_growth_t growth) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(set_growth)\n");
+        return;
+    }
+    buffer->growth = growth;
+}
+
+/**
+ * @brief Release the unused capacity of the buffer
+ * 
+ * @param buffer Buffer object
+ */
+
+/* Reduz a capacidade ao tamanho dos dados mais o '\0' final, para buffers
+ * de longa duracao que cresceram por causa de uma unica mensagem grande. */
+void ufr_buffer_shrink_to_fit(ufr_buffer_t* buffer) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(shrink_to_fit)\n");
+        return;
+    }
+    const size_t new_max = buffer->size + 1;
+    if ( new_max >= buffer->max || buffer->ptr == buffer->local ) {
+        return;
+    }
+    ufr_buffer_resize(buffer, new_max);
+}
+
+/**
+ * @brief Buffer Destructor
+ * 
+ * @param buffer 
+ */
+
+/* Libera a memória alocada para o buffer, se os dados estiverem no heap,
+ * e volta para o espaco local. */
+void ufr_buffer_free(ufr_buffer_t* buffer) {
+    if (!buffer) {
+        fprintf (stderr,"Falha ao liberar memoria!(free)\n");
+        return;
+    }
+    if ( buffer->ptr != buffer->local ) {
+        ufr_buffer_mem_free(buffer->allocator, buffer->ptr, buffer->max);
+    }
+    buffer->ptr = buffer->local;
+    buffer->ptr[0] = '\0';
+    buffer->max = UFR_BUFFER_INLINE_SIZE;
+    buffer->size = 0;
+}
+
+/**
+ * @brief Clear data of the buffer
+ * 
+ * @param buffer Buffer object
+ */
+
+/* Zera o campo size do buffer, indicando que o buffer está vazio
+ * (os dados anteriores são considerados inválidos). */
+void ufr_buffer_clear(ufr_buffer_t* buffer) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(clear)\n");
+        return;
+    }
+    buffer->size = 0;
+}
+
+/**
+ * @brief Growth policies for ufr_buffer_set_growth
+ * 
+ * @param max current capacity
+ * @param need minimum capacity
+ * @return size_t new capacity, at least need
+ */
+
+/* Exatamente o necessario. */
+size_t ufr_buffer_grow_exact(size_t max, size_t need) {
+    (void) max;
+    return need;
+}
+
+/* Multiplica a capacidade por 1.5 ate caber need. */
+size_t ufr_buffer_grow_1_5x(size_t max, size_t need) {
+    size_t cap = max ? max : MESSAGE_ITEM_SIZE;
+    while ( cap < need ) {
+        if ( cap > ((size_t) -1) / 2 ) {
+            return need;
+        }
+        cap += cap / 2 + 1;
+    }
+    return cap;
+}
+
+/* Dobra a capacidade ate caber need, como o laco original de check_size,
+ * mas sem um realloc por passo. */
+size_t ufr_buffer_grow_2x(size_t max, size_t need) {
+    size_t cap = max ? max : MESSAGE_ITEM_SIZE;
+    while ( cap < need ) {
+        if ( cap > ((size_t) -1) / 2 ) {
+            return need;
+        }
+        cap *= 2;
+    }
+    return cap;
+}
+
+/* Arredonda need para paginas de 4 KB. */
+size_t ufr_buffer_grow_page(size_t max, size_t need) {
+    (void) max;
+    const size_t page = 4096;
+    return (need + page - 1) & ~(page - 1);
+}
+
+/* Arredonda need para paginas grandes de 2 MB, que o kernel pode mapear
+ * com uma unica entrada de TLB. */
+size_t ufr_buffer_grow_hugepage(size_t max, size_t need) {
+    (void) max;
+    const size_t page = 2 * 1024 * 1024;
+    return (need + page - 1) & ~(page - 1);
+}
+
+/**
+ * @brief Check if the buffer has space enough with increment of the size
+ * 
+ * @param buffer Buffer object
+ * @param size increment size
+ */
+
+/* Verifica se o buffer tem espaço suficiente para acomodar um incremento
+ * de tamanho (plus_size). */
+void ufr_buffer_check_size(ufr_buffer_t* buffer, size_t plus_size) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(check size)\n");
+        return;
+    }
+    const size_t need = buffer->size + plus_size;
+    if ( need <= buffer->max ) {
+        return;
+    }
+    if ( need < buffer->size ) {
+        fprintf (stderr,"Tamanho invalido!(check size)\n");
+        return;
+    }
+
+    // calcula a capacidade final de uma vez e faz um unico realloc
+    const ufr_buffer_growth_t growth = buffer->growth ? buffer->growth : ufr_buffer_grow_2x;
+    size_t new_max = growth(buffer->max, need);
+    if ( new_max < need ) {
+        new_max = need;
+    }
+    char* new_ptr = ufr_buffer_resize(buffer, new_max);
+
+    // Verifica se a realocação foi bem sucedida.
+    if (!new_ptr) {
+        fprintf (stderr,"Ponteiro invalido!");
+        return;
+    }
+}
+
+/**
+ * @brief Reserve space at the end of the buffer to be written in place
+ * 
+ * @param buffer Buffer object
+ * @param size number of bytes that may be written
+ * @return char* pointer to buffer->ptr[buffer->size], or NULL on failure
+ */
+
+/* Garante espaco para size bytes e retorna onde eles devem ser escritos,
+ * para encoders, read(2) e recv(2) escreverem direto no buffer. O ponteiro
+ * vale ate a proxima chamada que aumente o buffer; ufr_buffer_commit
+ * confirma os bytes escritos. */
+char* ufr_buffer_reserve(ufr_buffer_t* buffer, size_t size) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(reserve)\n");
+        return NULL;
+    }
+    ufr_buffer_check_size(buffer, size);
+    if ( buffer->size + size > buffer->max ) {
+        return NULL;
+    }
+    return &buffer->ptr[buffer->size];
+}
+
+/**
+ * @brief Commit bytes written after ufr_buffer_reserve
+ * 
+ * @param buffer Buffer object
+ * @param size number of bytes written, at most the reserved size
+ */
+
+/* Avanca size pelos bytes escritos no espaco reservado. */
+void ufr_buffer_commit(ufr_buffer_t* buffer, size_t size) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(commit)\n");
+        return;
+    }
+    if ( size > buffer->max - buffer->size ) {
+        fprintf (stderr,"Tamanho maior que o reservado!(commit)\n");
+        size = buffer->max - buffer->size;
+    }
+    buffer->size += size;
+}
+
+/**
+ * @brief Put text in the buffer
+ * 
+ * @param buffer Buffer object
+ * @param text text to be put
+ * @param size size of text
+ */
+
+/* Adiciona um bloco de dados ao buffer.*/
+void ufr_buffer_put(ufr_buffer_t* buffer, const char* text, size_t size) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(put)\n");
+        return;
+    }
+
+    // Verifica se há espaço suficiente no buffer
+    ufr_buffer_check_size(buffer, size+1); 
+
+    // Copia os dados (que podem ter bytes 0) e termina com '\0' como os outros puts
+    char* base = &buffer->ptr[buffer->size];
+    memcpy(base, text, size);
+    base[size] = '\0';
+    buffer->size += size; //atualiza o tamanho atual do buffer
+}
+
+/**
+ * @brief put a char in the buffer
+ * 
+ * @param buffer Buffer object
+ * @param val charachter which to be inserted
+ */
+
+/* Adiciona um único caractere ao buffer. */
+void ufr_buffer_put_chr(ufr_buffer_t* buffer, char val) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(put_chr)\n");
+        return;
+    }
+    ufr_buffer_check_size(buffer, 2);
+    buffer->ptr[buffer->size] = val;
+    buffer->ptr[buffer->size + 1] = '\0';
+    buffer->size += 1;
+}
+
+/**
+ * @brief put an unsigned int of 8bit as string
+ * 
+ * @param buffer Buffer object
+ * @param val unsigned int value to be converted and inserted
+ */
+
+/*Converte um valor uint8_t (inteiro sem sinal de 8 bits) em uma string
+ * e a adiciona ao buffer. */
+void ufr_buffer_put_u8_as_str(ufr_buffer_t* buffer, uint8_t val) {
+    if (!buffer) {
+        fprintf (stderr,"Buffer invalido!(put_u8)\n");
+        return;
+    }  
+    ufr_buffer_put_integer(buffer, val, 0);
+}
+
+/**
+ * @brief put an int of 8bit as string
+ * 
+ * @param buffer Buffer object
+ * @param val int value to be converted and inserted
+ */
+
+/*Similar à função ufr_buffer_put_u8_as_str, mas para valores int8_t
+ * (inteiro com sinal de 8 bits). */
+void ufr_buffer_put_i8_as_str(ufr_buffer_t* buffer, int8_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_i8)\n");
+        return;
+    }
+    if ( val < 0 ) {
+        ufr_buffer_put_integer(buffer, (uint32_t) -(int32_t) val, 1);
+    } else {
+        ufr_buffer_put_integer(buffer, (uint32_t) val, 0);
+    }
+}
+
+/**
+ * @brief put an unsigned int as string
+ * 
+ * @param buffer Buffer object
+ * @param val int value to be converted and inserted
+ */
+
+/*Converte um valor uint32_t (inteiro sem sinal de 32 bits) em uma string
+ * e a adiciona ao buffer. */
+void ufr_buffer_put_u32_as_str(ufr_buffer_t* buffer, uint32_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u32)\n");
+        return;
+    }
+    ufr_buffer_put_integer(buffer, val, 0);
+}
+
+/**
+ * @brief put an int as string
+ * 
+ * @param buffer Buffer object
+ * @param val int value to be converted and inserted
+ */
+
+/* Similar à função ufr_buffer_put_u32_as_str, mas para valores int32_t 
+ * (inteiro com sinal de 32 bits). */
+void ufr_buffer_put_i32_as_str(ufr_buffer_t* buffer, int32_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_i32)\n");
+        return;
+    }
+    if ( val < 0 ) {
+        // 0u - val evita o overflow de -INT32_MIN
+        ufr_buffer_put_integer(buffer, 0u - (uint32_t) val, 1);
+    } else {
+        ufr_buffer_put_integer(buffer, (uint32_t) val, 0);
+    }
+}
+
+/**
+ * @brief put a float as string, with a short text that reads back as val
+ * 
+ * @param buffer Buffer object
+ * @param val float value to be converted and inserted
+ */
+
+/* Converte um valor float em uma string curta que volta ao mesmo valor
+ * (ex: 34, 0.5, -12.012346, 1e+30) e a adiciona ao buffer. */
+void ufr_buffer_put_f32_as_str(ufr_buffer_t* buffer, float val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_f32)\n");
+        return;
+    }
+    ufr_buffer_check_size(buffer, 32);
+    char* base = &buffer->ptr[buffer->size];
+    size_t size = 0;
+    if ( buffer->size > 0 ) {
+        base[size++] = ' ';
+    }
+    size += ufr_buffer_format_f32(&base[size], val);
+    base[size] = '\0';
+    buffer->size += size;
+}
+
+/**
+ * @brief put a double as string, with a short text that reads back as val
+ * 
+ * @param buffer Buffer object
+ * @param val double value to be converted and inserted
+ */
+
+/* Similar à função ufr_buffer_put_f32_as_str, mas para valores double. */
+void ufr_buffer_put_f64_as_str(ufr_buffer_t* buffer, double val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_f64)\n");
+        return;
+    }
+    ufr_buffer_check_size(buffer, 32);
+    char* base = &buffer->ptr[buffer->size];
+    size_t size = 0;
+    if ( buffer->size > 0 ) {
+        base[size++] = ' ';
+    }
+    size += ufr_buffer_format_f64(&base[size], val);
+    base[size] = '\0';
+    buffer->size += size;
+}
+
+/**
+ * @brief put an array of unsigned ints as string, separated by spaces
+ * 
+ * @param buffer Buffer object
+ * @param vals array of values
+ * @param count number of values
+ */
+
+/* Adiciona todos os valores de uma vez: o espaco do pior caso e reservado
+ * uma unica vez e o laco nao testa o separador a cada elemento. */
+void ufr_buffer_put_u32_array(ufr_buffer_t* buffer, const uint32_t* vals, size_t count) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u32_array)\n");
+        return;
+    }
+    if ( count == 0 ) {
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        ufr_buffer_put_raw_array(buffer, vals, 4, count);
+        return;
+    }
+    // espaco + 10 digitos por valor + '\0'
+    const size_t need = count * 11 + 1;
+    ufr_buffer_check_size(buffer, need);
+    if ( buffer->size + need > buffer->max ) {
+        return;
+    }
+    char* base = &buffer->ptr[buffer->size];
+    char* p = base;
+    if ( buffer->size > 0 ) {
+        *p++ = ' ';
+    }
+    p += ufr_buffer_format_u32(p, vals[0]);
+    for (size_t i=1; i<count; i++) {
+        *p++ = ' ';
+        p += ufr_buffer_format_u32(p, vals[i]);
+    }
+    *p = '\0';
+    buffer->size += (size_t) (p - base);
+}
+
+/**
+ * @brief put an array of ints as string, separated by spaces
+ * 
+ * @param buffer Buffer object
+ * @param vals array of values
+ * @param count number of values
+ */
+
+/* Similar à função ufr_buffer_put_u32_array, mas para valores int32_t. */
+void ufr_buffer_put_i32_array(ufr_buffer_t* buffer, const int32_t* vals, size_t count) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_i32_array)\n");
+        return;
+    }
+    if ( count == 0 ) {
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        ufr_buffer_put_raw_array(buffer, vals, 4, count);
+        return;
+    }
+    // espaco + sinal + 10 digitos por valor + '\0'
+    const size_t need = count * 12 + 1;
+    ufr_buffer_check_size(buffer, need);
+    if ( buffer->size + need > buffer->max ) {
+        return;
+    }
+    char* base = &buffer->ptr[buffer->size];
+    char* p = base;
+    if ( buffer->size > 0 ) {
+        *p++ = ' ';
+    }
+    p += ufr_buffer_format_i32(p, vals[0]);
+    for (size_t i=1; i<count; i++) {
+        *p++ = ' ';
+        p += ufr_buffer_format_i32(p, vals[i]);
+    }
+    *p = '\0';
+    buffer->size += (size_t) (p - base);
+}
+
+/**
+ * @brief put an array of floats as string, separated by spaces
+ * 
+ * @param buffer Buffer object
+ * @param vals array of values
+ * @param count number of values
+ */
+
+/* Similar à função ufr_buffer_put_u32_array, com o texto de
+ * ufr_buffer_put_f32_as_str para cada valor. */
+void ufr_buffer_put_f32_array(ufr_buffer_t* buffer, const float* vals, size_t count) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_f32_array)\n");
+        return;
+    }
+    if ( count == 0 ) {
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        ufr_buffer_put_raw_array(buffer, vals, 4, count);
+        return;
+    }
+    // espaco + 26 caracteres por valor + '\0'
+    const size_t need = count * 27 + 1;
+    ufr_buffer_check_size(buffer, need);
+    if ( buffer->size + need > buffer->max ) {
+        return;
+    }
+    char* base = &buffer->ptr[buffer->size];
+    char* p = base;
+    if ( buffer->size > 0 ) {
+        *p++ = ' ';
+    }
+    p += ufr_buffer_format_f32(p, vals[0]);
+    for (size_t i=1; i<count; i++) {
+        *p++ = ' ';
+        p += ufr_buffer_format_f32(p, vals[i]);
+    }
+    *p = '\0';
+    buffer->size += (size_t) (p - base);
+}
+
+/**
+ * @brief put a string
+ * 
+ * @param buffer Buffer object
+ * @param val string to be inserted to the buffer
+ */
+
+/* Adiciona uma string (text) ao buffer, separada por espaco dos dados
+ * anteriores, com uma unica verificacao de tamanho. */
+void ufr_buffer_put_str(ufr_buffer_t* buffer, const char* text) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_str)\n");
+        printf("\n");
+        return;
+    }
+    const size_t size = strlen(text); // Calcula o tamanho da string 
+    const size_t sep = buffer->size > 0 ? 1 : 0;
+    ufr_buffer_check_size(buffer, sep + size + 1); // Verifica se há espaço suficiente no buffer
+    char* base = &buffer->ptr[buffer->size];
+    if ( sep ) {
+        *base++ = ' ';
+    }
+    memcpy(base, text, size); // Adiciona a string 
+    base[size] = '\0';
+    buffer->size += sep + size;
+}
+
+/**
+ * @brief put many strings at once, as ufr_buffer_put_str for each one
+ * 
+ * @param buffer Buffer object
+ * @param texts array of strings
+ * @param count number of strings
+ */
+
+/* Adiciona varias strings separadas por espaco. Os tamanhos sao medidos em
+ * blocos de ate 64 strings, com uma verificacao de tamanho por bloco. */
+void ufr_buffer_put_strv(ufr_buffer_t* buffer, const char* const* texts, size_t count) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_strv)\n");
+        return;
+    }
+    size_t lens[64];
+    for (size_t ini=0; ini<count; ini+=64) {
+        const size_t n = count - ini < 64 ? count - ini : 64;
+
+        // mede o bloco: cada string mais o separador
+        size_t total = 0;
+        for (size_t i=0; i<n; i++) {
+            lens[i] = strlen(texts[ini+i]);
+            total += lens[i] + 1;
+        }
+        ufr_buffer_check_size(buffer, total + 1);
+        if ( buffer->size + total + 1 > buffer->max ) {
+            return;
+        }
+
+        // copia; o primeiro separador so se o buffer ja tiver dados
+        char* base = &buffer->ptr[buffer->size];
+        char* p = base;
+        for (size_t i=0; i<n; i++) {
+            if ( p != base || buffer->size > 0 ) {
+                *p++ = ' ';
+            }
+            memcpy(p, texts[ini+i], lens[i]);
+            p += lens[i];
+        }
+        *p = '\0';
+        buffer->size += (size_t) (p - base);
+    }
+}
+
+/**
+ * @brief put a list of strings terminated by NULL
+ * 
+ * @param buffer Buffer object
+ * @param text first string, followed by the others and NULL
+ */
+
+/* Adiciona a lista de strings terminada por NULL.
+ * ex: ufr_buffer_put_str_list(buffer, "topic", "/camera", "rgb8", NULL) */
+void ufr_buffer_put_str_list(ufr_buffer_t* buffer, const char* text, ...) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_str_list)\n");
+        return;
+    }
+    const char* texts[64];
+    size_t count = 0;
+    va_list list;
+    va_start(list, text);
+    while ( text != NULL ) {
+        texts[count++] = text;
+        if ( count == 64 ) {
+            ufr_buffer_put_strv(buffer, texts, count);
+            count = 0;
+        }
+        text = va_arg(list, const char*);
+    }
+    va_end(list);
+    ufr_buffer_put_strv(buffer, texts, count);
+}
+
+
+// ============================================================================
+//  Buffer - Formato
+// ============================================================================
+
+/*
+ * ufr_buffer_putf usa os mesmos tipos do ufr_args: "%d" (int), "%f"
+ * (float, escrito como ufr_buffer_put_f32_as_str), "%s" (const char*),
+ * "%p" (ponteiro em hexadecimal) e "%%". Cada formato e compilado uma vez
+ * em uma lista de operacoes, guardada em uma cache por thread indexada
+ * pelo ponteiro do formato; por isso o formato deve ser constante, como
+ * uma string literal. O espaco de todo o texto e reservado antes da
+ * escrita, com o pior caso de cada numero e o tamanho de cada string.
+ */
+
+#define UFR_BUFFER_PUTF_OPS   32
+#define UFR_BUFFER_PUTF_CACHE 16
+
+typedef struct {
+    char type;              // 'd', 'f', 's', 'p' ou '\0' para texto
+    uint16_t len;
+    const char* text;
+} ufr_buffer_putf_op_t;
+
+typedef struct {
+    const char* format;
+    size_t fixed;           // texto mais o pior caso dos numeros
+    uint8_t count;
+    ufr_buffer_putf_op_t ops[UFR_BUFFER_PUTF_OPS];
+} ufr_buffer_putf_t;
+
+static _Thread_local ufr_buffer_putf_t g_ufr_buffer_putf_cache[UFR_BUFFER_PUTF_CACHE];
+
+/* Compila o formato; retorna -1 se tiver mais de UFR_BUFFER_PUTF_OPS
+ * operacoes. */
+static int ufr_buffer_putf_compile(ufr_buffer_putf_t* compiled, const char* format) {
+    compiled->format = NULL;
+    compiled->fixed = 0;
+    compiled->count = 0;
+    const char* p = format;
+    while ( *p != '\0' ) {
+        if ( compiled->count == UFR_BUFFER_PUTF_OPS ) {
+            return -1;
+        }
+        ufr_buffer_putf_op_t* op = &compiled->ops[compiled->count++];
+        if ( p[0] == '%' && (p[1] == 'd' || p[1] == 'f' || p[1] == 's' || p[1] == 'p') ) {
+            op->type = p[1];
+            op->len = 0;
+            op->text = NULL;
+            compiled->fixed += (op->type == 'd') ? 11 : (op->type == 'f') ? 31 : (op->type == 'p') ? 18 : 0;
+            p += 2;
+            continue;
+        }
+
+        // texto ate o proximo '%'; "%%" vira um '%'
+        op->type = '\0';
+        op->text = p;
+        if ( p[0] == '%' && p[1] == '%' ) {
+            op->len = 1;
+            p += 2;
+        } else {
+            const char* end = p + 1;
+            while ( *end != '\0' && *end != '%' && end - p < 0xFFFF ) {
+                end += 1;
+            }
+            op->len = (uint16_t) (end - p);
+            p = end;
+        }
+        compiled->fixed += op->len;
+    }
+    compiled->format = format;
+    return UFR_OK;
+}
+
+static size_t ufr_buffer_format_ptr(char* dst, const void* ptr) {
+    uintptr_t val = (uintptr_t) ptr;
+    char tmp[2 * sizeof(uintptr_t)];
+    size_t len = 0;
+    do {
+        tmp[len++] = "0123456789abcdef"[val & 0xF];
+        val >>= 4;
+    } while ( val != 0 );
+    dst[0] = '0';
+    dst[1] = 'x';
+    for (size_t i=0; i<len; i++) {
+        dst[2+i] = tmp[len-1-i];
+    }
+    return 2 + len;
+}
+
+/**
+ * @brief put text and values with a format in the ufr_args vocabulary
+ * 
+ * @param buffer Buffer object
+ * @param format constant format with "%d", "%f", "%s", "%p" and "%%"
+ * @param list values of the format
+ */
+
+/* Versao com va_list de ufr_buffer_putf. */
+void ufr_buffer_vputf(ufr_buffer_t* buffer, const char* format, va_list list) {
+    if (!buffer || !format) {
+        fprintf (stderr, "Buffer invalido!(putf)\n");
+        return;
+    }
+
+    // formato compilado, da cache ou compilado agora
+    ufr_buffer_putf_t* compiled = &g_ufr_buffer_putf_cache[((uintptr_t) format >> 3) % UFR_BUFFER_PUTF_CACHE];
+    if ( compiled->format != format ) {
+        if ( ufr_buffer_putf_compile(compiled, format) != UFR_OK ) {
+            fprintf (stderr, "Formato muito longo!(putf)\n");
+            return;
+        }
+    }
+
+    // le os valores, mede as strings e reserva todo o texto de uma vez
+    union {
+        int32_t d;
+        float f;
+        const void* p;
+        const char* s;
+    } vals[UFR_BUFFER_PUTF_OPS];
+    size_t lens[UFR_BUFFER_PUTF_OPS];
+    size_t need = compiled->fixed;
+    for (uint8_t i=0; i<compiled->count; i++) {
+        switch ( compiled->ops[i].type ) {
+            case 'd': vals[i].d = (int32_t) va_arg(list, int); break;
+            case 'f': vals[i].f = (float) va_arg(list, double); break;
+            case 'p': vals[i].p = va_arg(list, void*); break;
+            case 's':
+                vals[i].s = va_arg(list, const char*);
+                lens[i] = vals[i].s ? strlen(vals[i].s) : 0;
+                need += lens[i];
+                break;
+            default: break;
+        }
+    }
+    ufr_buffer_check_size(buffer, need + 1);
+    if ( buffer->size + need + 1 > buffer->max ) {
+        return;
+    }
+
+    char* base = &buffer->ptr[buffer->size];
+    char* p = base;
+    for (uint8_t i=0; i<compiled->count; i++) {
+        const ufr_buffer_putf_op_t* op = &compiled->ops[i];
+        switch ( op->type ) {
+            case 'd': p += ufr_buffer_format_i32(p, vals[i].d); break;
+            case 'f': p += ufr_buffer_format_f32(p, vals[i].f); break;
+            case 'p': p += ufr_buffer_format_ptr(p, vals[i].p); break;
+            case 's':
+                if ( lens[i] > 0 ) {
+                    memcpy(p, vals[i].s, lens[i]);
+                    p += lens[i];
+                }
+                break;
+            default:
+                // separadores de um caractere sem chamar memcpy
+                if ( op->len == 1 ) {
+                    *p++ = op->text[0];
+                } else {
+                    memcpy(p, op->text, op->len);
+                    p += op->len;
+                }
+                break;
+        }
+    }
+    *p = '\0';
+    buffer->size += (size_t) (p - base);
+}
+
+/**
+ * @brief put text and values with a format in the ufr_args vocabulary
+ * 
+ * @param buffer Buffer object
+ * @param format constant format with "%d", "%f", "%s", "%p" and "%%"
+ */
+
+/* Escreve a mensagem inteira em uma chamada, sem separadores automaticos:
+ * os espacos vem do formato.
+ * ex: ufr_buffer_putf(buffer, "%s %d %f", "pose", 10, 0.5) -> "pose 10 0.5" */
+void ufr_buffer_putf(ufr_buffer_t* buffer, const char* format, ...) {
+    va_list list;
+    va_start(list, format);
+    ufr_buffer_vputf(buffer, format, list);
+    va_end(list);
+}
+
+
+// ============================================================================
+//  Buffer - Modo de codificacao
+// ============================================================================
+
+/**
+ * @brief Select how the put functions without suffix encode numbers
+ * 
+ * @param buffer Buffer object
+ * @param mode UFR_BUFFER_TEXT, UFR_BUFFER_BINARY or
+ *             UFR_BUFFER_BINARY | UFR_BUFFER_ALIGNED
+ */
+
+/* Seleciona a codificacao dos puts sem sufixo: texto ou binario. */
+void ufr_buffer_set_mode(ufr_buffer_t* buffer, uint8_t mode) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(set_mode)\n");
+        return;
+    }
+    buffer->mode = mode;
+}
+
+/**
+ * @brief put an unsigned int of 64bit as string
+ * 
+ * @param buffer Buffer object
+ * @param val unsigned int value to be converted and inserted
+ */
+
+/* Similar à função ufr_buffer_put_u32_as_str, mas para valores uint64_t. */
+void ufr_buffer_put_u64_as_str(ufr_buffer_t* buffer, uint64_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u64)\n");
+        return;
+    }
+    // espaco + 20 digitos + '\0'
+    ufr_buffer_check_size(buffer, 22);
+    char* base = &buffer->ptr[buffer->size];
+    size_t size = 0;
+    if ( buffer->size > 0 ) {
+        base[size++] = ' ';
+    }
+    size += ufr_buffer_format_u64(&base[size], val);
+    base[size] = '\0';
+    buffer->size += size;
+}
+
+/**
+ * @brief put an unsigned int of 8bit, as text or binary according to the mode
+ * 
+ * @param buffer Buffer object
+ * @param val value to be inserted
+ */
+
+/* Adiciona o valor como texto ou como bytes, conforme buffer->mode.
+ * As funcoes seguintes fazem o mesmo para os outros tipos. */
+void ufr_buffer_put_u8(ufr_buffer_t* buffer, uint8_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u8)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        ufr_buffer_put_raw(buffer, &val, 1);
+    } else {
+        ufr_buffer_put_u8_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_u16(ufr_buffer_t* buffer, uint16_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u16)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        const uint16_t le = UFR_BUFFER_LE16(val);
+        ufr_buffer_put_raw(buffer, &le, 2);
+    } else {
+        ufr_buffer_put_u32_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_u32(ufr_buffer_t* buffer, uint32_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u32)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        const uint32_t le = UFR_BUFFER_LE32(val);
+        ufr_buffer_put_raw(buffer, &le, 4);
+    } else {
+        ufr_buffer_put_u32_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_u64(ufr_buffer_t* buffer, uint64_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_u64)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        const uint64_t le = UFR_BUFFER_LE64(val);
+        ufr_buffer_put_raw(buffer, &le, 8);
+    } else {
+        ufr_buffer_put_u64_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_i32(ufr_buffer_t* buffer, int32_t val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_i32)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        const uint32_t le = UFR_BUFFER_LE32((uint32_t) val);
+        ufr_buffer_put_raw(buffer, &le, 4);
+    } else {
+        ufr_buffer_put_i32_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_f32(ufr_buffer_t* buffer, float val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_f32)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        uint32_t bits;
+        memcpy(&bits, &val, 4);
+        bits = UFR_BUFFER_LE32(bits);
+        ufr_buffer_put_raw(buffer, &bits, 4);
+    } else {
+        ufr_buffer_put_f32_as_str(buffer, val);
+    }
+}
+
+void ufr_buffer_put_f64(ufr_buffer_t* buffer, double val) {
+    if (!buffer) {
+        fprintf (stderr, "Buffer invalido!(put_f64)\n");
+        return;
+    }
+    if ( buffer->mode & UFR_BUFFER_BINARY ) {
+        uint64_t bits;
+        memcpy(&bits, &val, 8);
+        bits = UFR_BUFFER_LE64(bits);
+        ufr_buffer_put_raw(buffer, &bits, 8);
+    } else {
+        ufr_buffer_put_f64_as_str(buffer, val);
+    }
+}
+
+// ============================================================================
+//  Leitor
+// ============================================================================
+
+/**
+ * @brief Reader Constructor. The reader does not copy the data.
+ * 
+ * @param reader Reader object
+ * @param data data written by a ufr_buffer_t (ex: buffer->ptr)
+ * @param size size of data
+ * @param mode mode used by the writer (ex: buffer->mode)
+ */
+
+/* Inicializa um leitor sobre os dados, que devem existir enquanto
+ * o leitor for usado. */
+void ufr_buffer_reader_init(ufr_buffer_reader_t* reader, const char* data, size_t size, uint8_t mode) {
+    if (!reader) {
+        fprintf (stderr, "Leitor invalido!(reader_init)\n");
+        return;
+    }
+    reader->ptr = data;
+    reader->size = size;
+    reader->cursor = 0;
+    reader->mode = mode;
+}
+
+/* Copia os proximos size bytes (little-endian) para out. */
+static int ufr_buffer_get_raw(ufr_buffer_reader_t* reader, void* out, size_t size) {
+    const size_t ini = ufr_buffer_align(reader->cursor, size, reader->mode);
+    if ( ini + size > reader->size ) {
+        return UFR_BUFFER_END;
+    }
+    memcpy(out, &reader->ptr[ini], size);
+    reader->cursor = ini + size;
+    return UFR_OK;
+}
+
+/* Fim de um token de texto: espaco, '\n', '\0' ou fim dos dados. */
+static int ufr_buffer_is_sep(const ufr_buffer_reader_t* reader, size_t i) {
+    return i >= reader->size || reader->ptr[i] == ' ' || reader->ptr[i] == '\n' || reader->ptr[i] == '\0';
+}
+
+/* Posicao do fim do token que contem i. */
+static size_t ufr_buffer_token_end(const ufr_buffer_reader_t* reader, size_t i) {
+    while ( !ufr_buffer_is_sep(reader, i) ) {
+        i += 1;
+    }
+    return i;
+}
+
+/* Pula os separadores ate o proximo token. */
+static int ufr_buffer_skip_space(ufr_buffer_reader_t* reader) {
+    size_t i = reader->cursor;
+    while ( i < reader->size && (reader->ptr[i] == ' ' || reader->ptr[i] == '\n') ) {
+        i += 1;
+    }
+    reader->cursor = i;
+    if ( i >= reader->size || reader->ptr[i] == '\0' ) {
+        return UFR_BUFFER_END;
+    }
+    return UFR_OK;
+}
+
+/* Le um inteiro de texto direto dos dados, sem copia e sem locale. O modulo
+ * vai para out e deve ser no maximo max, ou max_neg se negativo. Um token
+ * invalido e pulado inteiro. */
+static int ufr_buffer_parse_int(ufr_buffer_reader_t* reader, uint64_t max_neg, uint64_t max, int* negative, uint64_t* out) {
+    const int res = ufr_buffer_skip_space(reader);
+    if ( res != UFR_OK ) {
+        return res;
+    }
+    const char* p = reader->ptr;
+    size_t i = reader->cursor;
+    int neg = 0;
+    if ( p[i] == '-' ) {
+        neg = 1;
+        i += 1;
+    } else if ( p[i] == '+' ) {
+        i += 1;
+    }
+
+    const size_t first = i;
+    const uint64_t limit = neg ? max_neg : max;
+    uint64_t val = 0;
+    int overflow = 0;
+    while ( i < reader->size && (unsigned char) (p[i] - '0') < 10 ) {
+        const uint64_t d = (uint64_t) (p[i] - '0');
+        if ( d > limit || val > (limit - d) / 10 ) {
+            overflow = 1;
+        }
+        val = val * 10 + d;
+        i += 1;
+    }
+    if ( i == first || overflow || !ufr_buffer_is_sep(reader, i) ) {
+        reader->cursor = ufr_buffer_token_end(reader, i);
+        return UFR_BUFFER_INVALID;
+    }
+    reader->cursor = i;
+    *negative = neg;
+    *out = val;
+    return UFR_OK;
+}
+
+// potencias de 10 exatas em double
+static const double g_ufr_buffer_exact_pow10[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Le um numero decimal como mantissa * 10^exp10. exact fica 0 se algum
+ * digito nao coube na mantissa ou se o token nao tem digitos (inf, nan),
+ * casos em que o token [ini, end) deve ir para o caminho lento. */
+static int ufr_buffer_parse_decimal(ufr_buffer_reader_t* reader, uint64_t* mant, int* exp10, int* negative,
+                                    int* exact, size_t* ini, size_t* end) {
+    const int res = ufr_buffer_skip_space(reader);
+    if ( res != UFR_OK ) {
+        return res;
+    }
+    const char* p = reader->ptr;
+    size_t i = reader->cursor;
+    *ini = i;
+    *negative = 0;
+    if ( p[i] == '-' ) {
+        *negative = 1;
+        i += 1;
+    } else if ( p[i] == '+' ) {
+        i += 1;
+    }
+
+    uint64_t m = 0;
+    int e = 0;
+    int digits = 0;
+    *exact = 1;
+    while ( i < reader->size && (unsigned char) (p[i] - '0') < 10 ) {
+        if ( m < 100000000000000000ULL ) {
+            m = m * 10 + (uint64_t) (p[i] - '0');
+        } else {
+            e += 1;
+            if ( p[i] != '0' ) {
+                *exact = 0;
+            }
+        }
+        digits += 1;
+        i += 1;
+    }
+    if ( i < reader->size && p[i] == '.' ) {
+        i += 1;
+        while ( i < reader->size && (unsigned char) (p[i] - '0') < 10 ) {
+            if ( m < 100000000000000000ULL ) {
+                m = m * 10 + (uint64_t) (p[i] - '0');
+                e -= 1;
+            } else if ( p[i] != '0' ) {
+                *exact = 0;
+            }
+            digits += 1;
+            i += 1;
+        }
+    }
+
+    if ( digits == 0 ) {
+        // inf, nan ou invalido: decidido pelo caminho lento
+        *exact = 0;
+        *end = ufr_buffer_token_end(reader, i);
+        reader->cursor = *end;
+        return UFR_OK;
+    }
+
+    if ( i < reader->size && (p[i] == 'e' || p[i] == 'E') ) {
+        i += 1;
+        int exp_neg = 0;
+        if ( i < reader->size && (p[i] == '-' || p[i] == '+') ) {
+            exp_neg = p[i] == '-';
+            i += 1;
+        }
+        const size_t exp_first = i;
+        int exp_val = 0;
+        while ( i < reader->size && (unsigned char) (p[i] - '0') < 10 ) {
+            if ( exp_val < 10000 ) {
+                exp_val = exp_val * 10 + (p[i] - '0');
+            }
+            i += 1;
+        }
+        if ( i == exp_first ) {
+            reader->cursor = ufr_buffer_token_end(reader, i);
+            return UFR_BUFFER_INVALID;
+        }
+        e += exp_neg ? -exp_val : exp_val;
+    }
+
+    if ( !ufr_buffer_is_sep(reader, i) ) {
+        reader->cursor = ufr_buffer_token_end(reader, i);
+        return UFR_BUFFER_INVALID;
+    }
+    reader->cursor = i;
+    *end = i;
+    *mant = m;
+    *exp10 = e;
+    return UFR_OK;
+}
+
+/* Caminho lento: strtod/strtof sobre uma copia do token, com o ponto
+ * trocado pelo separador decimal do locale atual. Tokens maiores que o
+ * buffer da pilha (decimais longos) sao copiados para o heap; -1 se o
+ * malloc falhar. So escreve em out quando o token inteiro foi lido. */
+static int ufr_buffer_parse_slow(const ufr_buffer_reader_t* reader, size_t ini, size_t end, int is_f32, double* out) {
+    char stack[128];
+    const size_t len = end - ini;
+    char* token = stack;
+    if ( len >= sizeof(stack) ) {
+        token = malloc(len + 1);
+        if ( token == NULL ) {
+            return -1;
+        }
+    }
+    memcpy(token, &reader->ptr[ini], len);
+    token[len] = '\0';
+    const char point = localeconv()->decimal_point[0];
+    if ( point != '.' ) {
+        char* dot = memchr(token, '.', len);
+        if ( dot ) {
+            *dot = point;
+        }
+    }
+    char* token_end;
+    const double val = is_f32 ? (double) strtof(token, &token_end) : strtod(token, &token_end);
+    const int res = ( token_end == &token[len] && len > 0 ) ? UFR_OK : UFR_BUFFER_INVALID;
+    if ( token != stack ) {
+        free(token);
+    }
+    if ( res == UFR_OK ) {
+        *out = val;
+    }
+    return res;
+}
+
+/* Le um double de texto. Com ate 17 digitos e expoente pequeno, o valor
+ * e m * 10^e ou m / 10^e com um unico arredondamento (Clinger), que e o
+ * caso do texto de ufr_buffer_put_f64_as_str. */
+static int ufr_buffer_get_text_f64(ufr_buffer_reader_t* reader, double* out) {
+    uint64_t mant;
+    int exp10, negative, exact;
+    size_t ini, end;
+    const int res = ufr_buffer_parse_decimal(reader, &mant, &exp10, &negative, &exact, &ini, &end);
+    if ( res != UFR_OK ) {
+        return res;
+    }
+    if ( exact && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22 ) {
+        double val = (double) mant;
+        val = ( exp10 < 0 ) ? val / g_ufr_buffer_exact_pow10[-exp10] : val * g_ufr_buffer_exact_pow10[exp10];
+        *out = negative ? -val : val;
+        return UFR_OK;
+    }
+    return ufr_buffer_parse_slow(reader, ini, end, 0, out);
+}
+
+/* Le um float de texto. O double do caminho rapido e convertido para float;
+ * se ele cair exatamente no meio de dois floats, o duplo arredondamento
+ * pode errar e o token vai para strtof. */
+static int ufr_buffer_get_text_f32(ufr_buffer_reader_t* reader, float* out) {
+    uint64_t mant;
+    int exp10, negative, exact;
+    size_t ini, end;
+    const int res = ufr_buffer_parse_decimal(reader, &mant, &exp10, &negative, &exact, &ini, &end);
+    if ( res != UFR_OK ) {
+        return res;
+    }
+    if ( exact && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22 ) {
+        double val = (double) mant;
+        val = ( exp10 < 0 ) ? val / g_ufr_buffer_exact_pow10[-exp10] : val * g_ufr_buffer_exact_pow10[exp10];
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        const int midpoint = (bits & 0x1FFFFFFFULL) == 0x10000000ULL;
+        if ( val == 0 || (!midpoint && val >= 1.17549435e-38 && val <= 3.4028234e38) ) {
+            *out = negative ? -(float) val : (float) val;
+            return UFR_OK;
+        }
+    }
+    double val;
+    const int slow = ufr_buffer_parse_slow(reader, ini, end, 1, &val);
+    if ( slow == UFR_OK ) {
+        *out = (float) val;
+    }
+    return slow;
+}
+
+/**
+ * @brief get the next value, in the mode of the reader
+ * 
+ * @param reader Reader object
+ * @param val output value
+ * @return UFR_OK, UFR_BUFFER_END or UFR_BUFFER_INVALID
+ */
+
+/* Le o proximo valor do tipo. As funcoes seguintes fazem o mesmo
+ * para os outros tipos. */
+int ufr_buffer_get_u8(ufr_buffer_reader_t* reader, uint8_t* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        return ufr_buffer_get_raw(reader, val, 1);
+    }
+    int negative;
+    uint64_t tmp;
+    const int res = ufr_buffer_parse_int(reader, 0, UINT8_MAX, &negative, &tmp);
+    if ( res == UFR_OK ) {
+        *val = (uint8_t) tmp;
+    }
+    return res;
+}
+
+int ufr_buffer_get_u16(ufr_buffer_reader_t* reader, uint16_t* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint16_t le;
+        const int res = ufr_buffer_get_raw(reader, &le, 2);
+        if ( res == UFR_OK ) {
+            *val = UFR_BUFFER_LE16(le);
+        }
+        return res;
+    }
+    int negative;
+    uint64_t tmp;
+    const int res = ufr_buffer_parse_int(reader, 0, UINT16_MAX, &negative, &tmp);
+    if ( res == UFR_OK ) {
+        *val = (uint16_t) tmp;
+    }
+    return res;
+}
+
+int ufr_buffer_get_u32(ufr_buffer_reader_t* reader, uint32_t* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint32_t le;
+        const int res = ufr_buffer_get_raw(reader, &le, 4);
+        if ( res == UFR_OK ) {
+            *val = UFR_BUFFER_LE32(le);
+        }
+        return res;
+    }
+    int negative;
+    uint64_t tmp;
+    const int res = ufr_buffer_parse_int(reader, 0, UINT32_MAX, &negative, &tmp);
+    if ( res == UFR_OK ) {
+        *val = (uint32_t) tmp;
+    }
+    return res;
+}
+
+int ufr_buffer_get_u64(ufr_buffer_reader_t* reader, uint64_t* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint64_t le;
+        const int res = ufr_buffer_get_raw(reader, &le, 8);
+        if ( res == UFR_OK ) {
+            *val = UFR_BUFFER_LE64(le);
+        }
+        return res;
+    }
+    int negative;
+    uint64_t tmp;
+    const int res = ufr_buffer_parse_int(reader, 0, UINT64_MAX, &negative, &tmp);
+    if ( res == UFR_OK ) {
+        *val = (uint64_t) tmp;
+    }
+    return res;
+}
+
+int ufr_buffer_get_i32(ufr_buffer_reader_t* reader, int32_t* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint32_t le;
+        const int res = ufr_buffer_get_raw(reader, &le, 4);
+        if ( res == UFR_OK ) {
+            *val = (int32_t) UFR_BUFFER_LE32(le);
+        }
+        return res;
+    }
+    int negative;
+    uint64_t tmp;
+    const int res = ufr_buffer_parse_int(reader, 2147483648ULL, INT32_MAX, &negative, &tmp);
+    if ( res == UFR_OK ) {
+        *val = negative ? (int32_t) (0u - (uint32_t) tmp) : (int32_t) tmp;
+    }
+    return res;
+}
+
+int ufr_buffer_get_f32(ufr_buffer_reader_t* reader, float* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint32_t bits;
+        const int res = ufr_buffer_get_raw(reader, &bits, 4);
+        if ( res == UFR_OK ) {
+            bits = UFR_BUFFER_LE32(bits);
+            memcpy(val, &bits, 4);
+        }
+        return res;
+    }
+    return ufr_buffer_get_text_f32(reader, val);
+}
+
+int ufr_buffer_get_f64(ufr_buffer_reader_t* reader, double* val) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        uint64_t bits;
+        const int res = ufr_buffer_get_raw(reader, &bits, 8);
+        if ( res == UFR_OK ) {
+            bits = UFR_BUFFER_LE64(bits);
+            memcpy(val, &bits, 8);
+        }
+        return res;
+    }
+    return ufr_buffer_get_text_f64(reader, val);
+}
+
+/**
+ * @brief get a pointer to the next count values in binary mode, without copy
+ * 
+ * @param reader Reader object
+ * @param elem_size size of each value
+ * @param count number of values
+ * @return pointer inside the data, or NULL in text mode or at the end of data
+ */
+
+/* Retorna os proximos count valores como ponteiro para os proprios dados.
+ * Com UFR_BUFFER_ALIGNED e dados vindos de malloc, o ponteiro esta
+ * alinhado e pode ser lido como vetor (ex: const float*) em maquinas
+ * little-endian. */
+const void* ufr_buffer_get_view(ufr_buffer_reader_t* reader, size_t elem_size, size_t count) {
+    if ( !(reader->mode & UFR_BUFFER_BINARY) ) {
+        return NULL;
+    }
+    const size_t ini = ufr_buffer_align(reader->cursor, elem_size, reader->mode);
+    if ( ini + elem_size * count > reader->size ) {
+        return NULL;
+    }
+    reader->cursor = ini + elem_size * count;
+    return &reader->ptr[ini];
+}
+
+/**
+ * @brief get the next text token, pointing inside the data, without copy
+ * 
+ * @param reader Reader object
+ * @param str output pointer to the first char of the token (not terminated by '\0')
+ * @param len output length of the token
+ * @return UFR_OK, UFR_BUFFER_END, or UFR_BUFFER_INVALID in binary mode
+ */
+
+/* Retorna o proximo token de texto como ponteiro e tamanho, sem copia. */
+int ufr_buffer_get_str(ufr_buffer_reader_t* reader, const char** str, size_t* len) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        return UFR_BUFFER_INVALID;
+    }
+    const int res = ufr_buffer_skip_space(reader);
+    if ( res != UFR_OK ) {
+        return res;
+    }
+    const size_t ini = reader->cursor;
+    reader->cursor = ufr_buffer_token_end(reader, ini);
+    *str = &reader->ptr[ini];
+    *len = reader->cursor - ini;
+    return UFR_OK;
+}
+
+/**
+ * @brief skip the next count text fields
+ * 
+ * @param reader Reader object
+ * @param count number of fields
+ * @return UFR_OK, UFR_BUFFER_END, or UFR_BUFFER_INVALID in binary mode
+ */
+
+/* Pula count campos de texto sem converter os valores. */
+int ufr_buffer_skip(ufr_buffer_reader_t* reader, size_t count) {
+    if ( reader->mode & UFR_BUFFER_BINARY ) {
+        return UFR_BUFFER_INVALID;
+    }
+    for (size_t i=0; i<count; i++) {
+        const int res = ufr_buffer_skip_space(reader);
+        if ( res != UFR_OK ) {
+            return res;
+        }
+        reader->cursor = ufr_buffer_token_end(reader, reader->cursor);
+    }
+    return UFR_OK;
+}
+
+// ============================================================================
+//  Cadeia de segmentos
+// ============================================================================
+
+/*
+ * A cadeia guarda a mensagem como uma lista de segmentos em um vetor de
+ * struct iovec. Dados pequenos sao copiados para segmentos proprios, de
+ * segment_size bytes; dados do usuario podem ser ligados sem copia com
+ * ufr_buffer_chain_put_ref. Nada e movido quando a cadeia cresce, apenas
+ * o vetor de iovec.
+ */
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* Garante espaco para mais um segmento no vetor de iovec. */
+static int ufr_buffer_chain_grow(ufr_buffer_chain_t* chain) {
+    if ( chain->count < chain->max ) {
+        return UFR_OK;
+    }
+    const size_t new_max = chain->max ? chain->max * 2 : 8;
+    struct iovec* iov = realloc(chain->iov, new_max * sizeof(struct iovec));
+    if ( iov == NULL ) {
+        return -1;
+    }
+    chain->iov = iov;
+    size_t* capacity = realloc(chain->capacity, new_max * sizeof(size_t));
+    if ( capacity == NULL ) {
+        return -1;
+    }
+    chain->capacity = capacity;
+    chain->max = new_max;
+    return UFR_OK;
+}
+
 /**
- * @brief Create a new buffer
+ * @brief Chain Constructor
  * 
- * @return ufr_buffer_t* 
+ * @param chain Chain object
+ * @param segment_size minimum size of the segments allocated by the chain,
+ *                     0 for 4096
  */
 
-/* Cria um novo buffer */
-ufr_buffer_t* ufr_buffer_new() {
-    ufr_buffer_t* buffer = malloc (sizeof(ufr_buffer_t));
-    
-    /*if (buffer == NULL) {
-        return NULL;
-    }*/
-    ufr_buffer_init(buffer);
-    return buffer;
+/* Inicializa uma cadeia vazia. */
+void ufr_buffer_chain_init(ufr_buffer_chain_t* chain, size_t segment_size) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_init)\n");
+        return;
+    }
+    chain->iov = NULL;
+    chain->capacity = NULL;
+    chain->count = 0;
+    chain->max = 0;
+    chain->size = 0;
+    chain->segment_size = segment_size > 0 ? segment_size : 4096;
 }
 
 /**
- * @brief Buffer Constructor
+ * @brief Remove all data of the chain, keeping the iovec array
  * 
- * @param buffer Buffer object
+ * @param chain Chain object
  */
 
-/* Inicializa buffer */
-void ufr_buffer_init(ufr_buffer_t* buffer) {
-    if (!buffer) {
-        fprintf (stderr,"Falha ao liberar memoria!(init)\n");
+/* Libera os segmentos proprios e esvazia a cadeia. A memoria ligada com
+ * ufr_buffer_chain_put_ref volta a ser apenas do usuario. */
+void ufr_buffer_chain_clear(ufr_buffer_chain_t* chain) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_clear)\n");
         return;
     }
-    buffer->size = 0;
-    buffer->max = MESSAGE_ITEM_SIZE;
-    buffer->ptr = malloc (buffer->max);
+    for (size_t i=0; i<chain->count; i++) {
+        if ( chain->capacity[i] > 0 ) {
+            free(chain->iov[i].iov_base);
+        }
+    }
+    chain->count = 0;
+    chain->size = 0;
 }
 
 /**
- * @brief Buffer Destructor
+ * @brief Chain Destructor
  * 
- * @param buffer 
+ * @param chain Chain object
  */
 
-/* Libera a memória alocada para o buffer, se o ponteiro não for NULL. */
-void ufr_buffer_free(ufr_buffer_t* buffer) {
-    if (!buffer) {
-        fprintf (stderr,"Falha ao liberar memoria!(free)\n");
+/* Libera toda a memoria da cadeia. */
+void ufr_buffer_chain_free(ufr_buffer_chain_t* chain) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_free)\n");
         return;
     }
-    free(buffer->ptr);
-    buffer->ptr = NULL;
-    buffer->max = 0;
-    buffer->size = 0;
+    ufr_buffer_chain_clear(chain);
+    free(chain->iov);
+    free(chain->capacity);
+    chain->iov = NULL;
+    chain->capacity = NULL;
+    chain->max = 0;
 }
 
 /**
- * @brief Clear data of the buffer
+ * @brief Copy data to the end of the chain
  * 
- * @param buffer Buffer object
+ * @param chain Chain object
+ * @param data data to be copied
+ * @param size size of data
  */
 
-/* Zera o campo size do buffer, indicando que o buffer está vazio
- * (os dados anteriores são considerados inválidos). */
-void ufr_buffer_clear(ufr_buffer_t* buffer) {
-    if (!buffer) {
-        fprintf (stderr,"Buffer invalido!(clear)\n");
+/* Copia os dados para o espaco livre do ultimo segmento proprio e, se nao
+ * couber, para um novo segmento com pelo menos segment_size bytes. */
+void ufr_buffer_chain_put(ufr_buffer_chain_t* chain, const void* data, size_t size) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_put)\n");
         return;
     }
-    buffer->size = 0;
+    const char* src = (const char*) data;
+
+    // completa o ultimo segmento, se for da cadeia
+    if ( chain->count > 0 ) {
+        struct iovec* last = &chain->iov[chain->count-1];
+        const size_t free_size = chain->capacity[chain->count-1] - last->iov_len;
+        if ( chain->capacity[chain->count-1] > 0 && free_size > 0 ) {
+            const size_t part = size < free_size ? size : free_size;
+            memcpy((char*) last->iov_base + last->iov_len, src, part);
+            last->iov_len += part;
+            chain->size += part;
+            src += part;
+            size -= part;
+        }
+    }
+    if ( size == 0 ) {
+        return;
+    }
+
+    // o restante vai para um novo segmento
+    if ( ufr_buffer_chain_grow(chain) != UFR_OK ) {
+        fprintf (stderr,"Ponteiro invalido!(chain_put)\n");
+        return;
+    }
+    const size_t capacity = size > chain->segment_size ? size : chain->segment_size;
+    char* segment = malloc(capacity);
+    if ( segment == NULL ) {
+        fprintf (stderr,"Ponteiro invalido!(chain_put)\n");
+        return;
+    }
+    memcpy(segment, src, size);
+    chain->iov[chain->count].iov_base = segment;
+    chain->iov[chain->count].iov_len = size;
+    chain->capacity[chain->count] = capacity;
+    chain->count += 1;
+    chain->size += size;
 }
 
 /**
- * @brief Check if the buffer has space enough with increment of the size
+ * @brief Link data of the caller to the end of the chain, without copy
  * 
- * @param buffer Buffer object
- * @param size increment size
+ * @param chain Chain object
+ * @param data data to be linked, valid until the chain is cleared
+ * @param size size of data
  */
 
-/* Verifica se o buffer tem espaço suficiente para acomodar um incremento
- * de tamanho (plus_size). */
-void ufr_buffer_check_size(ufr_buffer_t* buffer, size_t plus_size) {
-    if (!buffer) {
-        fprintf (stderr,"Buffer invalido!(check size)\n");
+/* Liga os dados do usuario como um novo segmento, sem copia. Os dados devem
+ * continuar validos e sem alteracao ate a cadeia ser enviada ou limpa. */
+void ufr_buffer_chain_put_ref(ufr_buffer_chain_t* chain, const void* data, size_t size) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_put_ref)\n");
         return;
     }
-    while (buffer->size + plus_size > buffer->max) {
-        const size_t new_max = buffer->max * 2;
-        char* new_ptr = realloc(buffer->ptr, new_max);
-
-        // Verifica se a realocação foi bem sucedida.
-        if (!new_ptr) {
-            fprintf (stderr,"Ponteiro invalido!");
-            return;
-        }
-        // Atualiza o buffer com o novo ponteiro.
-        buffer->max = new_max;
-        buffer->ptr = new_ptr;
+    if ( size == 0 ) {
+        return;
+    }
+    if ( ufr_buffer_chain_grow(chain) != UFR_OK ) {
+        fprintf (stderr,"Ponteiro invalido!(chain_put_ref)\n");
+        return;
     }
+    chain->iov[chain->count].iov_base = (void*) data;
+    chain->iov[chain->count].iov_len = size;
+    chain->capacity[chain->count] = 0;
+    chain->count += 1;
+    chain->size += size;
 }
 
 /**
- * @brief Put text in the buffer
+ * @brief Copy all the data of the chain to the end of a contiguous buffer
  * 
- * @param buffer Buffer object
- * @param text text to be put
- * @param size size of text
+ * @param chain Chain object
+ * @param buffer Buffer object that receives the data
  */
 
-/* Adiciona um bloco de dados ao buffer.*/
-void ufr_buffer_put(ufr_buffer_t* buffer, const char* text, size_t size) {
-    if (!buffer) {
-        fprintf (stderr,"Buffer invalido!(put)\n");
+/* Junta os segmentos em um buffer continuo, para quem precisa dos bytes em
+ * sequencia. Faz um unico check_size e uma copia por segmento. */
+void ufr_buffer_chain_flatten(const ufr_buffer_chain_t* chain, ufr_buffer_t* buffer) {
+    if (!chain || !buffer) {
+        fprintf (stderr,"Cadeia invalida!(chain_flatten)\n");
+        return;
+    }
+    char* base = ufr_buffer_reserve(buffer, chain->size + 1);
+    if ( base == NULL ) {
         return;
     }
+    for (size_t i=0; i<chain->count; i++) {
+        memcpy(base, chain->iov[i].iov_base, chain->iov[i].iov_len);
+        base += chain->iov[i].iov_len;
+    }
+    *base = '\0';
+    buffer->size += chain->size;
+}
 
-    // Verifica se há espaço suficiente no buffer
-    ufr_buffer_check_size(buffer, size+1); 
+/**
+ * @brief Send all the data of the chain with writev
+ * 
+ * @param chain Chain object
+ * @param fd file descriptor
+ * @return ssize_t number of bytes written, or -1 on error (errno is kept);
+ *         if the error comes after some bytes were sent, that count is
+ *         returned instead, with errno still set
+ */
 
-    // Copia os dados para o buffer
-    char* base = &buffer->ptr[buffer->size];
-    strncpy(base, text, size);
-    buffer->size += size; //atualiza o tamanho atual do buffer
+/* Envia a cadeia sem junta-la, em blocos de ate IOV_MAX segmentos e
+ * continuando apos escritas parciais. Um erro depois de bytes enviados
+ * devolve o total, para o chamador saber onde retomar. */
+ssize_t ufr_buffer_chain_writev(const ufr_buffer_chain_t* chain, int fd) {
+    if (!chain) {
+        fprintf (stderr,"Cadeia invalida!(chain_writev)\n");
+        return -1;
+    }
+    size_t total = 0;
+    size_t index = 0;
+    size_t offset = 0;     // bytes ja enviados de iov[index]
+    while ( index < chain->count ) {
+        struct iovec batch[64];
+        int count = 0;
+        const int batch_max = IOV_MAX < 64 ? IOV_MAX : 64;
+        for (size_t i=index; i<chain->count && count<batch_max; i++) {
+            batch[count] = chain->iov[i];
+            if ( i == index ) {
+                batch[count].iov_base = (char*) batch[count].iov_base + offset;
+                batch[count].iov_len -= offset;
+            }
+            count += 1;
+        }
+
+        const ssize_t sent = writev(fd, batch, count);
+        if ( sent < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return ( total > 0 ) ? (ssize_t) total : -1;
+        }
+        total += (size_t) sent;
+
+        // avanca pelos segmentos enviados
+        size_t rest = (size_t) sent;
+        while ( index < chain->count && rest >= chain->iov[index].iov_len - offset ) {
+            rest -= chain->iov[index].iov_len - offset;
+            offset = 0;
+            index += 1;
+        }
+        offset += rest;
+    }
+    return (ssize_t) total;
+}
+
+// ============================================================================
+//  Anel de registros
+// ============================================================================
+
+/*
+ * Cada registro tem um cabecalho de 8 bytes seguido dos dados, alinhado a
+ * 8 bytes, e nunca da a volta no fim da regiao: se nao couber, o produtor
+ * preenche o final com um registro de pulo e escreve no inicio. head e
+ * tail sao posicoes absolutas que so crescem; a posicao na regiao e
+ * pos & (capacity - 1).
+ *
+ * Se o pulo e o registro juntos passam da capacidade, os dois nunca
+ * caberiam nem com o anel vazio: o produtor publica o pulo sozinho e a
+ * reserva devolve NULL. A proxima tentativa, depois que o consumidor
+ * passar pelo pulo, comeca no inicio da regiao.
+ *
+ * SPSC: o produtor publica o registro avancando head (release) e o
+ * consumidor avanca tail. Cada lado guarda uma copia do indice do outro e
+ * so le o atomico quando a copia nao basta.
+ *
+ * MPSC: os produtores reservam com CAS em head e publicam marcando o
+ * cabecalho como pronto (release), em qualquer ordem. O consumidor para no
+ * primeiro cabecalho nao pronto e zera o espaco que libera, para que um
+ * cabecalho ainda nao escrito seja sempre lido como 0.
+ */
+
+#define UFR_BUFFER_RING_HEADER  8
+#define UFR_BUFFER_RING_READY   0x80000000u
+#define UFR_BUFFER_RING_SKIP    0x40000000u
+#define UFR_BUFFER_RING_LEN     0x3FFFFFFFu
+
+static size_t ufr_buffer_ring_record_size(size_t size) {
+    return (UFR_BUFFER_RING_HEADER + size + 7) & ~((size_t) 7);
+}
+
+static _Atomic uint32_t* ufr_buffer_ring_header(const ufr_buffer_ring_t* ring, size_t pos) {
+    return (_Atomic uint32_t*) &ring->data[pos & (ring->capacity - 1)];
 }
 
 /**
- * @brief put a char in the buffer
+ * @brief Ring Constructor
  * 
- * @param buffer Buffer object
- * @param val charachter which to be inserted
+ * @param ring Ring object
+ * @param capacity size of the region, rounded up to a power of 2
+ * @param mode UFR_BUFFER_RING_SPSC or UFR_BUFFER_RING_MPSC
+ * @return UFR_OK or -1 on error
  */
 
-/* Adiciona um único caractere ao buffer. */
-void ufr_buffer_put_chr(ufr_buffer_t* buffer, char val) {
-    if (!buffer) {
-        fprintf (stderr,"Buffer invalido!(put_chr)\n");
-        return;
+/* Aloca a regiao do anel, alinhada a linha de cache e zerada. */
+int ufr_buffer_ring_init(ufr_buffer_ring_t* ring, size_t capacity, uint8_t mode) {
+    if (!ring) {
+        fprintf (stderr,"Anel invalido!(ring_init)\n");
+        return -1;
     }
-    size_t size = 0;
-    ufr_buffer_check_size(buffer, 1);
-    buffer->ptr[buffer->size] = val;
-    buffer->size += 1;
+    if ( capacity > UFR_BUFFER_RING_LEN ) {
+        fprintf (stderr,"Tamanho invalido!(ring_init)\n");
+        return -1;
+    }
+    size_t cap = UFR_BUFFER_CACHE_LINE;
+    while ( cap < capacity ) {
+        cap *= 2;
+    }
+    ring->data = aligned_alloc(UFR_BUFFER_CACHE_LINE, cap);
+    if ( ring->data == NULL ) {
+        return -1;
+    }
+    memset(ring->data, 0, cap);
+    ring->capacity = cap;
+    ring->mode = mode;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->head_reserved = 0;
+    ring->tail_cache = 0;
+    ring->head_cache = 0;
+    return UFR_OK;
 }
 
 /**
- * @brief put an unsigned int of 8bit as string
+ * @brief Ring Destructor
  * 
- * @param buffer Buffer object
- * @param val unsigned int value to be converted and inserted
+ * @param ring Ring object
  */
 
-/*Converte um valor uint8_t (inteiro sem sinal de 8 bits) em uma string
- * e a adiciona ao buffer. */
-void ufr_buffer_put_u8_as_str(ufr_buffer_t* buffer, uint8_t val) {
-    if (!buffer) {
-        fprintf (stderr,"Buffer invalido!(put_u8)\n");
+/* Libera a regiao do anel; nenhuma thread pode estar usando o anel. */
+void ufr_buffer_ring_free(ufr_buffer_ring_t* ring) {
+    if (!ring) {
+        fprintf (stderr,"Anel invalido!(ring_free)\n");
         return;
-    }  
-    ufr_buffer_check_size(buffer, 5); 
-    char* base = &buffer->ptr[buffer->size];
-    size_t size;
+    }
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+}
 
-    /* Se o buffer estiver vazio, o valor é adicionado sem espaço antes.
-    * Caso contrário, um espaço é adicionado antes do valor.*/
-    if ( buffer->size == 0 ) {
-        size = snprintf(base, 8, "%u", val);
+/**
+ * @brief Reserve a record to be written in place by the producer
+ * 
+ * @param ring Ring object
+ * @param size size of the record
+ * @return void* where the record must be written, or NULL if the ring is full
+ */
+
+/* Reserva size bytes para um registro. Em SPSC a reserva seguinte so pode
+ * ser feita apos ufr_buffer_ring_commit; em MPSC cada produtor faz commit
+ * do proprio registro. */
+void* ufr_buffer_ring_reserve(ufr_buffer_ring_t* ring, size_t size) {
+    const size_t rec = ufr_buffer_ring_record_size(size);
+    if ( size > UFR_BUFFER_RING_LEN || rec > ring->capacity ) {
+        return NULL;
+    }
+
+    size_t pos, skip;
+    if ( ring->mode == UFR_BUFFER_RING_SPSC ) {
+        pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        const size_t off = pos & (ring->capacity - 1);
+        skip = off + rec > ring->capacity ? ring->capacity - off : 0;
+        if ( pos + skip + rec - ring->tail_cache > ring->capacity ) {
+            ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if ( pos + skip + rec - ring->tail_cache > ring->capacity ) {
+                if ( skip + rec > ring->capacity && pos + skip - ring->tail_cache <= ring->capacity ) {
+                    // nao cabe nem com o anel vazio: publica o pulo sozinho
+                    atomic_store_explicit(ufr_buffer_ring_header(ring, pos),
+                                          (uint32_t) skip | UFR_BUFFER_RING_SKIP | UFR_BUFFER_RING_READY,
+                                          memory_order_relaxed);
+                    atomic_store_explicit(&ring->head, pos + skip, memory_order_release);
+                }
+                return NULL;
+            }
+        }
+        if ( skip > 0 ) {
+            atomic_store_explicit(ufr_buffer_ring_header(ring, pos),
+                                  (uint32_t) skip | UFR_BUFFER_RING_SKIP | UFR_BUFFER_RING_READY,
+                                  memory_order_relaxed);
+        }
+        ring->head_reserved = pos + skip + rec;
     } else {
-        size = snprintf(base, 8, " %u", val);
+        pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        while ( 1 ) {
+            const size_t off = pos & (ring->capacity - 1);
+            skip = off + rec > ring->capacity ? ring->capacity - off : 0;
+            const size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            if ( pos + skip + rec - tail <= ring->capacity ) {
+                if ( atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + skip + rec,
+                                                           memory_order_relaxed, memory_order_relaxed) ) {
+                    break;
+                }
+                continue;
+            }
+            if ( skip + rec <= ring->capacity || pos + skip - tail > ring->capacity ) {
+                return NULL;
+            }
+            // nao cabe nem com o anel vazio: reserva e publica o pulo sozinho
+            if ( atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + skip,
+                                                       memory_order_relaxed, memory_order_relaxed) ) {
+                atomic_store_explicit(ufr_buffer_ring_header(ring, pos),
+                                      (uint32_t) skip | UFR_BUFFER_RING_SKIP | UFR_BUFFER_RING_READY,
+                                      memory_order_release);
+                return NULL;
+            }
+        }
+        if ( skip > 0 ) {
+            atomic_store_explicit(ufr_buffer_ring_header(ring, pos),
+                                  (uint32_t) skip | UFR_BUFFER_RING_SKIP | UFR_BUFFER_RING_READY,
+                                  memory_order_release);
+        }
     }
-    buffer->size += size;  
+
+    // o tamanho fica no cabecalho; READY e marcado no commit em MPSC
+    pos += skip;
+    const uint32_t header = (uint32_t) size | (ring->mode == UFR_BUFFER_RING_SPSC ? UFR_BUFFER_RING_READY : 0);
+    atomic_store_explicit(ufr_buffer_ring_header(ring, pos), header, memory_order_relaxed);
+    return &ring->data[(pos & (ring->capacity - 1)) + UFR_BUFFER_RING_HEADER];
 }
 
 /**
- * @brief put an int of 8bit as string
+ * @brief Publish a record reserved by ufr_buffer_ring_reserve
  * 
- * @param buffer Buffer object
- * @param val int value to be converted and inserted
+ * @param ring Ring object
+ * @param record pointer returned by ufr_buffer_ring_reserve
  */
 
-/*Similar à função ufr_buffer_put_u8_as_str, mas para valores int8_t
- * (inteiro com sinal de 8 bits). */
-void ufr_buffer_put_i8_as_str(ufr_buffer_t* buffer, int8_t val) {
-    if (!buffer) {
-        fprintf (stderr, "Buffer invalido!(put_i8)\n");
-        return;
-    }
-    ufr_buffer_check_size(buffer, 5);
-    char* base = &buffer->ptr[buffer->size];
-    size_t size;
-    if ( buffer->size == 0 ) {
-        size = snprintf(base, 8, "%d", val);
+/* Publica o registro para o consumidor. */
+void ufr_buffer_ring_commit(ufr_buffer_ring_t* ring, void* record) {
+    if ( ring->mode == UFR_BUFFER_RING_SPSC ) {
+        atomic_store_explicit(&ring->head, ring->head_reserved, memory_order_release);
     } else {
-        size = snprintf(base, 8, " %d", val);
+        _Atomic uint32_t* header = (_Atomic uint32_t*) ((char*) record - UFR_BUFFER_RING_HEADER);
+        const uint32_t val = atomic_load_explicit(header, memory_order_relaxed);
+        atomic_store_explicit(header, val | UFR_BUFFER_RING_READY, memory_order_release);
     }
-    buffer->size += size;
 }
 
 /**
- * @brief put an unsigned int as string
+ * @brief Read the next record without removing it
  * 
- * @param buffer Buffer object
- * @param val int value to be converted and inserted
+ * @param ring Ring object
+ * @param size size of the record
+ * @return const void* record, or NULL if there is no published record
  */
 
-/*Converte um valor uint32_t (inteiro sem sinal de 32 bits) em uma string
- * e a adiciona ao buffer. */
-void ufr_buffer_put_u32_as_str(ufr_buffer_t* buffer, uint32_t val) {
-    if (!buffer) {
-        fprintf (stderr, "Buffer invalido!(put_u32)\n");
-        return;
+/* Retorna o proximo registro publicado; ele continua valido ate
+ * ufr_buffer_ring_release. Somente o consumidor chama esta funcao. */
+const void* ufr_buffer_ring_peek(ufr_buffer_ring_t* ring, size_t* size) {
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while ( 1 ) {
+        uint32_t header;
+        if ( ring->mode == UFR_BUFFER_RING_SPSC ) {
+            if ( pos == ring->head_cache ) {
+                ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+                if ( pos == ring->head_cache ) {
+                    return NULL;
+                }
+            }
+            header = atomic_load_explicit(ufr_buffer_ring_header(ring, pos), memory_order_relaxed);
+        } else {
+            header = atomic_load_explicit(ufr_buffer_ring_header(ring, pos), memory_order_acquire);
+            if ( (header & UFR_BUFFER_RING_READY) == 0 ) {
+                return NULL;
+            }
+        }
+
+        if ( (header & UFR_BUFFER_RING_SKIP) == 0 ) {
+            *size = header & UFR_BUFFER_RING_LEN;
+            return &ring->data[(pos & (ring->capacity - 1)) + UFR_BUFFER_RING_HEADER];
+        }
+
+        // registro de pulo: volta para o inicio da regiao
+        const size_t skip = header & UFR_BUFFER_RING_LEN;
+        if ( ring->mode == UFR_BUFFER_RING_MPSC ) {
+            memset(&ring->data[pos & (ring->capacity - 1)], 0, skip);
+        }
+        pos += skip;
+        atomic_store_explicit(&ring->tail, pos, memory_order_release);
     }
-    ufr_buffer_check_size(buffer, 15);
-    char* base = &buffer->ptr[buffer->size];
-    size_t size = 0;
-    if ( buffer->size == 0 ) {
-        size = snprintf(base, 15, "%u", val);
-    } else {
-        size = snprintf(base, 15, " %u", val);
+}
+
+/**
+ * @brief Remove the record returned by ufr_buffer_ring_peek
+ * 
+ * @param ring Ring object
+ */
+
+/* Devolve o espaco do registro lido para os produtores. */
+void ufr_buffer_ring_release(ufr_buffer_ring_t* ring) {
+    const size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const uint32_t header = atomic_load_explicit(ufr_buffer_ring_header(ring, pos), memory_order_relaxed);
+    const size_t rec = ufr_buffer_ring_record_size(header & UFR_BUFFER_RING_LEN);
+    if ( ring->mode == UFR_BUFFER_RING_MPSC ) {
+        memset(&ring->data[pos & (ring->capacity - 1)], 0, rec);
     }
-    buffer->size += size;
+    atomic_store_explicit(&ring->tail, pos + rec, memory_order_release);
 }
 
 /**
- * @brief put an int as string
+ * @brief Copy the data of the buffer to a new record
  * 
+ * @param ring Ring object
  * @param buffer Buffer object
- * @param val int value to be converted and inserted
+ * @return UFR_OK or UFR_BUFFER_FULL
  */
 
-/* Similar à função ufr_buffer_put_u32_as_str, mas para valores int32_t 
- * (inteiro com sinal de 32 bits). */
-void ufr_buffer_put_i32_as_str(ufr_buffer_t* buffer, int32_t val) {
-    if (!buffer) {
-        fprintf (stderr, "Buffer invalido!(put_i32)\n");
-        return;
+/* Copia buffer->ptr[0..size) para um registro do anel. */
+int ufr_buffer_ring_put(ufr_buffer_ring_t* ring, const ufr_buffer_t* buffer) {
+    if (!ring || !buffer) {
+        fprintf (stderr,"Anel invalido!(ring_put)\n");
+        return UFR_BUFFER_INVALID;
     }
-    ufr_buffer_check_size(buffer, 15);
-    char* base = &buffer->ptr[buffer->size];
-    size_t size = 0;
-    if ( buffer->size == 0 ) {
-        size = snprintf(base, 15, "%d", val);
-    } else {
-        size = snprintf(base, 15, " %d", val);
+    void* record = ufr_buffer_ring_reserve(ring, buffer->size);
+    if ( record == NULL ) {
+        return UFR_BUFFER_FULL;
     }
-    buffer->size += size;
+    memcpy(record, buffer->ptr, buffer->size);
+    ufr_buffer_ring_commit(ring, record);
+    return UFR_OK;
 }
 
 /**
- * @brief put an float as string
+ * @brief Move the next record to the end of the buffer
  * 
+ * @param ring Ring object
  * @param buffer Buffer object
- * @param val float value to be converted and inserted
+ * @return UFR_OK or UFR_BUFFER_END if there is no record
  */
 
-/* Converte um valor float em uma string e a adiciona ao buffer.
- * Funciona de forma semelhante às funções anteriores, mas para valores
- * de ponto flutuante. */
-void ufr_buffer_put_f32_as_str(ufr_buffer_t* buffer, float val) {
-    if (!buffer) {
-        fprintf (stderr, "Buffer invalido!(put_f32)\n");
-        return;
+/* Copia o proximo registro para o fim do buffer e o remove do anel. */
+int ufr_buffer_ring_get(ufr_buffer_ring_t* ring, ufr_buffer_t* buffer) {
+    if (!ring || !buffer) {
+        fprintf (stderr,"Anel invalido!(ring_get)\n");
+        return UFR_BUFFER_INVALID;
     }
-    ufr_buffer_check_size(buffer, 32);
-    char* base = &buffer->ptr[buffer->size];
     size_t size;
-    if ( buffer->size == 0 ) {
-        size = snprintf(base, 32, "%f", val);
-    } else {
-        size = snprintf(base, 32, " %f", val);
+    const void* record = ufr_buffer_ring_peek(ring, &size);
+    if ( record == NULL ) {
+        return UFR_BUFFER_END;
     }
-    buffer->size += size;
+    ufr_buffer_put(buffer, record, size);
+    ufr_buffer_ring_release(ring);
+    return UFR_OK;
+}
+
+// ============================================================================
+//  Arquivo mapeado
+// ============================================================================
+
+/*
+ * Buffer gravado direto em um arquivo com mmap: o arquivo e o alocador do
+ * buffer, e cada crescimento de check_size vira ftruncate + mremap. Os
+ * puts escrevem no page cache, sem copia para um FILE* e sem manter a
+ * gravacao inteira no heap. ufr_buffer_file_close corta o arquivo no
+ * tamanho dos dados. Para reproduzir, ufr_buffer_file_open mapeia o
+ * arquivo somente para leitura e o leitor trabalha direto no mapeamento.
+ */
+
+static size_t ufr_buffer_file_page(size_t size) {
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+static void* ufr_buffer_file_alloc(ufr_buffer_allocator_t* self, size_t size) {
+    ufr_buffer_file_t* file = (ufr_buffer_file_t*) self;
+    if ( file->map != NULL || ftruncate(file->fd, (off_t) size) != 0 ) {
+        return NULL;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if ( map == MAP_FAILED ) {
+        return NULL;
+    }
+    file->map = map;
+    file->size = size;
+    return map;
+}
+
+static void* ufr_buffer_file_realloc(ufr_buffer_allocator_t* self, void* ptr, size_t old_size, size_t new_size) {
+    ufr_buffer_file_t* file = (ufr_buffer_file_t*) self;
+    if ( ptr == NULL ) {
+        return ufr_buffer_file_alloc(self, new_size);
+    }
+    if ( ftruncate(file->fd, (off_t) new_size) != 0 ) {
+        return NULL;
+    }
+#ifdef __linux__
+    void* map = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+#else
+    // os dados ja estao no arquivo, basta mapear de novo
+    munmap(ptr, old_size);
+    void* map = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+#endif
+    if ( map == MAP_FAILED ) {
+        return NULL;
+    }
+    file->map = map;
+    file->size = new_size;
+    return map;
+}
+
+static void ufr_buffer_file_free(ufr_buffer_allocator_t* self, void* ptr, size_t size) {
+    ufr_buffer_file_t* file = (ufr_buffer_file_t*) self;
+    if ( ptr != NULL ) {
+        munmap(ptr, size);
+    }
+    file->map = NULL;
+    file->size = 0;
 }
 
 /**
- * @brief put a string
+ * @brief Create a file and a buffer whose data is the file mapped in memory
  * 
+ * @param file File object, the allocator of the buffer
  * @param buffer Buffer object
- * @param val string to be inserted to the buffer
+ * @param path path of the file, truncated if it exists
+ * @param capacity initial size of the file, rounded up to pages
+ * @return UFR_OK or -1 on error (errno is kept)
  */
 
-/* Adiciona uma string (text) ao buffer. */
-void ufr_buffer_put_str(ufr_buffer_t* buffer, const char* text) {
-    if (!buffer) {
-        fprintf (stderr, "Buffer invalido!(put_str)\n");
-        printf("\n");
-        return;
+/* Cria o arquivo e inicializa o buffer com os dados mapeados nele. Os puts
+ * seguintes gravam no arquivo; ufr_buffer_file_close termina a gravacao. */
+int ufr_buffer_file_create(ufr_buffer_file_t* file, ufr_buffer_t* buffer, const char* path, size_t capacity) {
+    if (!file || !buffer || !path) {
+        fprintf (stderr,"Arquivo invalido!(file_create)\n");
+        return -1;
     }
-    const size_t size = strlen(text); // Calcula o tamanho da string 
-    ufr_buffer_check_size(buffer, size); // Verifica se há espaço suficiente no buffer
-    if ( buffer->size == 0 ) {
-        ufr_buffer_put(buffer, text, size); // Adiciona a string 
-    } else {
-        ufr_buffer_put(buffer, " ", 1);
-        ufr_buffer_put(buffer, text, size); // Adiciona a string 
+    file->base.alloc = ufr_buffer_file_alloc;
+    file->base.realloc = ufr_buffer_file_realloc;
+    file->base.free = ufr_buffer_file_free;
+    file->map = NULL;
+    file->size = 0;
+    file->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( file->fd < 0 ) {
+        return -1;
+    }
+
+    // o mapeamento comeca ja fora do espaco local do buffer
+    if ( capacity <= UFR_BUFFER_INLINE_SIZE ) {
+        capacity = UFR_BUFFER_INLINE_SIZE + 1;
+    }
+    ufr_buffer_init_with_allocator(buffer, &file->base);
+    ufr_buffer_resize(buffer, ufr_buffer_file_page(capacity));
+    if ( file->map == NULL ) {
+        const int error = errno;
+        close(file->fd);
+        file->fd = -1;
+        ufr_buffer_init(buffer);
+        errno = error;
+        return -1;
+    }
+    return UFR_OK;
+}
+
+/**
+ * @brief Map an existing file read-only, to be replayed without copies
+ * 
+ * @param file File object; file->map and file->size are the data
+ * @param path path of the file
+ * @return UFR_OK or -1 on error (errno is kept)
+ */
+
+/* Mapeia o arquivo somente para leitura, por exemplo para
+ * ufr_buffer_reader_init(&reader, file.map, file.size, mode). */
+int ufr_buffer_file_open(ufr_buffer_file_t* file, const char* path) {
+    if (!file || !path) {
+        fprintf (stderr,"Arquivo invalido!(file_open)\n");
+        return -1;
     }
-}
\ No newline at end of file
+    file->base.alloc = NULL;
+    file->base.realloc = NULL;
+    file->base.free = NULL;
+    file->map = NULL;
+    file->size = 0;
+    file->fd = open(path, O_RDONLY);
+    if ( file->fd < 0 ) {
+        return -1;
+    }
+    struct stat st;
+    if ( fstat(file->fd, &st) != 0 ) {
+        const int error = errno;
+        close(file->fd);
+        file->fd = -1;
+        errno = error;
+        return -1;
+    }
+    if ( st.st_size > 0 ) {
+        void* map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, file->fd, 0);
+        if ( map == MAP_FAILED ) {
+            const int error = errno;
+            close(file->fd);
+            file->fd = -1;
+            errno = error;
+            return -1;
+        }
+        // leitura em sequencia na reproducao
+        madvise(map, (size_t) st.st_size, MADV_SEQUENTIAL);
+        file->map = map;
+        file->size = (size_t) st.st_size;
+    }
+    return UFR_OK;
+}
+
+/**
+ * @brief Finish a file from ufr_buffer_file_create or ufr_buffer_file_open
+ * 
+ * @param file File object
+ * @param buffer Buffer from ufr_buffer_file_create, or NULL for a file
+ *               from ufr_buffer_file_open
+ * @return UFR_OK or -1 on error (errno is kept)
+ */
+
+/* Corta o arquivo no tamanho dos dados do buffer, desfaz o mapeamento e
+ * fecha o arquivo. O buffer volta a ser um buffer vazio em memoria. */
+int ufr_buffer_file_close(ufr_buffer_file_t* file, ufr_buffer_t* buffer) {
+    if (!file) {
+        fprintf (stderr,"Arquivo invalido!(file_close)\n");
+        return -1;
+    }
+    int res = UFR_OK;
+    if ( buffer != NULL && buffer->allocator == &file->base ) {
+        // dados que voltaram para o espaco local (shrink_to_fit) vao para o arquivo
+        if ( buffer->ptr == buffer->local && buffer->size > 0 ) {
+            if ( pwrite(file->fd, buffer->local, buffer->size, 0) != (ssize_t) buffer->size ) {
+                res = -1;
+            }
+        }
+        const size_t size = buffer->size;
+        ufr_buffer_free(buffer);
+        if ( ftruncate(file->fd, (off_t) size) != 0 ) {
+            res = -1;
+        }
+        buffer->allocator = NULL;
+    } else if ( file->map != NULL ) {
+        munmap(file->map, file->size);
+    }
+    file->map = NULL;
+    file->size = 0;
+    if ( file->fd >= 0 && close(file->fd) != 0 ) {
+        res = -1;
+    }
+    file->fd = -1;
+    return res;
+}
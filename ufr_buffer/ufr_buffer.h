@@ -31,21 +31,128 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
-#define MESSAGE_ITEM_SIZE 10 //4096L
+// dados ate este tamanho ficam dentro do proprio ufr_buffer_t, sem malloc;
+// com os outros campos a estrutura ocupa 128 bytes (duas linhas de cache)
+#define UFR_BUFFER_INLINE_SIZE 80
+#define MESSAGE_ITEM_SIZE UFR_BUFFER_INLINE_SIZE //4096L
 
 
+// modo de codificacao dos puts sem sufixo (ufr_buffer_put_u32, ...)
+#define UFR_BUFFER_TEXT     0   // numeros em ASCII separados por espaco
+#define UFR_BUFFER_BINARY   1   // bytes little-endian
+#define UFR_BUFFER_ALIGNED  2   // com UFR_BUFFER_BINARY, alinha cada valor ao seu tamanho
+
+// retorno dos leitores
+#define UFR_OK 0
+#define UFR_BUFFER_END      1   // dados terminaram
+#define UFR_BUFFER_INVALID  2   // token de texto nao e um numero do tipo
+#define UFR_BUFFER_FULL     3   // anel sem espaco para o registro
+
+// variantes do anel (ufr_buffer_ring_init)
+#define UFR_BUFFER_RING_SPSC 0  // um produtor, um consumidor
+#define UFR_BUFFER_RING_MPSC 1  // varios produtores, um consumidor
+
+// politica de crescimento: nova capacidade para guardar need bytes, a
+// partir da capacidade atual max (que pode ser 0)
+typedef size_t (*ufr_buffer_growth_t)(size_t max, size_t need);
+
+// alocador da memoria do buffer; NULL usa malloc/realloc/free
+typedef struct _ufr_buffer_allocator {
+    void* (*alloc)(struct _ufr_buffer_allocator* self, size_t size);
+    void* (*realloc)(struct _ufr_buffer_allocator* self, void* ptr, size_t old_size, size_t new_size);
+    void  (*free)(struct _ufr_buffer_allocator* self, void* ptr, size_t size);
+} ufr_buffer_allocator_t;
+
+// arena: blocos alocados em sequencia e liberados todos de uma vez
+typedef struct _ufr_buffer_arena_chunk ufr_buffer_arena_chunk_t;
+typedef struct {
+    ufr_buffer_allocator_t base;
+    ufr_buffer_arena_chunk_t* chunk;
+    size_t chunk_size;
+    char* last;             // ultimo bloco alocado, que pode crescer no lugar
+} ufr_buffer_arena_t;
+
 typedef struct {
     size_t size;
     size_t max;
     char* ptr;
+    uint8_t mode;
+    ufr_buffer_growth_t growth;     // NULL = ufr_buffer_grow_2x
+    ufr_buffer_allocator_t* allocator;
+    char local[UFR_BUFFER_INLINE_SIZE];   // ptr == local ate os dados crescerem
 } ufr_buffer_t;
 
+// cadeia de segmentos: dados grandes sao ligados, nao copiados; iov[0..count)
+// pode ser passado direto para writev/sendmsg
+typedef struct {
+    struct iovec* iov;
+    size_t* capacity;       // capacidade de cada segmento proprio, 0 = memoria do usuario
+    size_t count;
+    size_t max;             // tamanho dos vetores iov e capacity
+    size_t size;            // total de bytes na cadeia
+    size_t segment_size;    // tamanho minimo dos segmentos alocados pela cadeia
+} ufr_buffer_chain_t;
+
+// anel de registros de tamanho variavel em uma regiao pre-alocada; os
+// indices ficam em linhas de cache separadas para o produtor e o consumidor
+#define UFR_BUFFER_CACHE_LINE 64
+typedef struct {
+    _Alignas(UFR_BUFFER_CACHE_LINE) _Atomic size_t head;   // proxima posicao livre
+    size_t head_reserved;   // SPSC: posicao apos o registro reservado
+    size_t tail_cache;      // SPSC: ultima tail lida pelo produtor
+
+    _Alignas(UFR_BUFFER_CACHE_LINE) _Atomic size_t tail;   // proximo registro a ler
+    size_t head_cache;      // SPSC: ultima head lida pelo consumidor
+
+    _Alignas(UFR_BUFFER_CACHE_LINE) char* data;
+    size_t capacity;        // potencia de 2
+    uint8_t mode;
+} ufr_buffer_ring_t;
+
+// arquivo mapeado em memoria, usado como alocador do buffer na gravacao
+// (ufr_buffer_file_create) ou lido direto em map na reproducao
+// (ufr_buffer_file_open)
+typedef struct {
+    ufr_buffer_allocator_t base;
+    int fd;
+    char* map;
+    size_t size;            // tamanho mapeado
+} ufr_buffer_file_t;
+
+// ptr pode apontar para dentro da propria estrutura: um ufr_buffer_t nao
+// deve ser copiado com = ou memcpy, apenas passado por ponteiro
+
+// leitor dos dados escritos por um ufr_buffer_t, sem copia dos dados
+typedef struct {
+    const char* ptr;
+    size_t size;
+    size_t cursor;
+    uint8_t mode;
+} ufr_buffer_reader_t;
+
 ufr_buffer_t* ufr_buffer_new();
 void ufr_buffer_init(ufr_buffer_t* buffer);
+void ufr_buffer_init_with_capacity(ufr_buffer_t* buffer, size_t capacity);
+void ufr_buffer_init_with_allocator(ufr_buffer_t* buffer, ufr_buffer_allocator_t* allocator);
+ufr_buffer_t* ufr_buffer_new_with_allocator(ufr_buffer_allocator_t* allocator);
+void ufr_buffer_delete(ufr_buffer_t* buffer);
+void ufr_buffer_set_growth(ufr_buffer_t* buffer, ufr_buffer_growth_t growth);
+void ufr_buffer_shrink_to_fit(ufr_buffer_t* buffer);
+size_t ufr_buffer_grow_exact(size_t max, size_t need);
+size_t ufr_buffer_grow_1_5x(size_t max, size_t need);
+size_t ufr_buffer_grow_2x(size_t max, size_t need);
+size_t ufr_buffer_grow_page(size_t max, size_t need);
+size_t ufr_buffer_grow_hugepage(size_t max, size_t need);
 void ufr_buffer_clear(ufr_buffer_t* buffer);
 void ufr_buffer_free(ufr_buffer_t* buffer);
 void ufr_buffer_check_size(ufr_buffer_t* buffer, size_t plus_size);
+char* ufr_buffer_reserve(ufr_buffer_t* buffer, size_t size);
+void ufr_buffer_commit(ufr_buffer_t* buffer, size_t size);
 void ufr_buffer_put(ufr_buffer_t* buffer, const char* text, size_t size);
 void ufr_buffer_put_chr(ufr_buffer_t* buffer, char val);
 void ufr_buffer_put_u8_as_str(ufr_buffer_t* buffer, uint8_t val);
@@ -53,4 +160,62 @@ void ufr_buffer_put_i8_as_str(ufr_buffer_t* buffer, int8_t val);
 void ufr_buffer_put_u32_as_str(ufr_buffer_t* buffer, uint32_t val);
 void ufr_buffer_put_i32_as_str(ufr_buffer_t* buffer, int32_t val);
 void ufr_buffer_put_f32_as_str(ufr_buffer_t* buffer, float val);
-void ufr_buffer_put_str(ufr_buffer_t* buffer, const char* text);
\ No newline at end of file
+void ufr_buffer_put_f64_as_str(ufr_buffer_t* buffer, double val);
+void ufr_buffer_put_u32_array(ufr_buffer_t* buffer, const uint32_t* vals, size_t count);
+void ufr_buffer_put_i32_array(ufr_buffer_t* buffer, const int32_t* vals, size_t count);
+void ufr_buffer_put_f32_array(ufr_buffer_t* buffer, const float* vals, size_t count);
+void ufr_buffer_put_str(ufr_buffer_t* buffer, const char* text);
+void ufr_buffer_put_strv(ufr_buffer_t* buffer, const char* const* texts, size_t count);
+void ufr_buffer_put_str_list(ufr_buffer_t* buffer, const char* text, ...);
+void ufr_buffer_putf(ufr_buffer_t* buffer, const char* format, ...);
+void ufr_buffer_vputf(ufr_buffer_t* buffer, const char* format, va_list list);
+
+void ufr_buffer_set_mode(ufr_buffer_t* buffer, uint8_t mode);
+void ufr_buffer_put_u64_as_str(ufr_buffer_t* buffer, uint64_t val);
+void ufr_buffer_put_u8(ufr_buffer_t* buffer, uint8_t val);
+void ufr_buffer_put_u16(ufr_buffer_t* buffer, uint16_t val);
+void ufr_buffer_put_u32(ufr_buffer_t* buffer, uint32_t val);
+void ufr_buffer_put_u64(ufr_buffer_t* buffer, uint64_t val);
+void ufr_buffer_put_i32(ufr_buffer_t* buffer, int32_t val);
+void ufr_buffer_put_f32(ufr_buffer_t* buffer, float val);
+void ufr_buffer_put_f64(ufr_buffer_t* buffer, double val);
+
+void ufr_buffer_reader_init(ufr_buffer_reader_t* reader, const char* data, size_t size, uint8_t mode);
+int ufr_buffer_get_u8(ufr_buffer_reader_t* reader, uint8_t* val);
+int ufr_buffer_get_u16(ufr_buffer_reader_t* reader, uint16_t* val);
+int ufr_buffer_get_u32(ufr_buffer_reader_t* reader, uint32_t* val);
+int ufr_buffer_get_u64(ufr_buffer_reader_t* reader, uint64_t* val);
+int ufr_buffer_get_i32(ufr_buffer_reader_t* reader, int32_t* val);
+int ufr_buffer_get_f32(ufr_buffer_reader_t* reader, float* val);
+int ufr_buffer_get_f64(ufr_buffer_reader_t* reader, double* val);
+const void* ufr_buffer_get_view(ufr_buffer_reader_t* reader, size_t elem_size, size_t count);
+int ufr_buffer_get_str(ufr_buffer_reader_t* reader, const char** str, size_t* len);
+int ufr_buffer_skip(ufr_buffer_reader_t* reader, size_t count);
+
+ufr_buffer_allocator_t* ufr_buffer_pool_allocator();
+void ufr_buffer_pool_trim();
+
+void ufr_buffer_arena_init(ufr_buffer_arena_t* arena, size_t chunk_size);
+void ufr_buffer_arena_reset(ufr_buffer_arena_t* arena);
+void ufr_buffer_arena_free(ufr_buffer_arena_t* arena);
+
+void ufr_buffer_chain_init(ufr_buffer_chain_t* chain, size_t segment_size);
+void ufr_buffer_chain_clear(ufr_buffer_chain_t* chain);
+void ufr_buffer_chain_free(ufr_buffer_chain_t* chain);
+void ufr_buffer_chain_put(ufr_buffer_chain_t* chain, const void* data, size_t size);
+void ufr_buffer_chain_put_ref(ufr_buffer_chain_t* chain, const void* data, size_t size);
+void ufr_buffer_chain_flatten(const ufr_buffer_chain_t* chain, ufr_buffer_t* buffer);
+ssize_t ufr_buffer_chain_writev(const ufr_buffer_chain_t* chain, int fd);
+
+int ufr_buffer_ring_init(ufr_buffer_ring_t* ring, size_t capacity, uint8_t mode);
+void ufr_buffer_ring_free(ufr_buffer_ring_t* ring);
+void* ufr_buffer_ring_reserve(ufr_buffer_ring_t* ring, size_t size);
+void ufr_buffer_ring_commit(ufr_buffer_ring_t* ring, void* record);
+const void* ufr_buffer_ring_peek(ufr_buffer_ring_t* ring, size_t* size);
+void ufr_buffer_ring_release(ufr_buffer_ring_t* ring);
+int ufr_buffer_ring_put(ufr_buffer_ring_t* ring, const ufr_buffer_t* buffer);
+int ufr_buffer_ring_get(ufr_buffer_ring_t* ring, ufr_buffer_t* buffer);
+
+int ufr_buffer_file_create(ufr_buffer_file_t* file, ufr_buffer_t* buffer, const char* path, size_t capacity);
+int ufr_buffer_file_open(ufr_buffer_file_t* file, const char* path);
+int ufr_buffer_file_close(ufr_buffer_file_t* file, ufr_buffer_t* buffer);
@@ -29,6 +29,15 @@
 // ============================================================================
 //  Header
 // ============================================================================
+#include <locale.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
+
 #include "ufr_buffer.h"
 #include "ufr_test.h"
 
@@ -178,6 +187,248 @@ void test_check_size () {
     printf ("\n"); 
 }
 
+// Capacidade inicial, politicas de crescimento e shrink_to_fit.
+void test_buffer_growth () {
+
+    ufr_buffer_t buffer;
+
+    printf ("          Test_buffer_growth\n");
+    printf ("\n");
+
+    ufr_buffer_init_with_capacity (&buffer, 4 << 20);
+    UFR_TEST_EQUAL_U64 (buffer.max, 4 << 20);
+    UFR_TEST_EQUAL_U64 (buffer.size, 0);
+    ufr_buffer_free (&buffer);
+
+    // o dobro da capacidade, de uma vez: 10 * 2^19 >= 4 MB
+    ufr_buffer_init (&buffer);
+    ufr_buffer_check_size (&buffer, 4 << 20);
+    UFR_TEST_EQUAL_U64 (buffer.max, 10 << 19);
+    ufr_buffer_free (&buffer);
+
+    const ufr_buffer_growth_t policies[] = {ufr_buffer_grow_exact, ufr_buffer_grow_1_5x,
+                                            ufr_buffer_grow_page, ufr_buffer_grow_hugepage};
+    const size_t expected[] = {5000, 7064, 8192, 2 << 20};
+    for (int i=0; i<4; i++) {
+        ufr_buffer_init (&buffer);
+        ufr_buffer_set_growth (&buffer, policies[i]);
+        ufr_buffer_put_str (&buffer, "abc");
+        ufr_buffer_check_size (&buffer, 4997);
+        UFR_TEST_EQUAL_U64 (buffer.max, expected[i]);
+        UFR_TEST_EQUAL_STR (buffer.ptr, "abc");
+        ufr_buffer_free (&buffer);
+    }
+    UFR_TEST_TRUE ((ufr_buffer_grow_1_5x (10, 16) >= 16));
+    UFR_TEST_EQUAL_U64 (ufr_buffer_grow_2x (0, 11), 80);
+
+    // apos uma mensagem grande, volta ao tamanho dos dados
+    ufr_buffer_init (&buffer);
+    char* base = ufr_buffer_reserve (&buffer, 1 << 20);
+    memset (base, 'x', 1 << 20);
+    ufr_buffer_clear (&buffer);
+    memset (base, 'y', 200);
+    ufr_buffer_commit (&buffer, 200);
+    ufr_buffer_shrink_to_fit (&buffer);
+    UFR_TEST_EQUAL_U64 (buffer.max, 201);
+    UFR_TEST_EQUAL_U64 (buffer.size, 200);
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_put_str (&buffer, "pequeno");
+    ufr_buffer_shrink_to_fit (&buffer);
+    UFR_TEST_EQUAL_U64 (buffer.max, UFR_BUFFER_INLINE_SIZE);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    UFR_TEST_EQUAL_STR (buffer.ptr, "pequeno");
+    ufr_buffer_put_str (&buffer, "cresce");
+    UFR_TEST_EQUAL_STR (buffer.ptr, "pequeno cresce");
+    ufr_buffer_free (&buffer);
+
+    // buffer liberado pode ser usado de novo
+    ufr_buffer_put_str (&buffer, "depois do free");
+    UFR_TEST_EQUAL_STR (buffer.ptr, "depois do free");
+    ufr_buffer_free (&buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Alocadores: pool por thread, arena e alocador do usuario.
+static size_t g_test_alloc_count = 0;
+
+static void* test_alloc (ufr_buffer_allocator_t* self, size_t size) {
+    (void) self;
+    g_test_alloc_count += 1;
+    return malloc (size);
+}
+
+static void* test_realloc (ufr_buffer_allocator_t* self, void* ptr, size_t old_size, size_t new_size) {
+    (void) self;
+    (void) old_size;
+    g_test_alloc_count += 1;
+    return realloc (ptr, new_size);
+}
+
+static void test_free (ufr_buffer_allocator_t* self, void* ptr, size_t size) {
+    (void) self;
+    (void) size;
+    g_test_alloc_count -= 1;
+    free (ptr);
+}
+
+void test_buffer_allocator () {
+
+    ufr_buffer_t buffer;
+
+    printf ("          Test_buffer_allocator\n");
+    printf ("\n");
+
+    // o pool devolve o mesmo bloco liberado para a mesma classe
+    ufr_buffer_allocator_t* pool = ufr_buffer_pool_allocator ();
+    ufr_buffer_init_with_allocator (&buffer, pool);
+    UFR_TEST_TRUE ((buffer.allocator == pool));
+    ufr_buffer_put_str (&buffer, "pool");
+    ufr_buffer_check_size (&buffer, 100);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "pool");
+    char* first = buffer.ptr;
+    ufr_buffer_free (&buffer);
+    ufr_buffer_init_with_allocator (&buffer, pool);
+    ufr_buffer_check_size (&buffer, 100);
+    UFR_TEST_TRUE ((buffer.ptr == first));
+
+    // cresce para outra classe e para alem da maior classe
+    char* base = ufr_buffer_reserve (&buffer, 3 << 20);
+    memset (base, 'p', 3 << 20);
+    ufr_buffer_commit (&buffer, 3 << 20);
+    UFR_TEST_EQUAL_U64 (buffer.size, 3 << 20);
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_put_str (&buffer, "de volta");
+    ufr_buffer_shrink_to_fit (&buffer);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "de volta");
+    ufr_buffer_free (&buffer);
+
+    ufr_buffer_t* dyn = ufr_buffer_new_with_allocator (pool);
+    ufr_buffer_put_u32_as_str (dyn, 42);
+    UFR_TEST_EQUAL_STR (dyn->ptr, "42");
+    ufr_buffer_delete (dyn);
+    ufr_buffer_pool_trim ();
+
+    // arena: varios buffers liberados de uma vez pelo reset
+    ufr_buffer_arena_t arena;
+    ufr_buffer_arena_init (&arena, 4096);
+    for (int lote=0; lote<3; lote++) {
+        ufr_buffer_t* items[8];
+        for (int i=0; i<8; i++) {
+            items[i] = ufr_buffer_new_with_allocator (&arena.base);
+            ufr_buffer_put_i32_as_str (items[i], i - lote);
+        }
+        // o ultimo bloco cresce no lugar
+        ufr_buffer_check_size (items[7], 200);
+        char* last = items[7]->ptr;
+        ufr_buffer_check_size (items[7], 1000);
+        UFR_TEST_TRUE ((items[7]->ptr == last));
+        ufr_buffer_put_str (items[0], "arena");
+        UFR_TEST_EQUAL_STR (items[0]->ptr, lote == 0 ? "0 arena" : (lote == 1 ? "-1 arena" : "-2 arena"));
+        UFR_TEST_EQUAL_STR (items[7]->ptr, lote == 0 ? "7" : (lote == 1 ? "6" : "5"));
+        ufr_buffer_arena_reset (&arena);
+    }
+    ufr_buffer_init_with_allocator (&buffer, &arena.base);
+    base = ufr_buffer_reserve (&buffer, 10000);
+    memset (base, 'a', 10000);
+    ufr_buffer_commit (&buffer, 10000);
+    UFR_TEST_EQUAL_U64 (buffer.size, 10000);
+    ufr_buffer_free (&buffer);
+    ufr_buffer_arena_free (&arena);
+
+    // alocador do usuario recebe todas as alocacoes, inclusive da estrutura
+    ufr_buffer_allocator_t user = {test_alloc, test_realloc, test_free};
+    dyn = ufr_buffer_new_with_allocator (&user);
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 1);
+    ufr_buffer_put_str (dyn, "usuario");
+    ufr_buffer_check_size (dyn, 5000);
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 2);
+    UFR_TEST_EQUAL_STR (dyn->ptr, "usuario");
+    ufr_buffer_delete (dyn);
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 0);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Dados pequenos ficam dentro da estrutura, sem alocacao.
+void test_buffer_inline () {
+
+    ufr_buffer_t buffer;
+    ufr_buffer_allocator_t user = {test_alloc, test_realloc, test_free};
+
+    printf ("          Test_buffer_inline\n");
+    printf ("\n");
+
+    UFR_TEST_TRUE ((sizeof(ufr_buffer_t) <= 128));
+    ufr_buffer_init_with_allocator (&buffer, &user);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    UFR_TEST_EQUAL_STR (buffer.ptr, "");
+
+    // ate UFR_BUFFER_INLINE_SIZE bytes com o '\0', nenhum malloc
+    char text[UFR_BUFFER_INLINE_SIZE + 1];
+    memset (text, 'a', sizeof(text));
+    ufr_buffer_put (&buffer, text, UFR_BUFFER_INLINE_SIZE - 1);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 0);
+
+    // um byte a mais passa para o heap, mantendo os dados
+    ufr_buffer_put_chr (&buffer, 'b');
+    UFR_TEST_TRUE ((buffer.ptr != buffer.local));
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 1);
+    UFR_TEST_EQUAL_U64 (buffer.size, UFR_BUFFER_INLINE_SIZE);
+    UFR_TEST_EQUAL_U64 (buffer.ptr[UFR_BUFFER_INLINE_SIZE - 2], 'a');
+    UFR_TEST_EQUAL_U64 (buffer.ptr[UFR_BUFFER_INLINE_SIZE - 1], 'b');
+    UFR_TEST_EQUAL_U64 (buffer.ptr[UFR_BUFFER_INLINE_SIZE], '\0');
+
+    // free libera o heap e volta para o espaco local
+    ufr_buffer_free (&buffer);
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 0);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    UFR_TEST_EQUAL_U64 (buffer.max, UFR_BUFFER_INLINE_SIZE);
+    ufr_buffer_put_str (&buffer, "de novo");
+    UFR_TEST_EQUAL_STR (buffer.ptr, "de novo");
+    UFR_TEST_EQUAL_U64 (g_test_alloc_count, 0);
+
+    // capacidade inicial maior que o espaco local vai direto para o heap
+    ufr_buffer_init_with_capacity (&buffer, 1000);
+    UFR_TEST_TRUE ((buffer.ptr != buffer.local));
+    UFR_TEST_EQUAL_U64 (buffer.max, 1000);
+    ufr_buffer_free (&buffer);
+    ufr_buffer_init_with_capacity (&buffer, 16);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    ufr_buffer_free (&buffer);
+
+    // modo binario ocupa todo o espaco local, sem '\0', e depois cresce
+    ufr_buffer_t* binario = malloc (sizeof(ufr_buffer_t));
+    ufr_buffer_init (binario);
+    ufr_buffer_set_mode (binario, UFR_BUFFER_BINARY);
+    for (uint64_t i=0; i<UFR_BUFFER_INLINE_SIZE/8; i++) {
+        ufr_buffer_put_u64 (binario, i);
+    }
+    UFR_TEST_TRUE ((binario->ptr == binario->local));
+    UFR_TEST_EQUAL_U64 (binario->size, UFR_BUFFER_INLINE_SIZE);
+    ufr_buffer_put_u8 (binario, 0xAB);
+    UFR_TEST_TRUE ((binario->ptr != binario->local));
+    UFR_TEST_EQUAL_U64 (binario->size, UFR_BUFFER_INLINE_SIZE + 1);
+    uint64_t ultimo;
+    memcpy (&ultimo, &binario->ptr[UFR_BUFFER_INLINE_SIZE - 8], 8);
+    UFR_TEST_EQUAL_U64 (ultimo, UFR_BUFFER_INLINE_SIZE/8 - 1);
+    UFR_TEST_EQUAL_U64 ((uint8_t) binario->ptr[UFR_BUFFER_INLINE_SIZE], 0xAB);
+    ufr_buffer_free (binario);
+    free (binario);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
 // Inserção de dados.
 void test_buffer_put () {
     
@@ -221,6 +472,57 @@ void test_buffer_put () {
     printf ("\n"); 
 }
 
+// Escrita direta na memoria do buffer.
+void test_buffer_reserve () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+
+    printf ("          Test_buffer_reserve\n");
+    printf ("\n");
+
+    ufr_buffer_put_str (buffer, "img");
+    char* base = ufr_buffer_reserve (buffer, 1000);
+    UFR_TEST_NOT_NULL (base);
+    UFR_TEST_TRUE ((base == &buffer->ptr[3]));
+    UFR_TEST_TRUE ((buffer->max >= 1003));
+    UFR_TEST_EQUAL_U64 (buffer->size, 3);
+    memset (base, 'x', 500);
+    ufr_buffer_commit (buffer, 500);
+    UFR_TEST_EQUAL_U64 (buffer->size, 503);
+    UFR_TEST_EQUAL_U32 (buffer->ptr[502], 'x');
+
+    // read(2) direto no buffer
+    int fd[2];
+    UFR_TEST_ZERO (pipe (fd));
+    UFR_TEST_EQUAL (write (fd[1], "dados do pipe", 13), 13);
+    close (fd[1]);
+    base = ufr_buffer_reserve (buffer, 64);
+    const ssize_t lido = read (fd[0], base, 64);
+    close (fd[0]);
+    UFR_TEST_EQUAL (lido, 13);
+    ufr_buffer_commit (buffer, lido);
+    UFR_TEST_EQUAL_U64 (buffer->size, 516);
+    UFR_TEST_ZERO (memcmp (&buffer->ptr[503], "dados do pipe", 13));
+
+    // os puts continuam depois dos bytes confirmados
+    ufr_buffer_put_u8_as_str (buffer, 7);
+    UFR_TEST_EQUAL_U64 (buffer->size, 518);
+    UFR_TEST_ZERO (memcmp (&buffer->ptr[514], "pe 7", 4));
+
+    // commit maior que o reservado fica no limite do buffer
+    ufr_buffer_commit (buffer, buffer->max + 10);
+    UFR_TEST_TRUE ((buffer->size == buffer->max));
+    UFR_TEST_NULL (ufr_buffer_reserve (NULL, 10));
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
 // Inserção de caractere.
 void test_buffer_put_chr () {
 
@@ -450,6 +752,65 @@ void test_buffer_put_i32_as_str () {
     printf ("\n");
 }
 
+// Compara a conversao de inteiros com o snprintf, nos limites de cada
+// faixa de digitos e em valores aleatorios.
+void test_buffer_put_int_as_str () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+    char expected[64];
+
+    printf ("          Test_buffer_put_int_as_str (comparacao com snprintf)\n");
+    printf ("\n");
+
+    const uint32_t limits[] = {0, 1, 9, 10, 99, 100, 999, 1000, 9999, 10000, 99999, 100000,
+                               999999, 1000000, 9999999, 10000000, 99999999, 100000000,
+                               999999999, 1000000000, 2147483647, 2147483648u, 4294967295u};
+    const size_t count = sizeof(limits) / sizeof(limits[0]);
+    for (size_t i=0; i<count; i++) {
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_u32_as_str (buffer, limits[i]);
+        snprintf (expected, sizeof(expected), "%u", limits[i]);
+        UFR_TEST_EQUAL_STR (buffer->ptr, expected);
+
+        // negacao em unsigned, -(int32_t) 2147483648u estoura o int32_t
+        const int32_t negado = (int32_t) (0u - limits[i]);
+        ufr_buffer_put_i32_as_str (buffer, (int32_t) limits[i]);
+        ufr_buffer_put_i32_as_str (buffer, negado);
+        snprintf (expected, sizeof(expected), "%u %d %d", limits[i], (int32_t) limits[i], negado);
+        UFR_TEST_EQUAL_STR (buffer->ptr, expected);
+    }
+
+    for (int i=-128; i<256; i++) {
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_u8_as_str (buffer, (uint8_t) i);
+        ufr_buffer_put_i8_as_str (buffer, (int8_t) i);
+        snprintf (expected, sizeof(expected), "%u %d", (uint8_t) i, (int8_t) i);
+        UFR_TEST_EQUAL_STR (buffer->ptr, expected);
+    }
+
+    int erros = 0;
+    srand (10);
+    for (int i=0; i<100000; i++) {
+        const uint32_t val = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_u32_as_str (buffer, val);
+        ufr_buffer_put_i32_as_str (buffer, (int32_t) val);
+        const int len = snprintf (expected, sizeof(expected), "%u %d", val, (int32_t) val);
+        if ( buffer->size != (size_t) len || strcmp (buffer->ptr, expected) != 0 ) {
+            erros += 1;
+        }
+    }
+    UFR_TEST_ZERO (erros);
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
 // Converte um valor de ponto flutuante de 32 bits em uma string.
 void test_buffer_put_f32_as_str () {
 
@@ -472,18 +833,23 @@ void test_buffer_put_f32_as_str () {
     ufr_buffer_print (buffer);
     
     ufr_buffer_put_f32_as_str (buffer, 0);
-    UFR_TEST_EQUAL_U64 (buffer->size, 17);
-    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0.000000");
+    UFR_TEST_EQUAL_U64 (buffer->size, 10);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0");
     ufr_buffer_print (buffer);
     
     ufr_buffer_put_f32_as_str (buffer, 34.0000000000000000000000000000000000000);
-    UFR_TEST_EQUAL_U64 (buffer->size, 27);
-    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0.000000 34.000000");
+    UFR_TEST_EQUAL_U64 (buffer->size, 13);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0 34");
     ufr_buffer_print (buffer);
     
     ufr_buffer_put_f32_as_str (buffer, -12.0123456);
+    UFR_TEST_EQUAL_U64 (buffer->size, 24);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0 34 -12.012345");
+    ufr_buffer_print (buffer);
+    
+    ufr_buffer_put_f32_as_str (buffer, 3.4028235e38);
     UFR_TEST_EQUAL_U64 (buffer->size, 38);
-    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0.000000 34.000000 -12.012345");
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0.000012 0 34 -12.012345 3.4028235e+38");
     ufr_buffer_print (buffer);
     
     ufr_buffer_free (buffer);
@@ -496,6 +862,391 @@ void test_buffer_put_f32_as_str () {
 
 }
 
+// Converte um valor de ponto flutuante de 64 bits em uma string.
+void test_buffer_put_f64_as_str () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+
+    UFR_TEST_NOT_NULL (buffer);
+    UFR_TEST_EQUAL_U64 (buffer->size, 0);
+
+    printf ("          Test_buffer_put_f64_as_str (texto curto que volta ao mesmo valor)\n");
+    printf ("\n");
+
+    ufr_buffer_put_f64_as_str (buffer, 0.1);
+    ufr_buffer_put_f64_as_str (buffer, 3.141592653589793);
+    ufr_buffer_put_f64_as_str (buffer, -2.5);
+    ufr_buffer_put_f64_as_str (buffer, 1e16);
+    ufr_buffer_put_f64_as_str (buffer, 1e17);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0.1 3.141592653589793 -2.5 10000000000000000 1e+17");
+    ufr_buffer_print (buffer);
+
+    ufr_buffer_clear (buffer);
+    ufr_buffer_put_f64_as_str (buffer, 5e-324);
+    ufr_buffer_put_f64_as_str (buffer, 1.7976931348623157e308);
+    ufr_buffer_put_f64_as_str (buffer, 0.00001);
+    ufr_buffer_put_f64_as_str (buffer, -0.0);
+    ufr_buffer_put_f64_as_str (buffer, 1.0 / 0.0);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "5e-324 1.7976931348623157e+308 0.00001 -0 inf");
+    ufr_buffer_print (buffer);
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Propriedade de ida e volta: strtof/strtod do texto gerado devolve
+// exatamente o mesmo valor, para padroes de bits aleatorios.
+void test_buffer_put_float_round_trip () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+
+    printf ("          Test_buffer_put_float_round_trip\n");
+    printf ("\n");
+
+    int erros = 0;
+    size_t max_size = 0;
+    srand (20);
+    for (int i=0; i<1000000; i++) {
+        const uint32_t bits = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+        float val;
+        memcpy (&val, &bits, sizeof(val));
+        if ( val != val ) {
+            continue;
+        }
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_f32_as_str (buffer, val);
+        const float res = strtof (buffer->ptr, NULL);
+        if ( memcmp (&res, &val, sizeof(val)) != 0 ) {
+            erros += 1;
+        }
+        if ( buffer->size > max_size ) {
+            max_size = buffer->size;
+        }
+    }
+    UFR_TEST_ZERO (erros);
+    UFR_TEST_TRUE ((max_size < 32));
+
+    for (int i=0; i<1000000; i++) {
+        const uint64_t bits = ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand();
+        double val;
+        memcpy (&val, &bits, sizeof(val));
+        if ( val != val ) {
+            continue;
+        }
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_f64_as_str (buffer, val);
+        const double res = strtod (buffer->ptr, NULL);
+        if ( memcmp (&res, &val, sizeof(val)) != 0 ) {
+            erros += 1;
+        }
+        if ( buffer->size > max_size ) {
+            max_size = buffer->size;
+        }
+    }
+    UFR_TEST_ZERO (erros);
+    UFR_TEST_TRUE ((max_size < 32));
+
+    // todos os floats entre 1 e 2 com o expoente do meio da faixa
+    for (uint32_t bits=0x3F800000; bits<0x40000000; bits+=7) {
+        float val;
+        memcpy (&val, &bits, sizeof(val));
+        ufr_buffer_clear (buffer);
+        ufr_buffer_put_f32_as_str (buffer, val);
+        if ( strtof (buffer->ptr, NULL) != val ) {
+            erros += 1;
+        }
+    }
+    UFR_TEST_ZERO (erros);
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Adiciona vetores de uma vez, com o mesmo texto das chamadas por elemento.
+void test_buffer_put_array () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+    ufr_buffer_t* expected = ufr_buffer_new ();
+
+    printf ("          Test_buffer_put_array\n");
+    printf ("\n");
+
+    const uint32_t u32[] = {0, 7, 1250, 4294967295u};
+    const int32_t i32[] = {-2147483647 - 1, -1, 0, 2147483647};
+    const float f32[] = {0.5, -12.0123456, 3.4028235e38, 0};
+
+    ufr_buffer_put_u32_array (buffer, u32, 4);
+    UFR_TEST_EQUAL_U64 (buffer->size, 19);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0 7 1250 4294967295");
+    ufr_buffer_print (buffer);
+
+    ufr_buffer_put_i32_array (buffer, i32, 4);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0 7 1250 4294967295 -2147483648 -1 0 2147483647");
+    ufr_buffer_print (buffer);
+
+    ufr_buffer_put_f32_array (buffer, f32, 4);
+    ufr_buffer_put_f32_array (buffer, f32, 0);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "0 7 1250 4294967295 -2147483648 -1 0 2147483647 0.5 -12.012345 3.4028235e+38 0");
+    ufr_buffer_print (buffer);
+
+    // vetor grande, como um scan de laser de 1080 pontos
+    float scan[1080];
+    for (int i=0; i<1080; i++) {
+        scan[i] = (float) i * 0.0137f - 3.0f;
+    }
+    ufr_buffer_clear (buffer);
+    ufr_buffer_clear (expected);
+    ufr_buffer_put_f32_array (buffer, scan, 1080);
+    for (int i=0; i<1080; i++) {
+        ufr_buffer_put_f32_as_str (expected, scan[i]);
+    }
+    UFR_TEST_EQUAL_U64 (buffer->size, expected->size);
+    UFR_TEST_EQUAL_STR (buffer->ptr, expected->ptr);
+
+    ufr_buffer_free (buffer);
+    ufr_buffer_free (expected);
+    free (buffer);
+    free (expected);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Mesmo codigo de escrita e leitura nos modos texto, binario e binario
+// alinhado.
+void test_buffer_mode () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+    ufr_buffer_reader_t reader;
+
+    printf ("          Test_buffer_mode (texto, binario e binario alinhado)\n");
+    printf ("\n");
+
+    const uint8_t modes[3] = {UFR_BUFFER_TEXT, UFR_BUFFER_BINARY, UFR_BUFFER_BINARY | UFR_BUFFER_ALIGNED};
+    const size_t sizes[3] = {51, 31, 32};
+    for (int m=0; m<3; m++) {
+        ufr_buffer_clear (buffer);
+        ufr_buffer_set_mode (buffer, modes[m]);
+        ufr_buffer_put_u8 (buffer, 200);
+        ufr_buffer_put_u16 (buffer, 60000);
+        ufr_buffer_put_u32 (buffer, 0x01020304);
+        ufr_buffer_put_u64 (buffer, 18446744073709551615ULL);
+        ufr_buffer_put_i32 (buffer, -5);
+        ufr_buffer_put_f32 (buffer, 0.5);
+        ufr_buffer_put_f64 (buffer, -0.1);
+        UFR_TEST_EQUAL_U64 (buffer->size, sizes[m]);
+
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        uint64_t u64;
+        int32_t i32;
+        float f32;
+        double f64;
+        ufr_buffer_reader_init (&reader, buffer->ptr, buffer->size, buffer->mode);
+        UFR_TEST_OK (ufr_buffer_get_u8 (&reader, &u8));
+        UFR_TEST_OK (ufr_buffer_get_u16 (&reader, &u16));
+        UFR_TEST_OK (ufr_buffer_get_u32 (&reader, &u32));
+        UFR_TEST_OK (ufr_buffer_get_u64 (&reader, &u64));
+        UFR_TEST_OK (ufr_buffer_get_i32 (&reader, &i32));
+        UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+        UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+        UFR_TEST_EQUAL_U32 (u8, 200);
+        UFR_TEST_EQUAL_U32 (u16, 60000);
+        UFR_TEST_EQUAL_U32 (u32, 0x01020304);
+        UFR_TEST_EQUAL_U64 (u64, 18446744073709551615ULL);
+        UFR_TEST_EQUAL_I32 (i32, -5);
+        UFR_TEST_EQUAL_F32 (f32, 0.5);
+        UFR_TEST_EQUAL_F64 (f64, -0.1);
+        UFR_TEST_EQUAL (ufr_buffer_get_u8 (&reader, &u8), UFR_BUFFER_END);
+    }
+
+    // texto e bytes little-endian
+    ufr_buffer_clear (buffer);
+    ufr_buffer_set_mode (buffer, UFR_BUFFER_TEXT);
+    ufr_buffer_put_u16 (buffer, 60000);
+    ufr_buffer_put_u64 (buffer, 18446744073709551615ULL);
+    UFR_TEST_EQUAL_STR (buffer->ptr, "60000 18446744073709551615");
+
+    ufr_buffer_clear (buffer);
+    ufr_buffer_set_mode (buffer, UFR_BUFFER_BINARY | UFR_BUFFER_ALIGNED);
+    ufr_buffer_put_u8 (buffer, 0xAA);
+    ufr_buffer_put_u32 (buffer, 0x01020304);
+    UFR_TEST_EQUAL_U64 (buffer->size, 8);
+    UFR_TEST_ZERO (memcmp (buffer->ptr, "\xAA\0\0\0\x04\x03\x02\x01", 8));
+
+    // vetor binario lido sem copia
+    const float scan[5] = {0.5, 1.5, -2.25, 1e30, 0};
+    ufr_buffer_put_f32_array (buffer, scan, 5);
+    UFR_TEST_EQUAL_U64 (buffer->size, 28);
+    ufr_buffer_reader_init (&reader, buffer->ptr, buffer->size, buffer->mode);
+    uint32_t u32;
+    UFR_TEST_OK (ufr_buffer_get_u8 (&reader, (uint8_t*) &u32));
+    UFR_TEST_OK (ufr_buffer_get_u32 (&reader, &u32));
+    const float* view = (const float*) ufr_buffer_get_view (&reader, sizeof(float), 5);
+    UFR_TEST_NOT_NULL (view);
+    UFR_TEST_TRUE ((view == (const float*) &buffer->ptr[8]));
+    UFR_TEST_ZERO (memcmp (view, scan, sizeof(scan)));
+    UFR_TEST_NULL (ufr_buffer_get_view (&reader, sizeof(float), 1));
+
+    // texto que nao e numero
+    ufr_buffer_reader_init (&reader, "12 abc 300", 10, UFR_BUFFER_TEXT);
+    uint8_t u8;
+    UFR_TEST_OK (ufr_buffer_get_u8 (&reader, &u8));
+    UFR_TEST_EQUAL (ufr_buffer_get_u8 (&reader, &u8), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_u8 (&reader, &u8), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_u8 (&reader, &u8), UFR_BUFFER_END);
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Le de volta o texto escrito pelos puts, sem copiar os dados.
+void test_buffer_reader () {
+
+    ufr_buffer_t* buffer = ufr_buffer_new ();
+    ufr_buffer_reader_t reader;
+
+    printf ("          Test_buffer_reader (texto)\n");
+    printf ("\n");
+
+    ufr_buffer_put_str (buffer, "scan");
+    ufr_buffer_put_u32_as_str (buffer, 4294967295u);
+    ufr_buffer_put_i32_as_str (buffer, -2147483647 - 1);
+    ufr_buffer_put_f32_as_str (buffer, -12.0123456);
+    ufr_buffer_put_f64_as_str (buffer, 1.7976931348623157e308);
+    ufr_buffer_put_str (buffer, "fim");
+    ufr_buffer_print (buffer);
+
+    const char* str;
+    size_t len;
+    uint32_t u32;
+    int32_t i32;
+    float f32;
+    double f64;
+    ufr_buffer_reader_init (&reader, buffer->ptr, buffer->size, UFR_BUFFER_TEXT);
+    UFR_TEST_OK (ufr_buffer_get_str (&reader, &str, &len));
+    UFR_TEST_EQUAL_U64 (len, 4);
+    UFR_TEST_ZERO (strncmp (str, "scan", 4));
+    UFR_TEST_TRUE ((str == buffer->ptr));
+    UFR_TEST_OK (ufr_buffer_get_u32 (&reader, &u32));
+    UFR_TEST_OK (ufr_buffer_get_i32 (&reader, &i32));
+    UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+    UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+    UFR_TEST_EQUAL_U32 (u32, 4294967295u);
+    UFR_TEST_EQUAL_I32 (i32, -2147483647 - 1);
+    UFR_TEST_EQUAL_F32 (f32, (float) -12.0123456);
+    UFR_TEST_EQUAL_F64 (f64, 1.7976931348623157e308);
+    UFR_TEST_OK (ufr_buffer_get_str (&reader, &str, &len));
+    UFR_TEST_ZERO (strncmp (str, "fim", len));
+    UFR_TEST_EQUAL (ufr_buffer_get_str (&reader, &str, &len), UFR_BUFFER_END);
+
+    // pular campos
+    ufr_buffer_reader_init (&reader, buffer->ptr, buffer->size, UFR_BUFFER_TEXT);
+    UFR_TEST_OK (ufr_buffer_skip (&reader, 3));
+    UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+    UFR_TEST_EQUAL_F32 (f32, (float) -12.0123456);
+    UFR_TEST_EQUAL (ufr_buffer_skip (&reader, 3), UFR_BUFFER_END);
+
+    // fora da faixa, sinal e lixo no fim do token; o token invalido e pulado
+    const char* text = "4294967296 -1 2147483648 -2147483649 12x 1.5e 1e3 -inf 0.1";
+    ufr_buffer_reader_init (&reader, text, strlen (text), UFR_BUFFER_TEXT);
+    UFR_TEST_EQUAL (ufr_buffer_get_u32 (&reader, &u32), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_u32 (&reader, &u32), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_i32 (&reader, &i32), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_i32 (&reader, &i32), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_i32 (&reader, &i32), UFR_BUFFER_INVALID);
+    UFR_TEST_EQUAL (ufr_buffer_get_f32 (&reader, &f32), UFR_BUFFER_INVALID);
+    UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+    UFR_TEST_EQUAL_F32 (f32, 1000.0);
+    UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+    UFR_TEST_TRUE ((f64 < 0 && f64 * 0 != 0));
+    UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+    UFR_TEST_EQUAL_F64 (f64, 0.1);
+
+    // o ponto decimal nao depende do locale
+    if ( setlocale (LC_NUMERIC, "de_DE.UTF-8") != NULL || setlocale (LC_NUMERIC, "pt_BR.UTF-8") != NULL ) {
+        ufr_buffer_reader_init (&reader, "0.5 0.30000000000000004", 23, UFR_BUFFER_TEXT);
+        UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+        UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+        UFR_TEST_EQUAL_F32 (f32, 0.5);
+        UFR_TEST_EQUAL_F64 (f64, 0.30000000000000004);
+        setlocale (LC_NUMERIC, "C");
+    }
+
+    // decimal longo (mais de 128 caracteres) vai inteiro para o strtod
+    {
+        char longo[256];
+        memset (longo, '0', sizeof (longo));
+        memcpy (longo, "0.", 2);
+        memcpy (&longo[197], "125", 3);
+        longo[200] = ' ';
+        memcpy (&longo[201], "nan1", 4);
+        ufr_buffer_reader_init (&reader, longo, 205, UFR_BUFFER_TEXT);
+        UFR_TEST_OK (ufr_buffer_get_f64 (&reader, &f64));
+        UFR_TEST_EQUAL_F64 (f64, 125e-198);
+        ufr_buffer_reader_init (&reader, longo, 200, UFR_BUFFER_TEXT);
+        longo[2] = '5';
+        UFR_TEST_OK (ufr_buffer_get_f32 (&reader, &f32));
+        UFR_TEST_EQUAL_F32 (f32, 0.5);
+
+        // token que falha no caminho lento nao altera o valor
+        f32 = 1.5;
+        f64 = 2.5;
+        UFR_TEST_EQUAL (ufr_buffer_get_f32 (&reader, &f32), UFR_BUFFER_END);
+        ufr_buffer_reader_init (&reader, &longo[201], 4, UFR_BUFFER_TEXT);
+        UFR_TEST_EQUAL (ufr_buffer_get_f32 (&reader, &f32), UFR_BUFFER_INVALID);
+        ufr_buffer_reader_init (&reader, &longo[201], 4, UFR_BUFFER_TEXT);
+        UFR_TEST_EQUAL (ufr_buffer_get_f64 (&reader, &f64), UFR_BUFFER_INVALID);
+        UFR_TEST_TRUE ((f32 == 1.5 && f64 == 2.5));
+    }
+
+    // modo binario: leitura que falha nao altera o valor
+    {
+        const uint8_t bytes[1] = {0xAB};
+        uint16_t v16 = 0x1234;
+        uint32_t v32 = 0x12345678;
+        uint64_t v64 = 0x123456789ULL;
+        int32_t vi32 = -5;
+        float vf32 = 1.5;
+        double vf64 = 2.5;
+        ufr_buffer_reader_init (&reader, (const char*) bytes, 0, UFR_BUFFER_BINARY);
+        UFR_TEST_EQUAL (ufr_buffer_get_u16 (&reader, &v16), UFR_BUFFER_END);
+        UFR_TEST_EQUAL (ufr_buffer_get_u32 (&reader, &v32), UFR_BUFFER_END);
+        UFR_TEST_EQUAL (ufr_buffer_get_u64 (&reader, &v64), UFR_BUFFER_END);
+        UFR_TEST_EQUAL (ufr_buffer_get_i32 (&reader, &vi32), UFR_BUFFER_END);
+        UFR_TEST_EQUAL (ufr_buffer_get_f32 (&reader, &vf32), UFR_BUFFER_END);
+        UFR_TEST_EQUAL (ufr_buffer_get_f64 (&reader, &vf64), UFR_BUFFER_END);
+        UFR_TEST_TRUE ((v16 == 0x1234 && v32 == 0x12345678 && v64 == 0x123456789ULL));
+        UFR_TEST_TRUE ((vi32 == -5 && vf32 == 1.5 && vf64 == 2.5));
+    }
+
+    ufr_buffer_free (buffer);
+    free (buffer);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
 // Adiciona uma string (text) ao buffer.
 void test_buffer_put_str () {
 
@@ -536,6 +1287,476 @@ void test_buffer_put_str () {
     printf ("\n");
 }
 
+// Varias strings de uma vez.
+void test_buffer_put_strv () {
+
+    ufr_buffer_t buffer;
+
+    printf ("          Test_buffer_put_strv\n");
+    printf ("\n");
+
+    // mesmo resultado que ufr_buffer_put_str para cada string
+    const char* texts[] = {"topic", "/camera/rgb", "", "640", "480"};
+    ufr_buffer_init (&buffer);
+    ufr_buffer_put_strv (&buffer, texts, 5);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "topic /camera/rgb  640 480");
+    UFR_TEST_EQUAL_U64 (buffer.size, 26);
+    ufr_buffer_put_strv (&buffer, texts, 1);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "topic /camera/rgb  640 480 topic");
+    ufr_buffer_put_strv (&buffer, texts, 0);
+    UFR_TEST_EQUAL_U64 (buffer.size, 32);
+
+    ufr_buffer_t expected;
+    ufr_buffer_init (&expected);
+    for (int i=0; i<5; i++) {
+        ufr_buffer_put_str (&expected, texts[i]);
+    }
+    ufr_buffer_put_str (&expected, texts[0]);
+    UFR_TEST_EQUAL_STR (buffer.ptr, expected.ptr);
+    UFR_TEST_EQUAL_U64 (buffer.size, expected.size);
+
+    // mais de um bloco de 64 strings
+    const char* many[150];
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_clear (&expected);
+    for (int i=0; i<150; i++) {
+        many[i] = (i % 3 == 0) ? "key" : ((i % 3 == 1) ? "=" : "value");
+        ufr_buffer_put_str (&expected, many[i]);
+    }
+    ufr_buffer_put_strv (&buffer, many, 150);
+    UFR_TEST_EQUAL_U64 (buffer.size, expected.size);
+    UFR_TEST_EQUAL_STR (buffer.ptr, expected.ptr);
+
+    // lista terminada por NULL
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_put_str_list (&buffer, "a", "bc", "def", NULL);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "a bc def");
+    ufr_buffer_put_str_list (&buffer, NULL);
+    UFR_TEST_EQUAL_U64 (buffer.size, 8);
+    ufr_buffer_free (&buffer);
+    ufr_buffer_free (&expected);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Mensagem inteira com um formato.
+void test_buffer_putf () {
+
+    ufr_buffer_t buffer;
+    ufr_buffer_t expected;
+
+    printf ("          Test_buffer_putf\n");
+    printf ("\n");
+
+    ufr_buffer_init (&buffer);
+    ufr_buffer_putf (&buffer, "%s %d %f", "pose", 10, 0.5f);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "pose 10 0.5");
+    UFR_TEST_EQUAL_U64 (buffer.size, 11);
+
+    // mesmo texto que os puts separados
+    ufr_buffer_init (&expected);
+    ufr_buffer_put_str (&expected, "pose");
+    ufr_buffer_put_i32_as_str (&expected, -2147483647 - 1);
+    ufr_buffer_put_f32_as_str (&expected, 3.4028235e+38f);
+    ufr_buffer_put_f32_as_str (&expected, -1.5e-7f);
+    ufr_buffer_clear (&buffer);
+    for (int i=0; i<3; i++) {
+        // o mesmo formato vem da cache a partir da segunda vez
+        ufr_buffer_clear (&buffer);
+        ufr_buffer_putf (&buffer, "%s %d %f %f", "pose", -2147483647 - 1, 3.4028235e+38f, -1.5e-7f);
+        UFR_TEST_EQUAL_STR (buffer.ptr, expected.ptr);
+    }
+
+    // texto, "%%", ponteiro e string NULL
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_putf (&buffer, "taxa=%d%% [%s] %p %p", 50, NULL, (void*) 0x1a2b, NULL);
+    UFR_TEST_EQUAL_STR (buffer.ptr, "taxa=50% [] 0x1a2b 0x0");
+
+    // sem separador automatico: continua o texto anterior
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_put_str (&buffer, "a");
+    ufr_buffer_putf (&buffer, "%d", 1);
+    ufr_buffer_putf (&buffer, " %s", "fim");
+    UFR_TEST_EQUAL_STR (buffer.ptr, "a1 fim");
+    ufr_buffer_putf (&buffer, "");
+    UFR_TEST_EQUAL_U64 (buffer.size, 6);
+
+    // strings grandes crescem o buffer uma unica vez
+    char big[5000];
+    memset (big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_putf (&buffer, "<%s>", big);
+    UFR_TEST_EQUAL_U64 (buffer.size, 5001);
+    UFR_TEST_EQUAL_U64 (buffer.ptr[5000], '>');
+
+    // formato com operacoes demais nao escreve nada
+    ufr_buffer_clear (&buffer);
+    ufr_buffer_putf (&buffer, "%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+        1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33);
+    UFR_TEST_ZERO (buffer.size);
+    ufr_buffer_free (&buffer);
+    ufr_buffer_free (&expected);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Cadeia de segmentos: copia, referencia, flatten e writev.
+void test_buffer_chain () {
+
+    ufr_buffer_chain_t chain;
+
+    printf ("          Test_buffer_chain\n");
+    printf ("\n");
+
+    ufr_buffer_chain_init (&chain, 16);
+    UFR_TEST_EQUAL_U64 (chain.count, 0);
+    UFR_TEST_EQUAL_U64 (chain.size, 0);
+
+    // dados pequenos sao copiados e completam o ultimo segmento
+    ufr_buffer_chain_put (&chain, "cabecalho ", 10);
+    ufr_buffer_chain_put (&chain, "12345", 5);
+    UFR_TEST_EQUAL_U64 (chain.count, 1);
+    ufr_buffer_chain_put (&chain, "678", 3);
+    UFR_TEST_EQUAL_U64 (chain.count, 2);
+    UFR_TEST_EQUAL_U64 (chain.iov[0].iov_len, 16);
+    UFR_TEST_EQUAL_U64 (chain.iov[1].iov_len, 2);
+
+    // dados grandes do usuario sao ligados sem copia
+    static char payload[100000];
+    for (size_t i=0; i<sizeof(payload); i++) {
+        payload[i] = 'a' + (i % 26);
+    }
+    ufr_buffer_chain_put_ref (&chain, payload, sizeof(payload));
+    UFR_TEST_EQUAL_U64 (chain.count, 3);
+    UFR_TEST_TRUE ((chain.iov[2].iov_base == payload));
+    ufr_buffer_chain_put (&chain, " fim", 4);
+    UFR_TEST_EQUAL_U64 (chain.count, 4);
+    UFR_TEST_EQUAL_U64 (chain.size, 18 + sizeof(payload) + 4);
+
+    // flatten junta tudo em um buffer continuo
+    ufr_buffer_t buffer;
+    ufr_buffer_init (&buffer);
+    ufr_buffer_chain_flatten (&chain, &buffer);
+    UFR_TEST_EQUAL_U64 (buffer.size, chain.size);
+    UFR_TEST_TRUE ((memcmp (buffer.ptr, "cabecalho 12345678", 18) == 0));
+    UFR_TEST_TRUE ((memcmp (&buffer.ptr[18], payload, sizeof(payload)) == 0));
+    UFR_TEST_EQUAL_STR (&buffer.ptr[buffer.size - 4], " fim");
+
+    // writev envia os segmentos na ordem, mesmo com escritas parciais
+    int fds[2];
+    UFR_TEST_ZERO (pipe (fds));
+    pid_t pid = fork ();
+    if ( pid == 0 ) {
+        close (fds[0]);
+        const ssize_t sent = ufr_buffer_chain_writev (&chain, fds[1]);
+        _exit (sent == (ssize_t) chain.size ? 0 : 1);
+    }
+    close (fds[1]);
+    char* received = malloc (chain.size);
+    size_t total = 0;
+    ssize_t len;
+    while ( (len = read (fds[0], &received[total], chain.size - total)) > 0 ) {
+        total += (size_t) len;
+    }
+    close (fds[0]);
+    int status = -1;
+    waitpid (pid, &status, 0);
+    UFR_TEST_ZERO (status);
+    UFR_TEST_EQUAL_U64 (total, chain.size);
+    UFR_TEST_TRUE ((memcmp (received, buffer.ptr, total) == 0));
+    free (received);
+    ufr_buffer_free (&buffer);
+
+    // erro depois de uma escrita parcial devolve o que foi enviado
+    {
+        int nb[2];
+        UFR_TEST_ZERO (pipe (nb));
+        fcntl (nb[1], F_SETFL, O_NONBLOCK);
+        static char grande[1 << 20];
+        ufr_buffer_chain_t longa;
+        ufr_buffer_chain_init (&longa, 4096);
+        ufr_buffer_chain_put_ref (&longa, grande, sizeof(grande));
+        errno = 0;
+        const ssize_t sent = ufr_buffer_chain_writev (&longa, nb[1]);
+        UFR_TEST_TRUE ((sent > 0 && sent < (ssize_t) sizeof(grande)));
+        UFR_TEST_TRUE ((errno == EAGAIN || errno == EWOULDBLOCK));
+        close (nb[0]);
+        close (nb[1]);
+        ufr_buffer_chain_free (&longa);
+    }
+
+    // clear libera apenas os segmentos proprios
+    ufr_buffer_chain_clear (&chain);
+    UFR_TEST_EQUAL_U64 (chain.count, 0);
+    UFR_TEST_EQUAL_U64 (payload[0], 'a');
+    ufr_buffer_chain_put (&chain, "x", 1);
+    UFR_TEST_EQUAL_U64 (chain.size, 1);
+    ufr_buffer_chain_free (&chain);
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Anel de registros: reserve/commit/peek/release, volta no fim da regiao
+// e produtores em threads.
+#define TEST_RING_COUNT 100000
+
+typedef struct {
+    ufr_buffer_ring_t* ring;
+    uint32_t id;
+} test_ring_producer_t;
+
+static void* test_ring_producer (void* arg) {
+    test_ring_producer_t* producer = (test_ring_producer_t*) arg;
+    for (uint32_t i=0; i<TEST_RING_COUNT; i++) {
+        // tamanho variavel, com id e sequencia no inicio
+        const size_t size = 8 + (i % 40);
+        uint32_t* record;
+        while ( (record = ufr_buffer_ring_reserve (producer->ring, size)) == NULL ) {
+            sched_yield ();
+        }
+        record[0] = producer->id;
+        record[1] = i;
+        memset (&record[2], (int) (i & 0xFF), size - 8);
+        ufr_buffer_ring_commit (producer->ring, record);
+    }
+    return NULL;
+}
+
+static int test_ring_threads (uint8_t mode, uint32_t producers) {
+    ufr_buffer_ring_t ring;
+    pthread_t threads[4];
+    test_ring_producer_t args[4];
+    uint32_t next[4] = {0, 0, 0, 0};
+    int errors = 0;
+
+    ufr_buffer_ring_init (&ring, 4096, mode);
+    for (uint32_t p=0; p<producers; p++) {
+        args[p].ring = &ring;
+        args[p].id = p;
+        pthread_create (&threads[p], NULL, test_ring_producer, &args[p]);
+    }
+    for (uint32_t total=0; total<producers*TEST_RING_COUNT; ) {
+        size_t size;
+        const uint32_t* record = ufr_buffer_ring_peek (&ring, &size);
+        if ( record == NULL ) {
+            sched_yield ();
+            continue;
+        }
+        // cada produtor chega em ordem, com o conteudo intacto
+        const uint32_t id = record[0];
+        const uint8_t* fill = (const uint8_t*) &record[2];
+        if ( id >= producers || record[1] != next[id] || size != 8 + (record[1] % 40)
+                || (size > 8 && fill[size - 9] != (record[1] & 0xFF)) ) {
+            errors += 1;
+        } else {
+            next[id] += 1;
+        }
+        ufr_buffer_ring_release (&ring);
+        total += 1;
+    }
+    for (uint32_t p=0; p<producers; p++) {
+        pthread_join (threads[p], NULL);
+    }
+    size_t size;
+    if ( ufr_buffer_ring_peek (&ring, &size) != NULL ) {
+        errors += 1;
+    }
+    ufr_buffer_ring_free (&ring);
+    return errors;
+}
+
+void test_buffer_ring () {
+
+    ufr_buffer_ring_t ring;
+
+    printf ("          Test_buffer_ring\n");
+    printf ("\n");
+
+    for (uint8_t mode=UFR_BUFFER_RING_SPSC; mode<=UFR_BUFFER_RING_MPSC; mode++) {
+        UFR_TEST_OK (ufr_buffer_ring_init (&ring, 100, mode));
+        UFR_TEST_EQUAL_U64 (ring.capacity, 128);
+
+        size_t size = 0;
+        UFR_TEST_NULL (ufr_buffer_ring_peek (&ring, &size));
+        UFR_TEST_NULL (ufr_buffer_ring_reserve (&ring, 200));
+
+        // registros com o ufr_buffer_t
+        ufr_buffer_t buffer;
+        ufr_buffer_init (&buffer);
+        ufr_buffer_put_str (&buffer, "primeiro");
+        UFR_TEST_OK (ufr_buffer_ring_put (&ring, &buffer));
+        ufr_buffer_clear (&buffer);
+        ufr_buffer_put_u32_as_str (&buffer, 12345);
+        UFR_TEST_OK (ufr_buffer_ring_put (&ring, &buffer));
+        ufr_buffer_clear (&buffer);
+        UFR_TEST_OK (ufr_buffer_ring_get (&ring, &buffer));
+        UFR_TEST_EQUAL_STR (buffer.ptr, "primeiro");
+        ufr_buffer_clear (&buffer);
+        UFR_TEST_OK (ufr_buffer_ring_get (&ring, &buffer));
+        UFR_TEST_EQUAL_STR (buffer.ptr, "12345");
+        UFR_TEST_EQUAL_U64 (ufr_buffer_ring_get (&ring, &buffer), UFR_BUFFER_END);
+
+        // dados binarios com bytes 0
+        ufr_buffer_clear (&buffer);
+        ufr_buffer_put (&buffer, "a\0b\0", 4);
+        UFR_TEST_OK (ufr_buffer_ring_put (&ring, &buffer));
+        ufr_buffer_clear (&buffer);
+        UFR_TEST_OK (ufr_buffer_ring_get (&ring, &buffer));
+        UFR_TEST_EQUAL_U64 (buffer.size, 4);
+        UFR_TEST_TRUE ((memcmp (buffer.ptr, "a\0b\0", 4) == 0));
+        ufr_buffer_free (&buffer);
+
+        // registro de 40 bytes ocupa 48 e a cada volta um deles nao cabe no
+        // fim da regiao de 128 bytes, passando por um registro de pulo
+        for (int round=0; round<5; round++) {
+            char* rec = ufr_buffer_ring_reserve (&ring, 40);
+            UFR_TEST_NOT_NULL (rec);
+            memset (rec, 'a' + round, 40);
+            ufr_buffer_ring_commit (&ring, rec);
+            rec = ufr_buffer_ring_reserve (&ring, 40);
+            UFR_TEST_NOT_NULL (rec);
+            memset (rec, 'A' + round, 40);
+            ufr_buffer_ring_commit (&ring, rec);
+            UFR_TEST_NULL (ufr_buffer_ring_reserve (&ring, 72));
+
+            const char* out = ufr_buffer_ring_peek (&ring, &size);
+            UFR_TEST_EQUAL_U64 (size, 40);
+            UFR_TEST_EQUAL_U64 (out[39], 'a' + round);
+            ufr_buffer_ring_release (&ring);
+            out = ufr_buffer_ring_peek (&ring, &size);
+            UFR_TEST_EQUAL_U64 (out[0], 'A' + round);
+            ufr_buffer_ring_release (&ring);
+            UFR_TEST_NULL (ufr_buffer_ring_peek (&ring, &size));
+        }
+        UFR_TEST_EQUAL_U64 (ring.head, ring.tail);
+        ufr_buffer_ring_free (&ring);
+
+        // tamanhos mistos e grandes: quando o pulo e o registro nao cabem
+        // juntos nem com o anel vazio, o pulo e publicado sozinho e a
+        // tentativa seguinte comeca no inicio da regiao
+        UFR_TEST_OK (ufr_buffer_ring_init (&ring, 4096, mode));
+        const size_t sizes[] = {3000, 3100, 100, 4000, 2000, 2500, 4088, 8, 3900, 16, 200};
+        int stalls = 0;
+        for (size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++) {
+            char* rec = ufr_buffer_ring_reserve (&ring, sizes[i]);
+            if ( rec == NULL ) {
+                // o consumidor so encontra o pulo
+                UFR_TEST_NULL (ufr_buffer_ring_peek (&ring, &size));
+                rec = ufr_buffer_ring_reserve (&ring, sizes[i]);
+                stalls += 1;
+            }
+            UFR_TEST_NOT_NULL (rec);
+            if ( rec == NULL ) {
+                continue;
+            }
+            memset (rec, (int) i + 1, sizes[i]);
+            ufr_buffer_ring_commit (&ring, rec);
+            const char* out = ufr_buffer_ring_peek (&ring, &size);
+            UFR_TEST_EQUAL_U64 (size, sizes[i]);
+            UFR_TEST_EQUAL_U64 (out[sizes[i] - 1], i + 1);
+            ufr_buffer_ring_release (&ring);
+        }
+        UFR_TEST_TRUE ((stalls > 0));
+        UFR_TEST_NULL (ufr_buffer_ring_peek (&ring, &size));
+        ufr_buffer_ring_free (&ring);
+    }
+
+    // threads
+    UFR_TEST_ZERO (test_ring_threads (UFR_BUFFER_RING_SPSC, 1));
+    UFR_TEST_ZERO (test_ring_threads (UFR_BUFFER_RING_MPSC, 1));
+    UFR_TEST_ZERO (test_ring_threads (UFR_BUFFER_RING_MPSC, 4));
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
+// Gravacao em arquivo mapeado e reproducao sem copia.
+void test_buffer_file () {
+
+    ufr_buffer_file_t file;
+    ufr_buffer_t buffer;
+    char path[] = "/tmp/ufr_test_buffer_XXXXXX";
+
+    printf ("          Test_buffer_file\n");
+    printf ("\n");
+
+    const int fd = mkstemp (path);
+    UFR_TEST_TRUE ((fd >= 0));
+    close (fd);
+
+    // a gravacao cresce o arquivo alem da capacidade inicial
+    UFR_TEST_OK (ufr_buffer_file_create (&file, &buffer, path, 100));
+    UFR_TEST_TRUE ((buffer.ptr == file.map));
+    UFR_TEST_EQUAL_U64 (buffer.max, file.size);
+    const size_t initial = file.size;
+    ufr_buffer_set_mode (&buffer, UFR_BUFFER_BINARY);
+    for (uint32_t i=0; i<100000; i++) {
+        ufr_buffer_put_u32 (&buffer, i);
+        ufr_buffer_put_f64 (&buffer, i * 0.5);
+    }
+    UFR_TEST_TRUE ((file.size > initial));
+    UFR_TEST_TRUE ((buffer.ptr == file.map));
+    UFR_TEST_EQUAL_U64 (buffer.size, 1200000);
+    UFR_TEST_OK (ufr_buffer_file_close (&file, &buffer));
+    UFR_TEST_ZERO (buffer.size);
+    UFR_TEST_TRUE ((buffer.allocator == NULL));
+
+    // o arquivo tem exatamente os dados
+    struct stat st;
+    UFR_TEST_ZERO (stat (path, &st));
+    UFR_TEST_EQUAL_U64 (st.st_size, 1200000);
+
+    // reproducao direto no mapeamento
+    UFR_TEST_OK (ufr_buffer_file_open (&file, path));
+    UFR_TEST_EQUAL_U64 (file.size, 1200000);
+    ufr_buffer_reader_t reader;
+    ufr_buffer_reader_init (&reader, file.map, file.size, UFR_BUFFER_BINARY);
+    int errors = 0;
+    for (uint32_t i=0; i<100000; i++) {
+        uint32_t u;
+        double f;
+        if ( ufr_buffer_get_u32 (&reader, &u) != UFR_OK || u != i
+                || ufr_buffer_get_f64 (&reader, &f) != UFR_OK || f != i * 0.5 ) {
+            errors += 1;
+        }
+    }
+    UFR_TEST_ZERO (errors);
+    uint32_t u;
+    UFR_TEST_EQUAL_U64 (ufr_buffer_get_u32 (&reader, &u), UFR_BUFFER_END);
+    UFR_TEST_OK (ufr_buffer_file_close (&file, NULL));
+
+    // dados pequenos que voltaram para o espaco local tambem sao gravados
+    UFR_TEST_OK (ufr_buffer_file_create (&file, &buffer, path, 0));
+    ufr_buffer_put_str (&buffer, "pequeno");
+    ufr_buffer_shrink_to_fit (&buffer);
+    UFR_TEST_TRUE ((buffer.ptr == buffer.local));
+    UFR_TEST_OK (ufr_buffer_file_close (&file, &buffer));
+    UFR_TEST_OK (ufr_buffer_file_open (&file, path));
+    UFR_TEST_EQUAL_U64 (file.size, 7);
+    UFR_TEST_TRUE ((memcmp (file.map, "pequeno", 7) == 0));
+    UFR_TEST_OK (ufr_buffer_file_close (&file, NULL));
+
+    unlink (path);
+    UFR_TEST_TRUE ((ufr_buffer_file_open (&file, path) != UFR_OK));
+    printf ("\n");
+
+    ufr_test_print_result ();
+    printf ("------------------------------------------------------------------------------");
+    printf ("\n");
+}
+
 // Testa entradas nulas nas funções.
 void test_entrada_nula() {
     
@@ -553,7 +1774,32 @@ void test_entrada_nula() {
     ufr_buffer_put_u32_as_str (NULL, 1250);
     ufr_buffer_put_i32_as_str (NULL, 1350);
     ufr_buffer_put_f32_as_str (NULL, 0);
+    ufr_buffer_put_f64_as_str (NULL, 0);
+    ufr_buffer_put_u32_array (NULL, NULL, 0);
+    ufr_buffer_put_i32_array (NULL, NULL, 0);
+    ufr_buffer_put_f32_array (NULL, NULL, 0);
     ufr_buffer_put_str (NULL, "teste 1");
+    ufr_buffer_put_strv (NULL, NULL, 0);
+    ufr_buffer_put_str_list (NULL, NULL);
+    ufr_buffer_putf (NULL, "%d", 1);
+    ufr_buffer_init_with_allocator (NULL, NULL);
+    ufr_buffer_delete (NULL);
+    ufr_buffer_arena_init (NULL, 0);
+    ufr_buffer_arena_reset (NULL);
+    ufr_buffer_arena_free (NULL);
+    ufr_buffer_chain_init (NULL, 0);
+    ufr_buffer_chain_put (NULL, "Dado", 4);
+    ufr_buffer_chain_put_ref (NULL, "Dado", 4);
+    ufr_buffer_chain_flatten (NULL, NULL);
+    ufr_buffer_chain_writev (NULL, 1);
+    ufr_buffer_chain_free (NULL);
+    ufr_buffer_ring_init (NULL, 0, UFR_BUFFER_RING_SPSC);
+    ufr_buffer_ring_put (NULL, NULL);
+    ufr_buffer_ring_get (NULL, NULL);
+    ufr_buffer_ring_free (NULL);
+    ufr_buffer_file_create (NULL, NULL, NULL, 0);
+    ufr_buffer_file_open (NULL, NULL);
+    ufr_buffer_file_close (NULL, NULL);
 }
 
 int main() {
@@ -567,14 +1813,29 @@ int main() {
     test_buffer_clear          ();
     test_buffer_free           ();
     test_check_size            (); 
+    test_buffer_growth         ();
+    test_buffer_allocator      ();
+    test_buffer_inline         ();
     test_buffer_put            ();
+    test_buffer_reserve        ();
     test_buffer_put_chr        ();
     test_buffer_put_u8_as_str  ();
     test_buffer_put_i8_as_str  ();
     test_buffer_put_u32_as_str ();
     test_buffer_put_i32_as_str ();
+    test_buffer_put_int_as_str ();
     test_buffer_put_f32_as_str ();
+    test_buffer_put_f64_as_str ();
+    test_buffer_put_float_round_trip ();
+    test_buffer_put_array ();
+    test_buffer_mode ();
+    test_buffer_reader ();
     test_buffer_put_str        ();
+    test_buffer_put_strv       ();
+    test_buffer_putf           ();
+    test_buffer_chain          ();
+    test_buffer_ring           ();
+    test_buffer_file           ();
     
     return 0;
 }
\ No newline at end of file